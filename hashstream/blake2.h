@@ -0,0 +1,139 @@
+/*
+ * BLAKE2b and BLAKE2s as specified in RFC 7693.
+ *
+ * Both support keyed hashing, with a key of up to BLAKE2x_KEYBYTES
+ * bytes, and digests of any length from one byte up to
+ * BLAKE2x_OUTBYTES. BLAKE2b works on 64-bit words and is the faster of
+ * the two on 64-bit machines. BLAKE2s works on 32-bit words.
+ *
+ * BLAKE2bp and BLAKE2sp are the parallel modes of the specification:
+ * the message is dealt out a block at a time to four or eight leaves,
+ * hashed independently, whose digests are then hashed by a root node.
+ * They produce different digests from BLAKE2b and BLAKE2s.
+ */
+
+#ifndef __BLAKE2_H
+#define __BLAKE2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLAKE2B_BLOCKBYTES	128
+#define BLAKE2B_OUTBYTES	64
+#define BLAKE2B_KEYBYTES	64
+
+#define BLAKE2S_BLOCKBYTES	64
+#define BLAKE2S_OUTBYTES	32
+#define BLAKE2S_KEYBYTES	32
+
+/*
+ * The final block is compressed differently from the others, so up to
+ * a whole block of input is held back in buf until more arrives or the
+ * hash is finalised.
+ */
+typedef struct {
+	uint64_t	h[8];		/* chaining variables */
+	uint64_t	t[2];		/* bytes compressed so far */
+	uint64_t	f[2];		/* finalisation flags */
+	uint8_t		buf[BLAKE2B_BLOCKBYTES];
+	size_t		buflen;
+	size_t		outlen;
+	size_t		keylen;		/* the key block is buf until any message follows it */
+	int		last_node;	/* set for the last node of each level of a tree */
+} blake2b_state;
+
+typedef struct {
+	uint32_t	h[8];
+	uint32_t	t[2];
+	uint32_t	f[2];
+	uint8_t		buf[BLAKE2S_BLOCKBYTES];
+	size_t		buflen;
+	size_t		outlen;
+	size_t		keylen;
+	int		last_node;
+} blake2s_state;
+
+#define BLAKE2BP_LEAVES		4
+#define BLAKE2SP_LEAVES		8
+
+/* Input is dealt out to the leaves a stripe of one block per leaf at a time */
+#define BLAKE2BP_STRIPEBYTES	(BLAKE2BP_LEAVES * BLAKE2B_BLOCKBYTES)
+#define BLAKE2SP_STRIPEBYTES	(BLAKE2SP_LEAVES * BLAKE2S_BLOCKBYTES)
+
+/*
+ * Each leaf holds back its latest block, as in sequential hashing, and
+ * buf holds any partial stripe.
+ */
+typedef struct {
+	blake2b_state	leaves[BLAKE2BP_LEAVES];
+	uint8_t		buf[BLAKE2BP_STRIPEBYTES];
+	size_t		buflen;
+	size_t		outlen;
+	size_t		keylen;
+} blake2bp_state;
+
+typedef struct {
+	blake2s_state	leaves[BLAKE2SP_LEAVES];
+	uint8_t		buf[BLAKE2SP_STRIPEBYTES];
+	size_t		buflen;
+	size_t		outlen;
+	size_t		keylen;
+} blake2sp_state;
+
+/*
+ * Initialise S for a digest of outlen bytes, keyed by the keylen bytes
+ * at key if keylen is non-zero. Return 0 on success or -1 if outlen or
+ * keylen is out of range.
+ */
+int blake2b_init(blake2b_state* S, size_t outlen);
+int blake2b_init_key(blake2b_state* S, size_t outlen, const void* key, size_t keylen);
+void blake2b_update(blake2b_state* S, const void* in, size_t inlen);
+/* Write the S->outlen byte digest to out */
+void blake2b_final(blake2b_state* S, uint8_t* out);
+
+int blake2s_init(blake2s_state* S, size_t outlen);
+int blake2s_init_key(blake2s_state* S, size_t outlen, const void* key, size_t keylen);
+void blake2s_update(blake2s_state* S, const void* in, size_t inlen);
+void blake2s_final(blake2s_state* S, uint8_t* out);
+
+/*
+ * Initialise S as node node_offset at depth node_depth of a tree with
+ * the given fanout and depth, whose inner nodes produce inner_length
+ * byte digests. The parameter block records outlen and keylen, but S
+ * is set to produce outlen bytes and no key block is queued: both are
+ * for the caller to adjust where the node is a leaf.
+ */
+int blake2b_init_node(blake2b_state* S, size_t outlen, size_t keylen, size_t fanout, size_t depth,
+		      uint64_t node_offset, size_t node_depth, size_t inner_length);
+int blake2s_init_node(blake2s_state* S, size_t outlen, size_t keylen, size_t fanout, size_t depth,
+		      uint64_t node_offset, size_t node_depth, size_t inner_length);
+
+int blake2bp_init(blake2bp_state* S, size_t outlen);
+int blake2bp_init_key(blake2bp_state* S, size_t outlen, const void* key, size_t keylen);
+void blake2bp_update(blake2bp_state* S, const void* in, size_t inlen);
+void blake2bp_final(blake2bp_state* S, uint8_t* out);
+
+/*
+ * Deal n_stripes whole stripes at in to leaves first to first + count -
+ * 1 only. This is the bulk of blake2bp_update() and may be called for
+ * disjoint sets of leaves from different threads, but only while
+ * S->buflen is zero and only if every leaf is eventually given the same
+ * stripes.
+ */
+void blake2bp_update_leaves(blake2bp_state* S, size_t first, size_t count, const uint8_t* in, size_t n_stripes);
+
+int blake2sp_init(blake2sp_state* S, size_t outlen);
+int blake2sp_init_key(blake2sp_state* S, size_t outlen, const void* key, size_t keylen);
+void blake2sp_update(blake2sp_state* S, const void* in, size_t inlen);
+void blake2sp_final(blake2sp_state* S, uint8_t* out);
+void blake2sp_update_leaves(blake2sp_state* S, size_t first, size_t count, const uint8_t* in, size_t n_stripes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLAKE2_H */
@@ -0,0 +1,133 @@
+/*
+ * BLAKE2b compression function using AVX2.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * Each row of the 4x4 working state is held in one 256-bit register, so
+ * the four column steps of a round, and then the four diagonal steps,
+ * run together. The four message words each step needs are assembled
+ * from two pairs loaded straight from the block, as in blake2b_sse41.c.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint64_t blake2b_IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t blake2b_sigma[12][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+#define M(i)	_mm_loadu_si128((const __m128i*)(data + 16 * (i)))
+
+/* Message words a and b in the low and high halves of a 128-bit register, see blake2b_sse41.c */
+#define MSG2(a, b) \
+	(((a) % 2 == 0 && (b) == (a) + 1) ? M((a) / 2) : \
+	 ((a) % 2 == 0 && (b) % 2 == 0) ? _mm_unpacklo_epi64(M((a) / 2), M((b) / 2)) : \
+	 ((a) % 2 == 1 && (b) % 2 == 1) ? _mm_unpackhi_epi64(M((a) / 2), M((b) / 2)) : \
+	 ((a) % 2 == 0) ? _mm_blend_epi32(M((a) / 2), M((b) / 2), 0xc) : \
+	 _mm_alignr_epi8(M((b) / 2), M((a) / 2), 8))
+
+#define S(r, i)	blake2b_sigma[r][i]
+
+/* Message words sigma[r][i0], ..., sigma[r][i3] */
+#define MSG4(r, i0, i1, i2, i3) \
+	_mm256_inserti128_si256(_mm256_castsi128_si256(MSG2(S(r, i0), S(r, i1))), MSG2(S(r, i2), S(r, i3)), 1)
+
+#define ROTR32(x)	_mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x)	_mm256_shuffle_epi8((x), r24)
+#define ROTR16(x)	_mm256_shuffle_epi8((x), r16)
+#define ROTR63(x)	_mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+/* The G function on all four columns, or diagonals, at once */
+#define G(b0, b1) do { \
+	row1 = _mm256_add_epi64(_mm256_add_epi64(row1, (b0)), row2); \
+	row4 = ROTR32(_mm256_xor_si256(row4, row1)); \
+	row3 = _mm256_add_epi64(row3, row4); \
+	row2 = ROTR24(_mm256_xor_si256(row2, row3)); \
+	row1 = _mm256_add_epi64(_mm256_add_epi64(row1, (b1)), row2); \
+	row4 = ROTR16(_mm256_xor_si256(row4, row1)); \
+	row3 = _mm256_add_epi64(row3, row4); \
+	row2 = ROTR63(_mm256_xor_si256(row2, row3)); \
+} while (0)
+
+/*
+ * Rotate rows 1, 3 and 4 right by one, two and three words so the
+ * diagonals become columns. Row 2 is the last to be computed by G, so
+ * leaving it in place keeps the permutes off the critical path. Lane 0
+ * then holds the last diagonal step, so its message words come first.
+ */
+#define DIAGONALIZE() do { \
+	row1 = _mm256_permute4x64_epi64(row1, _MM_SHUFFLE(2, 1, 0, 3)); \
+	row3 = _mm256_permute4x64_epi64(row3, _MM_SHUFFLE(0, 3, 2, 1)); \
+	row4 = _mm256_permute4x64_epi64(row4, _MM_SHUFFLE(1, 0, 3, 2)); \
+} while (0)
+
+#define UNDIAGONALIZE() do { \
+	row1 = _mm256_permute4x64_epi64(row1, _MM_SHUFFLE(0, 3, 2, 1)); \
+	row3 = _mm256_permute4x64_epi64(row3, _MM_SHUFFLE(2, 1, 0, 3)); \
+	row4 = _mm256_permute4x64_epi64(row4, _MM_SHUFFLE(1, 0, 3, 2)); \
+} while (0)
+
+#define ROUND(r) do { \
+	G(MSG4(r, 0, 2, 4, 6), MSG4(r, 1, 3, 5, 7)); \
+	DIAGONALIZE(); \
+	G(MSG4(r, 14, 8, 10, 12), MSG4(r, 15, 9, 11, 13)); \
+	UNDIAGONALIZE(); \
+} while (0)
+
+void blake2b_blocks_avx2(uint64_t h[8], uint64_t t[2], const uint64_t f[2],
+			 const uint8_t* data, size_t n_blocks, size_t inc)
+{
+	const __m256i r16 = _mm256_setr_epi8(
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+	const __m256i r24 = _mm256_setr_epi8(
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const __m256i iv0 = _mm256_loadu_si256((const __m256i*)(blake2b_IV + 0));
+	const __m256i iv1 = _mm256_loadu_si256((const __m256i*)(blake2b_IV + 4));
+	__m256i row1, row2, row3, row4, h0, h1;
+
+	h0 = _mm256_loadu_si256((const __m256i*)(h + 0));
+	h1 = _mm256_loadu_si256((const __m256i*)(h + 4));
+
+	for (; n_blocks > 0; n_blocks--, data += 128) {
+		t[0] += inc;
+		t[1] += (t[0] < inc);
+
+		row1 = h0;
+		row2 = h1;
+		row3 = iv0;
+		row4 = _mm256_xor_si256(iv1, _mm256_setr_epi64x((long long)t[0], (long long)t[1],
+								(long long)f[0], (long long)f[1]));
+
+		ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4); ROUND(5);
+		ROUND(6); ROUND(7); ROUND(8); ROUND(9); ROUND(10); ROUND(11);
+
+		h0 = _mm256_xor_si256(h0, _mm256_xor_si256(row1, row3));
+		h1 = _mm256_xor_si256(h1, _mm256_xor_si256(row2, row4));
+	}
+
+	_mm256_storeu_si256((__m256i*)(h + 0), h0);
+	_mm256_storeu_si256((__m256i*)(h + 4), h1);
+}
@@ -0,0 +1,170 @@
+/*
+ * BLAKE2b compression function using SSE4.1.
+ *
+ * This file is compiled with -msse4.1 and must only be called through
+ * the kernel table, which selects it when the CPU reports SSSE3 and
+ * SSE4.1, see dispatch.c.
+ *
+ * Each row of the 4x4 working state is held in a pair of 128-bit
+ * registers, so the four column steps of a round, and then the four
+ * diagonal steps, run two at a time in each half. Rotations by whole
+ * bytes are shuffles. Each pair of message words a step needs is
+ * loaded straight from the block with at most one more instruction, see
+ * MSG() below, which leaves the registers free for the state.
+ */
+
+#include <smmintrin.h>
+
+#include "dispatch.h"
+
+static const uint64_t blake2b_IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t blake2b_sigma[12][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+/*
+ * Message words a and b, from M(a / 2) and M(b / 2), in the low and high
+ * halves of a register. The sigma entries are constants once the rounds
+ * are unrolled, so only one of these cases survives for each pair.
+ */
+#define MSG(a, b) \
+	(((a) % 2 == 0 && (b) == (a) + 1) ? M((a) / 2) : \
+	 ((a) % 2 == 0 && (b) % 2 == 0) ? _mm_unpacklo_epi64(M((a) / 2), M((b) / 2)) : \
+	 ((a) % 2 == 1 && (b) % 2 == 1) ? _mm_unpackhi_epi64(M((a) / 2), M((b) / 2)) : \
+	 ((a) % 2 == 0) ? _mm_blend_epi16(M((a) / 2), M((b) / 2), 0xf0) : \
+	 _mm_alignr_epi8(M((b) / 2), M((a) / 2), 8))
+
+#define ROTR32(x)	_mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x)	_mm_shuffle_epi8((x), r24)
+#define ROTR16(x)	_mm_shuffle_epi8((x), r16)
+#define ROTR63(x)	_mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+/* Half of the G function on both halves of the rows, adding message pairs b0 and b1 */
+#define G1(b0, b1) do { \
+	row1l = _mm_add_epi64(_mm_add_epi64(row1l, (b0)), row2l); \
+	row1h = _mm_add_epi64(_mm_add_epi64(row1h, (b1)), row2h); \
+	row4l = ROTR32(_mm_xor_si128(row4l, row1l)); \
+	row4h = ROTR32(_mm_xor_si128(row4h, row1h)); \
+	row3l = _mm_add_epi64(row3l, row4l); \
+	row3h = _mm_add_epi64(row3h, row4h); \
+	row2l = ROTR24(_mm_xor_si128(row2l, row3l)); \
+	row2h = ROTR24(_mm_xor_si128(row2h, row3h)); \
+} while (0)
+
+#define G2(b0, b1) do { \
+	row1l = _mm_add_epi64(_mm_add_epi64(row1l, (b0)), row2l); \
+	row1h = _mm_add_epi64(_mm_add_epi64(row1h, (b1)), row2h); \
+	row4l = ROTR16(_mm_xor_si128(row4l, row1l)); \
+	row4h = ROTR16(_mm_xor_si128(row4h, row1h)); \
+	row3l = _mm_add_epi64(row3l, row4l); \
+	row3h = _mm_add_epi64(row3h, row4h); \
+	row2l = ROTR63(_mm_xor_si128(row2l, row3l)); \
+	row2h = ROTR63(_mm_xor_si128(row2h, row3h)); \
+} while (0)
+
+/*
+ * Rotate rows 1, 3 and 4 right by one, two and three words so the
+ * diagonals become columns. Row 2 is the last to be computed by G, so
+ * leaving it in place keeps the shuffles off the critical path. Lane 0
+ * then holds the last diagonal step, so its message words come first.
+ */
+#define DIAGONALIZE() do { \
+	t0 = _mm_alignr_epi8(row1l, row1h, 8); \
+	t1 = _mm_alignr_epi8(row1h, row1l, 8); \
+	row1l = t0; \
+	row1h = t1; \
+	t0 = _mm_alignr_epi8(row3h, row3l, 8); \
+	t1 = _mm_alignr_epi8(row3l, row3h, 8); \
+	row3l = t0; \
+	row3h = t1; \
+	t0 = row4l; \
+	row4l = row4h; \
+	row4h = t0; \
+} while (0)
+
+#define UNDIAGONALIZE() do { \
+	t0 = _mm_alignr_epi8(row1h, row1l, 8); \
+	t1 = _mm_alignr_epi8(row1l, row1h, 8); \
+	row1l = t0; \
+	row1h = t1; \
+	t0 = _mm_alignr_epi8(row3l, row3h, 8); \
+	t1 = _mm_alignr_epi8(row3h, row3l, 8); \
+	row3l = t0; \
+	row3h = t1; \
+	t0 = row4l; \
+	row4l = row4h; \
+	row4h = t0; \
+} while (0)
+
+#define M(i)	_mm_loadu_si128((const __m128i*)(data + 16 * (i)))
+
+#define S(r, i)	blake2b_sigma[r][i]
+
+#define ROUND(r) do { \
+	G1(MSG(S(r, 0), S(r, 2)), MSG(S(r, 4), S(r, 6))); \
+	G2(MSG(S(r, 1), S(r, 3)), MSG(S(r, 5), S(r, 7))); \
+	DIAGONALIZE(); \
+	G1(MSG(S(r, 14), S(r, 8)), MSG(S(r, 10), S(r, 12))); \
+	G2(MSG(S(r, 15), S(r, 9)), MSG(S(r, 11), S(r, 13))); \
+	UNDIAGONALIZE(); \
+} while (0)
+
+void blake2b_blocks_sse41(uint64_t h[8], uint64_t t[2], const uint64_t f[2],
+			  const uint8_t* data, size_t n_blocks, size_t inc)
+{
+	const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+	const __m128i r24 = _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	__m128i row1l, row1h, row2l, row2h, row3l, row3h, row4l, row4h, t0, t1;
+	__m128i h01, h23, h45, h67;
+
+	h01 = _mm_loadu_si128((const __m128i*)(h + 0));
+	h23 = _mm_loadu_si128((const __m128i*)(h + 2));
+	h45 = _mm_loadu_si128((const __m128i*)(h + 4));
+	h67 = _mm_loadu_si128((const __m128i*)(h + 6));
+
+	for (; n_blocks > 0; n_blocks--, data += 128) {
+		t[0] += inc;
+		t[1] += (t[0] < inc);
+
+		row1l = h01;
+		row1h = h23;
+		row2l = h45;
+		row2h = h67;
+		row3l = _mm_loadu_si128((const __m128i*)(blake2b_IV + 0));
+		row3h = _mm_loadu_si128((const __m128i*)(blake2b_IV + 2));
+		row4l = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(blake2b_IV + 4)),
+				      _mm_loadu_si128((const __m128i*)t));
+		row4h = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(blake2b_IV + 6)),
+				      _mm_loadu_si128((const __m128i*)f));
+
+		ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4); ROUND(5);
+		ROUND(6); ROUND(7); ROUND(8); ROUND(9); ROUND(10); ROUND(11);
+
+		h01 = _mm_xor_si128(h01, _mm_xor_si128(row1l, row3l));
+		h23 = _mm_xor_si128(h23, _mm_xor_si128(row1h, row3h));
+		h45 = _mm_xor_si128(h45, _mm_xor_si128(row2l, row4l));
+		h67 = _mm_xor_si128(h67, _mm_xor_si128(row2h, row4h));
+	}
+
+	_mm_storeu_si128((__m128i*)(h + 0), h01);
+	_mm_storeu_si128((__m128i*)(h + 2), h23);
+	_mm_storeu_si128((__m128i*)(h + 4), h45);
+	_mm_storeu_si128((__m128i*)(h + 6), h67);
+}
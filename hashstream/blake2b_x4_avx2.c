@@ -0,0 +1,135 @@
+/*
+ * The four BLAKE2bp leaves using AVX2, see blake2bp.c.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * Each 256-bit register holds the same 64-bit word of the working state
+ * for all four leaves, so the rounds are exactly those of
+ * blake2b_compress() in blake2b.c performed on four lanes at once. The
+ * leaves are compressed in step and never with their final block, so
+ * they share one byte counter and no finalisation flags.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint64_t blake2b_IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t blake2b_sigma[12][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+#define ADD(x, y)	_mm256_add_epi64((x), (y))
+#define XOR(x, y)	_mm256_xor_si256((x), (y))
+
+#define ROTR32(x)	_mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x)	_mm256_shuffle_epi8((x), r24)
+#define ROTR16(x)	_mm256_shuffle_epi8((x), r16)
+#define ROTR63(x)	XOR(_mm256_srli_epi64((x), 63), ADD((x), (x)))
+
+#define G(r, i, a, b, c, d) do { \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake2b_sigma[r][2 * (i) + 0]]); \
+	v[d] = ROTR32(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR24(XOR(v[b], v[c])); \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake2b_sigma[r][2 * (i) + 1]]); \
+	v[d] = ROTR16(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR63(XOR(v[b], v[c])); \
+} while (0)
+
+#define ROUND(r) do { \
+	G(r, 0, 0, 4,  8, 12); \
+	G(r, 1, 1, 5,  9, 13); \
+	G(r, 2, 2, 6, 10, 14); \
+	G(r, 3, 3, 7, 11, 15); \
+	G(r, 4, 0, 5, 10, 15); \
+	G(r, 5, 1, 6, 11, 12); \
+	G(r, 6, 2, 7,  8, 13); \
+	G(r, 7, 3, 4,  9, 14); \
+} while (0)
+
+/* Load four words at offset from each leaf's block and transpose them into m[0..3] */
+static void load_words(__m256i* m, const uint8_t* const* data, size_t offset)
+{
+	__m256i r0, r1, r2, r3, t0, t1, t2, t3;
+
+	r0 = _mm256_loadu_si256((const __m256i*)(data[0] + offset));
+	r1 = _mm256_loadu_si256((const __m256i*)(data[1] + offset));
+	r2 = _mm256_loadu_si256((const __m256i*)(data[2] + offset));
+	r3 = _mm256_loadu_si256((const __m256i*)(data[3] + offset));
+
+	t0 = _mm256_unpacklo_epi64(r0, r1);
+	t1 = _mm256_unpackhi_epi64(r0, r1);
+	t2 = _mm256_unpacklo_epi64(r2, r3);
+	t3 = _mm256_unpackhi_epi64(r2, r3);
+
+	m[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+	m[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+	m[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+	m[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+void blake2b_x4_avx2(uint64_t* h, uint64_t t[2], const uint8_t* const* data, size_t n_blocks, size_t stride)
+{
+	const __m256i r16 = _mm256_setr_epi8(
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+		2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+	const __m256i r24 = _mm256_setr_epi8(
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+		3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const uint8_t* p[4];
+	__m256i hv[8], v[16], m[16];
+	size_t offset;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		hv[i] = _mm256_loadu_si256((const __m256i*)(h + 4 * i));
+
+	for (offset = 0; n_blocks > 0; n_blocks--, offset += stride) {
+		t[0] += 128;
+		t[1] += (t[0] < 128);
+
+		for (i = 0; i < 4; i++)
+			p[i] = data[i] + offset;
+		load_words(m + 0, p, 0);
+		load_words(m + 4, p, 32);
+		load_words(m + 8, p, 64);
+		load_words(m + 12, p, 96);
+
+		for (i = 0; i < 8; i++) {
+			v[i] = hv[i];
+			v[i + 8] = _mm256_set1_epi64x((long long)blake2b_IV[i]);
+		}
+		v[12] = XOR(v[12], _mm256_set1_epi64x((long long)t[0]));
+		v[13] = XOR(v[13], _mm256_set1_epi64x((long long)t[1]));
+
+		ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4); ROUND(5);
+		ROUND(6); ROUND(7); ROUND(8); ROUND(9); ROUND(10); ROUND(11);
+
+		for (i = 0; i < 8; i++)
+			hv[i] = XOR(hv[i], XOR(v[i], v[i + 8]));
+	}
+
+	for (i = 0; i < 8; i++)
+		_mm256_storeu_si256((__m256i*)(h + 4 * i), hv[i]);
+}
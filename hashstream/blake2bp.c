@@ -0,0 +1,168 @@
+/*
+ * BLAKE2bp, see blake2.h.
+ *
+ * Block i of the message goes to leaf i % 4. Each leaf is an ordinary
+ * BLAKE2b state, apart from its parameter block, and holds back its
+ * latest block in case it is the final one. Where the kernel table has
+ * a blake2bp_leaves kernel, the leaves are compressed together, one per
+ * lane. Otherwise each is compressed in turn by blake2b_blocks.
+ */
+
+#include <string.h>
+
+#include "blake2.h"
+#include "dispatch.h"
+
+int blake2bp_init(blake2bp_state* S, size_t outlen)
+{
+	return blake2bp_init_key(S, outlen, NULL, 0);
+}
+
+int blake2bp_init_key(blake2bp_state* S, size_t outlen, const void* key, size_t keylen)
+{
+	size_t i;
+
+	if (outlen == 0 || outlen > BLAKE2B_OUTBYTES || keylen > BLAKE2B_KEYBYTES)
+		return -1;
+
+	memset(S, 0, sizeof(*S));
+	S->outlen = outlen;
+	S->keylen = keylen;
+
+	for (i = 0; i < BLAKE2BP_LEAVES; i++) {
+		blake2b_state* L = &S->leaves[i];
+
+		/* The parameter block has the digest length of the tree, but every leaf outputs a full digest */
+		blake2b_init_node(L, outlen, keylen, BLAKE2BP_LEAVES, 2, i, 0, BLAKE2B_OUTBYTES);
+		L->outlen = BLAKE2B_OUTBYTES;
+
+		/* Each leaf hashes the key block before its share of the message */
+		if (keylen > 0) {
+			memcpy(L->buf, key, keylen);
+			L->buflen = BLAKE2B_BLOCKBYTES;
+		}
+	}
+	S->leaves[BLAKE2BP_LEAVES - 1].last_node = 1;
+
+	return 0;
+}
+
+/* Give a leaf its block from each of n_stripes stripes starting at data */
+static void update_leaf(blake2b_state* L, hashstream_blake2b_blocks_fn blocks, const uint8_t* data,
+			size_t n_stripes)
+{
+	/* The block held back now has a successor, so is not the final block */
+	if (L->buflen > 0)
+		blocks(L->h, L->t, L->f, L->buf, 1, BLAKE2B_BLOCKBYTES);
+
+	for (; n_stripes > 1; n_stripes--, data += BLAKE2BP_STRIPEBYTES)
+		blocks(L->h, L->t, L->f, data, 1, BLAKE2B_BLOCKBYTES);
+
+	memcpy(L->buf, data, BLAKE2B_BLOCKBYTES);
+	L->buflen = BLAKE2B_BLOCKBYTES;
+}
+
+/* As update_leaf() for every leaf at once, which keeps the leaves in step */
+static void update_all_leaves(blake2bp_state* S, hashstream_blake2bp_leaves_fn leaves, const uint8_t* data,
+			      size_t n_stripes)
+{
+	uint64_t h[8 * BLAKE2BP_LEAVES], t[2];
+	const uint8_t* blocks[BLAKE2BP_LEAVES];
+	size_t i, j;
+
+	for (j = 0; j < BLAKE2BP_LEAVES; j++) {
+		for (i = 0; i < 8; i++)
+			h[i * BLAKE2BP_LEAVES + j] = S->leaves[j].h[i];
+	}
+	t[0] = S->leaves[0].t[0];
+	t[1] = S->leaves[0].t[1];
+
+	if (S->leaves[0].buflen > 0) {
+		for (j = 0; j < BLAKE2BP_LEAVES; j++)
+			blocks[j] = S->leaves[j].buf;
+		leaves(h, t, blocks, 1, 0);
+	}
+
+	for (j = 0; j < BLAKE2BP_LEAVES; j++)
+		blocks[j] = data + j * BLAKE2B_BLOCKBYTES;
+	leaves(h, t, blocks, n_stripes - 1, BLAKE2BP_STRIPEBYTES);
+
+	for (j = 0; j < BLAKE2BP_LEAVES; j++) {
+		blake2b_state* L = &S->leaves[j];
+
+		for (i = 0; i < 8; i++)
+			L->h[i] = h[i * BLAKE2BP_LEAVES + j];
+		L->t[0] = t[0];
+		L->t[1] = t[1];
+		memcpy(L->buf, blocks[j] + (n_stripes - 1) * BLAKE2BP_STRIPEBYTES, BLAKE2B_BLOCKBYTES);
+		L->buflen = BLAKE2B_BLOCKBYTES;
+	}
+}
+
+void blake2bp_update_leaves(blake2bp_state* S, size_t first, size_t count, const uint8_t* in, size_t n_stripes)
+{
+	const hashstream_kernels* kernels = hashstream_get_kernels();
+	size_t i;
+
+	if (n_stripes == 0)
+		return;
+
+	if (first == 0 && count == BLAKE2BP_LEAVES && kernels->blake2bp_leaves != NULL) {
+		update_all_leaves(S, kernels->blake2bp_leaves, in, n_stripes);
+		return;
+	}
+
+	for (i = first; i < first + count; i++)
+		update_leaf(&S->leaves[i], kernels->blake2b_blocks, in + i * BLAKE2B_BLOCKBYTES, n_stripes);
+}
+
+void blake2bp_update(blake2bp_state* S, const void* in, size_t inlen)
+{
+	const uint8_t* p = (const uint8_t*)in;
+	size_t fill = BLAKE2BP_STRIPEBYTES - S->buflen, n_stripes;
+
+	if (S->buflen > 0) {
+		if (inlen < fill) {
+			memcpy(S->buf + S->buflen, p, inlen);
+			S->buflen += inlen;
+			return;
+		}
+
+		memcpy(S->buf + S->buflen, p, fill);
+		blake2bp_update_leaves(S, 0, BLAKE2BP_LEAVES, S->buf, 1);
+		p += fill;
+		inlen -= fill;
+	}
+
+	n_stripes = inlen / BLAKE2BP_STRIPEBYTES;
+	blake2bp_update_leaves(S, 0, BLAKE2BP_LEAVES, p, n_stripes);
+	p += n_stripes * BLAKE2BP_STRIPEBYTES;
+	inlen -= n_stripes * BLAKE2BP_STRIPEBYTES;
+
+	memcpy(S->buf, p, inlen);
+	S->buflen = inlen;
+}
+
+void blake2bp_final(blake2bp_state* S, uint8_t* out)
+{
+	uint8_t digests[BLAKE2BP_LEAVES][BLAKE2B_OUTBYTES];
+	blake2b_state root;
+	size_t i, left;
+
+	/* The partial stripe is dealt out as the final blocks of the leaves it reaches */
+	for (i = 0; i < BLAKE2BP_LEAVES; i++) {
+		if (S->buflen > i * BLAKE2B_BLOCKBYTES) {
+			left = S->buflen - i * BLAKE2B_BLOCKBYTES;
+			if (left > BLAKE2B_BLOCKBYTES)
+				left = BLAKE2B_BLOCKBYTES;
+			blake2b_update(&S->leaves[i], S->buf + i * BLAKE2B_BLOCKBYTES, left);
+		}
+		blake2b_final(&S->leaves[i], digests[i]);
+	}
+
+	/* The root records the key length, but the key itself is only hashed by the leaves */
+	blake2b_init_node(&root, S->outlen, S->keylen, BLAKE2BP_LEAVES, 2, 0, 1, BLAKE2B_OUTBYTES);
+	root.last_node = 1;
+	blake2b_update(&root, digests, sizeof(digests));
+	blake2b_final(&root, out);
+}
@@ -0,0 +1,188 @@
+/*
+ * BLAKE2s, see blake2.h.
+ *
+ * The compression function is called through the kernel table in
+ * dispatch.h, with blake2s_blocks_generic() below as the portable
+ * fallback.
+ */
+
+#include <string.h>
+
+#include "blake2.h"
+#include "dispatch.h"
+
+static const uint32_t blake2s_IV[8] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+	0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define ROTR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t load32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store32(uint8_t* p, uint32_t v)
+{
+	size_t i;
+
+	for (i = 0; i < 4; i++)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+#define G(r, i, a, b, c, d) do { \
+	a = a + b + m[blake2s_sigma[r][2 * (i) + 0]]; \
+	d = ROTR32(d ^ a, 16); \
+	c = c + d; \
+	b = ROTR32(b ^ c, 12); \
+	a = a + b + m[blake2s_sigma[r][2 * (i) + 1]]; \
+	d = ROTR32(d ^ a, 8); \
+	c = c + d; \
+	b = ROTR32(b ^ c, 7); \
+} while (0)
+
+#define ROUND(r) do { \
+	G(r, 0, v[0], v[4], v[ 8], v[12]); \
+	G(r, 1, v[1], v[5], v[ 9], v[13]); \
+	G(r, 2, v[2], v[6], v[10], v[14]); \
+	G(r, 3, v[3], v[7], v[11], v[15]); \
+	G(r, 4, v[0], v[5], v[10], v[15]); \
+	G(r, 5, v[1], v[6], v[11], v[12]); \
+	G(r, 6, v[2], v[7], v[ 8], v[13]); \
+	G(r, 7, v[3], v[4], v[ 9], v[14]); \
+} while (0)
+
+static void blake2s_compress(uint32_t h[8], const uint32_t t[2], const uint32_t f[2], const uint8_t* block)
+{
+	uint32_t m[16], v[16];
+	size_t i;
+
+	for (i = 0; i < 16; i++)
+		m[i] = load32(block + 4 * i);
+
+	for (i = 0; i < 8; i++) {
+		v[i] = h[i];
+		v[i + 8] = blake2s_IV[i];
+	}
+	v[12] ^= t[0];
+	v[13] ^= t[1];
+	v[14] ^= f[0];
+	v[15] ^= f[1];
+
+	ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4);
+	ROUND(5); ROUND(6); ROUND(7); ROUND(8); ROUND(9);
+
+	for (i = 0; i < 8; i++)
+		h[i] ^= v[i] ^ v[i + 8];
+}
+
+/* Compress whole 512-bit blocks with the portable compression function */
+void blake2s_blocks_generic(uint32_t h[8], uint32_t t[2], const uint32_t f[2],
+			    const uint8_t* data, size_t n_blocks, size_t inc)
+{
+	for (; n_blocks > 0; n_blocks--, data += BLAKE2S_BLOCKBYTES) {
+		t[0] += inc;
+		t[1] += (t[0] < inc);
+		blake2s_compress(h, t, f, data);
+	}
+}
+
+int blake2s_init(blake2s_state* S, size_t outlen)
+{
+	return blake2s_init_key(S, outlen, NULL, 0);
+}
+
+int blake2s_init_key(blake2s_state* S, size_t outlen, const void* key, size_t keylen)
+{
+	if (blake2s_init_node(S, outlen, keylen, 1, 1, 0, 0, 0) != 0)
+		return -1;
+
+	/* The key is hashed as a first block of its own, padded with zeros */
+	if (keylen > 0) {
+		memcpy(S->buf, key, keylen);
+		S->buflen = BLAKE2S_BLOCKBYTES;
+		S->keylen = keylen;
+	}
+
+	return 0;
+}
+
+int blake2s_init_node(blake2s_state* S, size_t outlen, size_t keylen, size_t fanout, size_t depth,
+		      uint64_t node_offset, size_t node_depth, size_t inner_length)
+{
+	if (outlen == 0 || outlen > BLAKE2S_OUTBYTES || keylen > BLAKE2S_KEYBYTES)
+		return -1;
+
+	memset(S, 0, sizeof(*S));
+	memcpy(S->h, blake2s_IV, sizeof(S->h));
+
+	/* The parameter block, less the leaf length, salt and personalisation, which are always zero here */
+	S->h[0] ^= (uint32_t)outlen ^ ((uint32_t)keylen << 8) ^ ((uint32_t)fanout << 16) ^ ((uint32_t)depth << 24);
+	S->h[2] ^= (uint32_t)node_offset;
+	S->h[3] ^= (uint32_t)(node_offset >> 32) ^ ((uint32_t)node_depth << 16) ^ ((uint32_t)inner_length << 24);
+	S->outlen = outlen;
+
+	return 0;
+}
+
+void blake2s_update(blake2s_state* S, const void* in, size_t inlen)
+{
+	const uint8_t* p = (const uint8_t*)in;
+	const hashstream_kernels* kernels;
+	size_t fill = BLAKE2S_BLOCKBYTES - S->buflen, n_blocks;
+
+	if (inlen == 0)
+		return;
+
+	if (inlen <= fill) {
+		memcpy(S->buf + S->buflen, p, inlen);
+		S->buflen += inlen;
+		return;
+	}
+
+	/* There is more input to come after the buffer, so it is not the final block */
+	kernels = hashstream_get_kernels();
+	memcpy(S->buf + S->buflen, p, fill);
+	kernels->blake2s_blocks(S->h, S->t, S->f, S->buf, 1, BLAKE2S_BLOCKBYTES);
+	p += fill;
+	inlen -= fill;
+
+	/* Hold back at least one byte so that the final block is never compressed here */
+	n_blocks = (inlen - 1) / BLAKE2S_BLOCKBYTES;
+	kernels->blake2s_blocks(S->h, S->t, S->f, p, n_blocks, BLAKE2S_BLOCKBYTES);
+	p += n_blocks * BLAKE2S_BLOCKBYTES;
+	inlen -= n_blocks * BLAKE2S_BLOCKBYTES;
+
+	memcpy(S->buf, p, inlen);
+	S->buflen = inlen;
+}
+
+void blake2s_final(blake2s_state* S, uint8_t* out)
+{
+	uint8_t digest[BLAKE2S_OUTBYTES];
+	size_t i;
+
+	S->f[0] = ~(uint32_t)0;
+	if (S->last_node)
+		S->f[1] = ~(uint32_t)0;
+	memset(S->buf + S->buflen, 0, BLAKE2S_BLOCKBYTES - S->buflen);
+	hashstream_get_kernels()->blake2s_blocks(S->h, S->t, S->f, S->buf, 1, S->buflen);
+
+	for (i = 0; i < 8; i++)
+		store32(digest + 4 * i, S->h[i]);
+	memcpy(out, digest, S->outlen);
+}
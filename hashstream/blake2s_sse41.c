@@ -0,0 +1,117 @@
+/*
+ * BLAKE2s compression function using SSE4.1.
+ *
+ * This file is compiled with -msse4.1 and must only be called through
+ * the kernel table, which selects it when the CPU reports SSSE3 and
+ * SSE4.1, see dispatch.c.
+ *
+ * Each row of the 4x4 working state is held in one 128-bit register, so
+ * the four column steps of a round, and then the four diagonal steps,
+ * run together. Rotations by 16 and 8 bits are byte shuffles. The
+ * message words each step needs are inserted into a register one at a
+ * time from a copy of the block.
+ */
+
+#include <string.h>
+
+#include <smmintrin.h>
+
+#include "dispatch.h"
+
+static const uint32_t blake2s_IV[8] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+	0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define ROTR16(x)	_mm_shuffle_epi8((x), r16)
+#define ROTR12(x)	_mm_or_si128(_mm_srli_epi32((x), 12), _mm_slli_epi32((x), 20))
+#define ROTR8(x)	_mm_shuffle_epi8((x), r8)
+#define ROTR7(x)	_mm_or_si128(_mm_srli_epi32((x), 7), _mm_slli_epi32((x), 25))
+
+/* The G function on all four columns, or diagonals, at once */
+#define G(b0, b1) do { \
+	row1 = _mm_add_epi32(_mm_add_epi32(row1, (b0)), row2); \
+	row4 = ROTR16(_mm_xor_si128(row4, row1)); \
+	row3 = _mm_add_epi32(row3, row4); \
+	row2 = ROTR12(_mm_xor_si128(row2, row3)); \
+	row1 = _mm_add_epi32(_mm_add_epi32(row1, (b1)), row2); \
+	row4 = ROTR8(_mm_xor_si128(row4, row1)); \
+	row3 = _mm_add_epi32(row3, row4); \
+	row2 = ROTR7(_mm_xor_si128(row2, row3)); \
+} while (0)
+
+/*
+ * Rotate rows 1, 3 and 4 right by one, two and three words so the
+ * diagonals become columns. Row 2 is the last to be computed by G, so
+ * leaving it in place keeps the shuffles off the critical path. Lane 0
+ * then holds the last diagonal step, so its message words come first.
+ */
+#define DIAGONALIZE() do { \
+	row1 = _mm_shuffle_epi32(row1, _MM_SHUFFLE(2, 1, 0, 3)); \
+	row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(0, 3, 2, 1)); \
+	row4 = _mm_shuffle_epi32(row4, _MM_SHUFFLE(1, 0, 3, 2)); \
+} while (0)
+
+#define UNDIAGONALIZE() do { \
+	row1 = _mm_shuffle_epi32(row1, _MM_SHUFFLE(0, 3, 2, 1)); \
+	row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(2, 1, 0, 3)); \
+	row4 = _mm_shuffle_epi32(row4, _MM_SHUFFLE(1, 0, 3, 2)); \
+} while (0)
+
+#define MSG(r, i0, i1, i2, i3) \
+	_mm_setr_epi32((int)m[blake2s_sigma[r][i0]], (int)m[blake2s_sigma[r][i1]], \
+		       (int)m[blake2s_sigma[r][i2]], (int)m[blake2s_sigma[r][i3]])
+
+#define ROUND(r) do { \
+	G(MSG(r, 0, 2, 4, 6), MSG(r, 1, 3, 5, 7)); \
+	DIAGONALIZE(); \
+	G(MSG(r, 14, 8, 10, 12), MSG(r, 15, 9, 11, 13)); \
+	UNDIAGONALIZE(); \
+} while (0)
+
+void blake2s_blocks_sse41(uint32_t h[8], uint32_t t[2], const uint32_t f[2],
+			  const uint8_t* data, size_t n_blocks, size_t inc)
+{
+	const __m128i r16 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m128i r8 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+	__m128i row1, row2, row3, row4, h0, h1;
+	uint32_t m[16];
+
+	h0 = _mm_loadu_si128((const __m128i*)(h + 0));
+	h1 = _mm_loadu_si128((const __m128i*)(h + 4));
+
+	for (; n_blocks > 0; n_blocks--, data += 64) {
+		t[0] += (uint32_t)inc;
+		t[1] += (t[0] < (uint32_t)inc);
+
+		memcpy(m, data, sizeof(m));
+
+		row1 = h0;
+		row2 = h1;
+		row3 = _mm_loadu_si128((const __m128i*)(blake2s_IV + 0));
+		row4 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(blake2s_IV + 4)),
+				     _mm_setr_epi32((int)t[0], (int)t[1], (int)f[0], (int)f[1]));
+
+		ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4);
+		ROUND(5); ROUND(6); ROUND(7); ROUND(8); ROUND(9);
+
+		h0 = _mm_xor_si128(h0, _mm_xor_si128(row1, row3));
+		h1 = _mm_xor_si128(h1, _mm_xor_si128(row2, row4));
+	}
+
+	_mm_storeu_si128((__m128i*)(h + 0), h0);
+	_mm_storeu_si128((__m128i*)(h + 4), h1);
+}
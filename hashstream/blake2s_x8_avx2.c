@@ -0,0 +1,151 @@
+/*
+ * The eight BLAKE2sp leaves using AVX2, see blake2sp.c.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * Each 256-bit register holds the same 32-bit word of the working state
+ * for all eight leaves, so the rounds are exactly those of
+ * blake2s_compress() in blake2s.c performed on eight lanes at once. As
+ * in blake2b_x4_avx2.c, the leaves share one byte counter and no
+ * finalisation flags.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint32_t blake2s_IV[8] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+	0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define ADD(x, y)	_mm256_add_epi32((x), (y))
+#define XOR(x, y)	_mm256_xor_si256((x), (y))
+
+#define ROTR16(x)	_mm256_shuffle_epi8((x), r16)
+#define ROTR12(x)	_mm256_or_si256(_mm256_srli_epi32((x), 12), _mm256_slli_epi32((x), 20))
+#define ROTR8(x)	_mm256_shuffle_epi8((x), r8)
+#define ROTR7(x)	_mm256_or_si256(_mm256_srli_epi32((x), 7), _mm256_slli_epi32((x), 25))
+
+#define G(r, i, a, b, c, d) do { \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake2s_sigma[r][2 * (i) + 0]]); \
+	v[d] = ROTR16(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR12(XOR(v[b], v[c])); \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake2s_sigma[r][2 * (i) + 1]]); \
+	v[d] = ROTR8(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR7(XOR(v[b], v[c])); \
+} while (0)
+
+#define ROUND(r) do { \
+	G(r, 0, 0, 4,  8, 12); \
+	G(r, 1, 1, 5,  9, 13); \
+	G(r, 2, 2, 6, 10, 14); \
+	G(r, 3, 3, 7, 11, 15); \
+	G(r, 4, 0, 5, 10, 15); \
+	G(r, 5, 1, 6, 11, 12); \
+	G(r, 6, 2, 7,  8, 13); \
+	G(r, 7, 3, 4,  9, 14); \
+} while (0)
+
+/* Load eight words at offset from each leaf's block and transpose them into m[0..7] */
+static void load_words(__m256i* m, const uint8_t* const* data, size_t offset)
+{
+	__m256i r0, r1, r2, r3, r4, r5, r6, r7;
+	__m256i t0, t1, t2, t3, t4, t5, t6, t7;
+
+	r0 = _mm256_loadu_si256((const __m256i*)(data[0] + offset));
+	r1 = _mm256_loadu_si256((const __m256i*)(data[1] + offset));
+	r2 = _mm256_loadu_si256((const __m256i*)(data[2] + offset));
+	r3 = _mm256_loadu_si256((const __m256i*)(data[3] + offset));
+	r4 = _mm256_loadu_si256((const __m256i*)(data[4] + offset));
+	r5 = _mm256_loadu_si256((const __m256i*)(data[5] + offset));
+	r6 = _mm256_loadu_si256((const __m256i*)(data[6] + offset));
+	r7 = _mm256_loadu_si256((const __m256i*)(data[7] + offset));
+
+	t0 = _mm256_unpacklo_epi32(r0, r1);
+	t1 = _mm256_unpackhi_epi32(r0, r1);
+	t2 = _mm256_unpacklo_epi32(r2, r3);
+	t3 = _mm256_unpackhi_epi32(r2, r3);
+	t4 = _mm256_unpacklo_epi32(r4, r5);
+	t5 = _mm256_unpackhi_epi32(r4, r5);
+	t6 = _mm256_unpacklo_epi32(r6, r7);
+	t7 = _mm256_unpackhi_epi32(r6, r7);
+
+	r0 = _mm256_unpacklo_epi64(t0, t2);
+	r1 = _mm256_unpackhi_epi64(t0, t2);
+	r2 = _mm256_unpacklo_epi64(t1, t3);
+	r3 = _mm256_unpackhi_epi64(t1, t3);
+	r4 = _mm256_unpacklo_epi64(t4, t6);
+	r5 = _mm256_unpackhi_epi64(t4, t6);
+	r6 = _mm256_unpacklo_epi64(t5, t7);
+	r7 = _mm256_unpackhi_epi64(t5, t7);
+
+	m[0] = _mm256_permute2x128_si256(r0, r4, 0x20);
+	m[1] = _mm256_permute2x128_si256(r1, r5, 0x20);
+	m[2] = _mm256_permute2x128_si256(r2, r6, 0x20);
+	m[3] = _mm256_permute2x128_si256(r3, r7, 0x20);
+	m[4] = _mm256_permute2x128_si256(r0, r4, 0x31);
+	m[5] = _mm256_permute2x128_si256(r1, r5, 0x31);
+	m[6] = _mm256_permute2x128_si256(r2, r6, 0x31);
+	m[7] = _mm256_permute2x128_si256(r3, r7, 0x31);
+}
+
+void blake2s_x8_avx2(uint32_t* h, uint32_t t[2], const uint8_t* const* data, size_t n_blocks, size_t stride)
+{
+	const __m256i r16 = _mm256_setr_epi8(
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m256i r8 = _mm256_setr_epi8(
+		1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+		1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+	const uint8_t* p[8];
+	__m256i hv[8], v[16], m[16];
+	size_t offset;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		hv[i] = _mm256_loadu_si256((const __m256i*)(h + 8 * i));
+
+	for (offset = 0; n_blocks > 0; n_blocks--, offset += stride) {
+		t[0] += 64;
+		t[1] += (t[0] < 64);
+
+		for (i = 0; i < 8; i++)
+			p[i] = data[i] + offset;
+		load_words(m + 0, p, 0);
+		load_words(m + 8, p, 32);
+
+		for (i = 0; i < 8; i++) {
+			v[i] = hv[i];
+			v[i + 8] = _mm256_set1_epi32((int)blake2s_IV[i]);
+		}
+		v[12] = XOR(v[12], _mm256_set1_epi32((int)t[0]));
+		v[13] = XOR(v[13], _mm256_set1_epi32((int)t[1]));
+
+		ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4);
+		ROUND(5); ROUND(6); ROUND(7); ROUND(8); ROUND(9);
+
+		for (i = 0; i < 8; i++)
+			hv[i] = XOR(hv[i], XOR(v[i], v[i + 8]));
+	}
+
+	for (i = 0; i < 8; i++)
+		_mm256_storeu_si256((__m256i*)(h + 8 * i), hv[i]);
+}
@@ -0,0 +1,570 @@
+/*
+ * BLAKE3, see blake3.h.
+ *
+ * Whole chunks, and whole layers of parent nodes, are compressed through
+ * the blake3_hash_many kernel in dispatch.h, which takes up to
+ * blake3_simd_degree inputs at once. blake3_hash_many_generic() below is
+ * the portable fallback. The remaining compressions, of the chunk being
+ * absorbed and of the output blocks, are few and always portable.
+ */
+
+#include <string.h>
+
+#include "blake3.h"
+#include "dispatch.h"
+
+/* The most inputs any blake3_hash_many kernel takes at once */
+#define MAX_SIMD_DEGREE		8
+
+static const uint32_t blake3_IV[8] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+	0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL
+};
+
+static const uint8_t blake3_schedule[7][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{  2,  6,  3, 10,  7,  0,  4, 13,  1, 11, 12,  5,  9, 14, 15,  8 },
+	{  3,  4, 10, 12, 13,  2,  7, 14,  6,  5,  9,  0, 11, 15,  8,  1 },
+	{ 10,  7, 12,  9, 14,  3, 13, 15,  4,  0, 11,  2,  5,  8,  1,  6 },
+	{ 12, 13,  9, 11, 15, 10, 14,  8,  7,  2,  5,  3,  0,  1,  6,  4 },
+	{  9, 14, 11,  5,  8, 12, 15,  1, 13,  3,  0, 10,  2,  6,  4,  7 },
+	{ 11, 15,  5,  0,  1,  9,  8,  6, 14, 10,  2, 12,  3,  4,  7, 13 }
+};
+
+#define ROTR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t load32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store32(uint8_t* p, uint32_t v)
+{
+	size_t i;
+
+	for (i = 0; i < 4; i++)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void load_key_words(const uint8_t key[BLAKE3_KEY_LEN], uint32_t words[8])
+{
+	size_t i;
+
+	for (i = 0; i < 8; i++)
+		words[i] = load32(key + 4 * i);
+}
+
+static void store_cv_words(uint8_t out[BLAKE3_OUT_LEN], const uint32_t cv[8])
+{
+	size_t i;
+
+	for (i = 0; i < 8; i++)
+		store32(out + 4 * i, cv[i]);
+}
+
+#define G(r, i, a, b, c, d) do { \
+	a = a + b + m[blake3_schedule[r][2 * (i) + 0]]; \
+	d = ROTR32(d ^ a, 16); \
+	c = c + d; \
+	b = ROTR32(b ^ c, 12); \
+	a = a + b + m[blake3_schedule[r][2 * (i) + 1]]; \
+	d = ROTR32(d ^ a, 8); \
+	c = c + d; \
+	b = ROTR32(b ^ c, 7); \
+} while (0)
+
+#define ROUND(r) do { \
+	G(r, 0, v[0], v[4], v[ 8], v[12]); \
+	G(r, 1, v[1], v[5], v[ 9], v[13]); \
+	G(r, 2, v[2], v[6], v[10], v[14]); \
+	G(r, 3, v[3], v[7], v[11], v[15]); \
+	G(r, 4, v[0], v[5], v[10], v[15]); \
+	G(r, 5, v[1], v[6], v[11], v[12]); \
+	G(r, 6, v[2], v[7], v[ 8], v[13]); \
+	G(r, 7, v[3], v[4], v[ 9], v[14]); \
+} while (0)
+
+/* Run the rounds over one block, leaving the working state in v */
+static void blake3_compress(uint32_t v[16], const uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN],
+			    uint8_t block_len, uint64_t counter, uint8_t flags)
+{
+	uint32_t m[16];
+	size_t i;
+
+	for (i = 0; i < 16; i++)
+		m[i] = load32(block + 4 * i);
+
+	for (i = 0; i < 8; i++)
+		v[i] = cv[i];
+	for (i = 0; i < 4; i++)
+		v[i + 8] = blake3_IV[i];
+	v[12] = (uint32_t)counter;
+	v[13] = (uint32_t)(counter >> 32);
+	v[14] = block_len;
+	v[15] = flags;
+
+	ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4); ROUND(5); ROUND(6);
+}
+
+static void compress_in_place(uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len,
+			      uint64_t counter, uint8_t flags)
+{
+	uint32_t v[16];
+	size_t i;
+
+	blake3_compress(v, cv, block, block_len, counter, flags);
+	for (i = 0; i < 8; i++)
+		cv[i] = v[i] ^ v[i + 8];
+}
+
+/* The full 64 bytes of output of a compression, as used by the root */
+static void compress_xof(const uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len,
+			 uint64_t counter, uint8_t flags, uint8_t out[64])
+{
+	uint32_t v[16];
+	size_t i;
+
+	blake3_compress(v, cv, block, block_len, counter, flags);
+	for (i = 0; i < 8; i++) {
+		store32(out + 4 * i, v[i] ^ v[i + 8]);
+		store32(out + 4 * (i + 8), v[i + 8] ^ cv[i]);
+	}
+}
+
+void blake3_hash_many_generic(const uint8_t* const* inputs, size_t num_inputs, size_t blocks,
+			      const uint32_t key[8], uint64_t counter, int increment_counter, uint8_t flags,
+			      uint8_t flags_start, uint8_t flags_end, uint8_t* out)
+{
+	uint32_t cv[8];
+	uint8_t block_flags;
+	size_t i, j;
+
+	for (i = 0; i < num_inputs; i++, out += BLAKE3_OUT_LEN) {
+		memcpy(cv, key, sizeof(cv));
+		block_flags = flags | flags_start;
+		for (j = 0; j < blocks; j++) {
+			if (j + 1 == blocks)
+				block_flags |= flags_end;
+			compress_in_place(cv, inputs[i] + j * BLAKE3_BLOCK_LEN, BLAKE3_BLOCK_LEN, counter, block_flags);
+			block_flags = flags;
+		}
+		store_cv_words(out, cv);
+
+		if (increment_counter)
+			counter++;
+	}
+}
+
+/*
+ * The inputs to the final compression of a node, from which either its
+ * chaining value or, for the root, any amount of output is produced.
+ */
+typedef struct {
+	uint32_t	input_cv[8];
+	uint64_t	counter;
+	uint8_t		block[BLAKE3_BLOCK_LEN];
+	uint8_t		block_len;
+	uint8_t		flags;
+} blake3_output;
+
+static blake3_output make_output(const uint32_t input_cv[8], const uint8_t block[BLAKE3_BLOCK_LEN],
+				 uint8_t block_len, uint64_t counter, uint8_t flags)
+{
+	blake3_output o;
+
+	memcpy(o.input_cv, input_cv, sizeof(o.input_cv));
+	memcpy(o.block, block, sizeof(o.block));
+	o.block_len = block_len;
+	o.counter = counter;
+	o.flags = flags;
+	return o;
+}
+
+static void output_chaining_value(const blake3_output* o, uint8_t cv[BLAKE3_OUT_LEN])
+{
+	uint32_t words[8];
+
+	memcpy(words, o->input_cv, sizeof(words));
+	compress_in_place(words, o->block, o->block_len, o->counter, o->flags);
+	store_cv_words(cv, words);
+}
+
+/* Output block i of the root is its final compression with the counter set to i */
+static void output_root_bytes(const blake3_output* o, uint64_t seek, uint8_t* out, size_t out_len)
+{
+	uint64_t block_counter = seek / 64;
+	size_t offset = (size_t)(seek % 64), n;
+	uint8_t wide[64];
+
+	while (out_len > 0) {
+		compress_xof(o->input_cv, o->block, o->block_len, block_counter, o->flags | BLAKE3_ROOT, wide);
+		n = 64 - offset;
+		if (n > out_len)
+			n = out_len;
+		memcpy(out, wide + offset, n);
+		out += n;
+		out_len -= n;
+		block_counter++;
+		offset = 0;
+	}
+}
+
+static blake3_output parent_output(const uint8_t block[BLAKE3_BLOCK_LEN], const uint32_t key[8], uint8_t flags)
+{
+	return make_output(key, block, BLAKE3_BLOCK_LEN, 0, flags | BLAKE3_PARENT);
+}
+
+void blake3_parent_cv(const uint32_t key[8], uint8_t flags, const uint8_t children[2 * BLAKE3_OUT_LEN],
+		      uint8_t out[BLAKE3_OUT_LEN])
+{
+	blake3_output o = parent_output(children, key, flags);
+	output_chaining_value(&o, out);
+}
+
+/* Chunk state */
+
+static void chunk_state_init(blake3_chunk_state* self, const uint32_t key[8], uint8_t flags)
+{
+	memcpy(self->cv, key, sizeof(self->cv));
+	self->chunk_counter = 0;
+	memset(self->buf, 0, sizeof(self->buf));
+	self->buf_len = 0;
+	self->blocks_compressed = 0;
+	self->flags = flags;
+}
+
+static void chunk_state_reset(blake3_chunk_state* self, const uint32_t key[8], uint64_t chunk_counter)
+{
+	chunk_state_init(self, key, self->flags);
+	self->chunk_counter = chunk_counter;
+}
+
+static size_t chunk_state_len(const blake3_chunk_state* self)
+{
+	return BLAKE3_BLOCK_LEN * (size_t)self->blocks_compressed + self->buf_len;
+}
+
+static size_t chunk_state_fill_buf(blake3_chunk_state* self, const uint8_t* input, size_t input_len)
+{
+	size_t take = BLAKE3_BLOCK_LEN - self->buf_len;
+
+	if (take > input_len)
+		take = input_len;
+	memcpy(self->buf + self->buf_len, input, take);
+	self->buf_len += (uint8_t)take;
+	return take;
+}
+
+static uint8_t chunk_state_start_flag(const blake3_chunk_state* self)
+{
+	return self->blocks_compressed == 0 ? BLAKE3_CHUNK_START : 0;
+}
+
+/* The latest block of a chunk is held back in buf in case it is the chunk's last */
+static void chunk_state_update(blake3_chunk_state* self, const uint8_t* input, size_t input_len)
+{
+	size_t take;
+
+	if (self->buf_len > 0) {
+		take = chunk_state_fill_buf(self, input, input_len);
+		input += take;
+		input_len -= take;
+		if (input_len > 0) {
+			compress_in_place(self->cv, self->buf, BLAKE3_BLOCK_LEN, self->chunk_counter,
+					  self->flags | chunk_state_start_flag(self));
+			self->blocks_compressed++;
+			self->buf_len = 0;
+			memset(self->buf, 0, sizeof(self->buf));
+		}
+	}
+
+	for (; input_len > BLAKE3_BLOCK_LEN; input += BLAKE3_BLOCK_LEN, input_len -= BLAKE3_BLOCK_LEN) {
+		compress_in_place(self->cv, input, BLAKE3_BLOCK_LEN, self->chunk_counter,
+				  self->flags | chunk_state_start_flag(self));
+		self->blocks_compressed++;
+	}
+
+	chunk_state_fill_buf(self, input, input_len);
+}
+
+static blake3_output chunk_state_output(const blake3_chunk_state* self)
+{
+	return make_output(self->cv, self->buf, self->buf_len, self->chunk_counter,
+			   self->flags | chunk_state_start_flag(self) | BLAKE3_CHUNK_END);
+}
+
+/* Subtrees */
+
+static size_t round_down_to_power_of_2(uint64_t x)
+{
+	uint64_t p = 1;
+
+	while (p <= x / 2)
+		p *= 2;
+	return (size_t)p;
+}
+
+static unsigned int popcount(uint64_t x)
+{
+	unsigned int n = 0;
+
+	for (; x != 0; x &= x - 1)
+		n++;
+	return n;
+}
+
+/* The left subtree of input_len bytes holds the largest power of two number of chunks leaving some over */
+static size_t left_subtree_len(size_t input_len)
+{
+	return round_down_to_power_of_2((input_len - 1) / BLAKE3_CHUNK_LEN) * BLAKE3_CHUNK_LEN;
+}
+
+/* Compress up to MAX_SIMD_DEGREE chunks, the last of which may be partial, to their chaining values */
+static size_t compress_chunks_parallel(const hashstream_kernels* kernels, const uint8_t* input, size_t input_len,
+				       const uint32_t key[8], uint64_t chunk_counter, uint8_t flags, uint8_t* out)
+{
+	const uint8_t* chunks[MAX_SIMD_DEGREE];
+	size_t n = 0;
+	blake3_chunk_state chunk;
+	blake3_output o;
+
+	for (; input_len - n * BLAKE3_CHUNK_LEN >= BLAKE3_CHUNK_LEN; n++)
+		chunks[n] = input + n * BLAKE3_CHUNK_LEN;
+
+	kernels->blake3_hash_many(chunks, n, BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN, key, chunk_counter, 1, flags,
+				  BLAKE3_CHUNK_START, BLAKE3_CHUNK_END, out);
+
+	if (input_len == n * BLAKE3_CHUNK_LEN)
+		return n;
+
+	chunk_state_init(&chunk, key, flags);
+	chunk.chunk_counter = chunk_counter + n;
+	chunk_state_update(&chunk, input + n * BLAKE3_CHUNK_LEN, input_len - n * BLAKE3_CHUNK_LEN);
+	o = chunk_state_output(&chunk);
+	output_chaining_value(&o, out + n * BLAKE3_OUT_LEN);
+	return n + 1;
+}
+
+/* Compress pairs of chaining values to their parents, passing any odd one out through */
+static size_t compress_parents_parallel(const hashstream_kernels* kernels, const uint8_t* cvs, size_t num_cvs,
+					const uint32_t key[8], uint8_t flags, uint8_t* out)
+{
+	const uint8_t* parents[MAX_SIMD_DEGREE];
+	size_t n = 0;
+
+	for (; num_cvs - 2 * n >= 2; n++)
+		parents[n] = cvs + 2 * n * BLAKE3_OUT_LEN;
+
+	kernels->blake3_hash_many(parents, n, 1, key, 0, 0, flags | BLAKE3_PARENT, 0, 0, out);
+
+	if (num_cvs == 2 * n)
+		return n;
+
+	memcpy(out + n * BLAKE3_OUT_LEN, cvs + 2 * n * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+	return n + 1;
+}
+
+/*
+ * Compress the subtree of input_len bytes to as many chaining values as
+ * the kernel takes inputs at once, but at least two, so that every layer
+ * of parents is compressed a kernel's width at a time. Returns the
+ * number of chaining values written to out.
+ */
+static size_t compress_subtree_wide(const hashstream_kernels* kernels, const uint8_t* input, size_t input_len,
+				    const uint32_t key[8], uint64_t chunk_counter, uint8_t flags, uint8_t* out)
+{
+	uint8_t cvs[2 * MAX_SIMD_DEGREE * BLAKE3_OUT_LEN];
+	size_t degree = kernels->blake3_simd_degree, left_len, left_n, right_n;
+
+	if (input_len <= degree * BLAKE3_CHUNK_LEN)
+		return compress_chunks_parallel(kernels, input, input_len, key, chunk_counter, flags, out);
+
+	left_len = left_subtree_len(input_len);
+
+	/* With a one-input kernel, still return two chaining values for anything more than a chunk */
+	if (degree == 1 && left_len > BLAKE3_CHUNK_LEN)
+		degree = 2;
+
+	left_n = compress_subtree_wide(kernels, input, left_len, key, chunk_counter, flags, cvs);
+	right_n = compress_subtree_wide(kernels, input + left_len, input_len - left_len, key,
+					chunk_counter + left_len / BLAKE3_CHUNK_LEN, flags, cvs + degree * BLAKE3_OUT_LEN);
+
+	if (left_n == 1) {
+		memcpy(out, cvs, 2 * BLAKE3_OUT_LEN);
+		return 2;
+	}
+
+	return compress_parents_parallel(kernels, cvs, left_n + right_n, key, flags, out);
+}
+
+void blake3_compress_subtree(void* arg, const uint32_t key[8], uint8_t flags, const uint8_t* input,
+			     size_t input_len, uint64_t chunk_counter, uint8_t out[2 * BLAKE3_OUT_LEN])
+{
+	const hashstream_kernels* kernels = hashstream_get_kernels();
+	uint8_t cvs[MAX_SIMD_DEGREE * BLAKE3_OUT_LEN], parents[MAX_SIMD_DEGREE / 2 * BLAKE3_OUT_LEN];
+	size_t n;
+
+	(void)arg;
+
+	n = compress_subtree_wide(kernels, input, input_len, key, chunk_counter, flags, cvs);
+	while (n > 2) {
+		n = compress_parents_parallel(kernels, cvs, n, key, flags, parents);
+		memcpy(cvs, parents, n * BLAKE3_OUT_LEN);
+	}
+	memcpy(out, cvs, 2 * BLAKE3_OUT_LEN);
+}
+
+/* The whole message */
+
+static void init_state(blake3_state* self, const uint32_t key[8], uint8_t flags)
+{
+	memcpy(self->key, key, sizeof(self->key));
+	chunk_state_init(&self->chunk, key, flags);
+	self->cv_stack_len = 0;
+}
+
+void blake3_init(blake3_state* self)
+{
+	init_state(self, blake3_IV, 0);
+}
+
+void blake3_init_key(blake3_state* self, const uint8_t key[BLAKE3_KEY_LEN])
+{
+	uint32_t words[8];
+
+	load_key_words(key, words);
+	init_state(self, words, BLAKE3_KEYED_HASH);
+}
+
+/*
+ * Merge the stack down to one entry per 1 bit in total_chunks, the
+ * number of chunks so far. The stack is only merged when more input
+ * arrives, so that the latest entries may yet form the root.
+ */
+static void merge_cv_stack(blake3_state* self, uint64_t total_chunks)
+{
+	size_t post_merge_len = popcount(total_chunks);
+	uint8_t* parent;
+
+	while (self->cv_stack_len > post_merge_len) {
+		parent = self->cv_stack + (self->cv_stack_len - 2) * BLAKE3_OUT_LEN;
+		blake3_parent_cv(self->key, self->chunk.flags, parent, parent);
+		self->cv_stack_len--;
+	}
+}
+
+static void push_cv(blake3_state* self, const uint8_t cv[BLAKE3_OUT_LEN], uint64_t chunk_counter)
+{
+	merge_cv_stack(self, chunk_counter);
+	memcpy(self->cv_stack + self->cv_stack_len * BLAKE3_OUT_LEN, cv, BLAKE3_OUT_LEN);
+	self->cv_stack_len++;
+}
+
+void blake3_update(blake3_state* self, const void* input, size_t input_len)
+{
+	blake3_update_split(self, input, input_len, 0, NULL, NULL);
+}
+
+void blake3_update_split(blake3_state* self, const void* input, size_t input_len,
+				size_t min_subtree_len, blake3_subtree_fn subtree_fn, void* arg)
+{
+	const uint8_t* p = (const uint8_t*)input;
+	size_t take, subtree_len;
+	uint64_t subtree_chunks;
+	uint8_t cv_pair[2 * BLAKE3_OUT_LEN];
+	blake3_chunk_state chunk;
+	blake3_output o;
+
+	if (input_len == 0)
+		return;
+
+	/* Finish any partial chunk first, but only push it once it is known not to be the last */
+	if (chunk_state_len(&self->chunk) > 0) {
+		take = BLAKE3_CHUNK_LEN - chunk_state_len(&self->chunk);
+		if (take > input_len)
+			take = input_len;
+		chunk_state_update(&self->chunk, p, take);
+		p += take;
+		input_len -= take;
+		if (input_len == 0)
+			return;
+
+		o = chunk_state_output(&self->chunk);
+		output_chaining_value(&o, cv_pair);
+		push_cv(self, cv_pair, self->chunk.chunk_counter);
+		chunk_state_reset(&self->chunk, self->key, self->chunk.chunk_counter + 1);
+	}
+
+	/*
+	 * Then hash the largest complete subtrees which the input allows and
+	 * whose position in the message lets them stand alone, keeping back
+	 * at least the last chunk.
+	 */
+	while (input_len > BLAKE3_CHUNK_LEN) {
+		subtree_len = round_down_to_power_of_2(input_len);
+		while (((uint64_t)(subtree_len - 1) & (self->chunk.chunk_counter * BLAKE3_CHUNK_LEN)) != 0)
+			subtree_len /= 2;
+		subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+
+		if (subtree_len <= BLAKE3_CHUNK_LEN) {
+			chunk_state_init(&chunk, self->key, self->chunk.flags);
+			chunk.chunk_counter = self->chunk.chunk_counter;
+			chunk_state_update(&chunk, p, subtree_len);
+			o = chunk_state_output(&chunk);
+			output_chaining_value(&o, cv_pair);
+			push_cv(self, cv_pair, chunk.chunk_counter);
+		} else {
+			if (subtree_fn != NULL && subtree_len >= min_subtree_len)
+				subtree_fn(arg, self->key, self->chunk.flags, p, subtree_len, self->chunk.chunk_counter, cv_pair);
+			else
+				blake3_compress_subtree(NULL, self->key, self->chunk.flags, p, subtree_len,
+							self->chunk.chunk_counter, cv_pair);
+			push_cv(self, cv_pair, self->chunk.chunk_counter);
+			push_cv(self, cv_pair + BLAKE3_OUT_LEN, self->chunk.chunk_counter + subtree_chunks / 2);
+		}
+
+		self->chunk.chunk_counter += subtree_chunks;
+		p += subtree_len;
+		input_len -= subtree_len;
+	}
+
+	if (input_len > 0) {
+		chunk_state_update(&self->chunk, p, input_len);
+		merge_cv_stack(self, self->chunk.chunk_counter);
+	}
+}
+
+void blake3_final_seek(const blake3_state* self, uint64_t seek, uint8_t* out, size_t out_len)
+{
+	uint8_t parent[BLAKE3_BLOCK_LEN];
+	blake3_output o;
+	size_t remaining;
+
+	if (out_len == 0)
+		return;
+
+	/* A message of at most one chunk is its own root */
+	if (self->cv_stack_len == 0) {
+		o = chunk_state_output(&self->chunk);
+		output_root_bytes(&o, seek, out, out_len);
+		return;
+	}
+
+	/* Otherwise merge the whole stack, right to left, with the root the last merge */
+	if (chunk_state_len(&self->chunk) > 0) {
+		remaining = self->cv_stack_len;
+		o = chunk_state_output(&self->chunk);
+	} else {
+		remaining = self->cv_stack_len - 2;
+		o = parent_output(self->cv_stack + remaining * BLAKE3_OUT_LEN, self->key, self->chunk.flags);
+	}
+
+	while (remaining > 0) {
+		remaining--;
+		memcpy(parent, self->cv_stack + remaining * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+		output_chaining_value(&o, parent + BLAKE3_OUT_LEN);
+		o = parent_output(parent, self->key, self->chunk.flags);
+	}
+
+	output_root_bytes(&o, seek, out, out_len);
+}
@@ -0,0 +1,102 @@
+/*
+ * BLAKE3.
+ *
+ * The message is split into 1 KiB chunks, each hashed independently,
+ * and the chunk chaining values are combined by a binary tree of parent
+ * nodes. Many chunks, and then many parents, are compressed at once in
+ * the lanes of a SIMD kernel where the CPU allows, and large complete
+ * subtrees of the tree may be handed to other threads. The output may be
+ * extended to any length.
+ */
+
+#ifndef __BLAKE3_H
+#define __BLAKE3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLAKE3_KEY_LEN		32
+#define BLAKE3_OUT_LEN		32
+#define BLAKE3_BLOCK_LEN	64
+#define BLAKE3_CHUNK_LEN	1024
+
+/* Enough chaining values for a message of 2^64 bytes, and one more */
+#define BLAKE3_MAX_DEPTH	54
+
+/* Domain separation flags */
+#define BLAKE3_CHUNK_START		0x01
+#define BLAKE3_CHUNK_END		0x02
+#define BLAKE3_PARENT			0x04
+#define BLAKE3_ROOT			0x08
+#define BLAKE3_KEYED_HASH		0x10
+#define BLAKE3_DERIVE_KEY_CONTEXT	0x20
+#define BLAKE3_DERIVE_KEY_MATERIAL	0x40
+
+/* The chunk currently being absorbed */
+typedef struct {
+	uint32_t	cv[8];
+	uint64_t	chunk_counter;
+	uint8_t		buf[BLAKE3_BLOCK_LEN];
+	uint8_t		buf_len;
+	uint8_t		blocks_compressed;
+	uint8_t		flags;
+} blake3_chunk_state;
+
+/*
+ * The chaining values of complete subtrees not yet merged are kept on
+ * cv_stack, at most one per level of the tree. The latest of them are
+ * only merged once more input arrives, since the root must be
+ * compressed differently.
+ */
+typedef struct {
+	uint32_t		key[8];
+	blake3_chunk_state	chunk;
+	uint8_t			cv_stack_len;
+	uint8_t			cv_stack[(BLAKE3_MAX_DEPTH + 1) * BLAKE3_OUT_LEN];
+} blake3_state;
+
+/*
+ * Compress the complete subtree of input_len bytes at input, whose first
+ * chunk is chunk number chunk_counter of the message, to the chaining
+ * values of its two children, written to out. input_len must be a power
+ * of two number of chunks, at least two, and chunk_counter a multiple of
+ * that number.
+ */
+typedef void (*blake3_subtree_fn)(void* arg, const uint32_t key[8], uint8_t flags, const uint8_t* input,
+				  size_t input_len, uint64_t chunk_counter, uint8_t out[2 * BLAKE3_OUT_LEN]);
+
+void blake3_init(blake3_state* self);
+void blake3_init_key(blake3_state* self, const uint8_t key[BLAKE3_KEY_LEN]);
+void blake3_update(blake3_state* self, const void* input, size_t input_len);
+
+/*
+ * As blake3_update(), but passing each complete subtree of at
+ * least min_subtree_len bytes to subtree_fn, which may share the work
+ * between threads using the functions below.
+ */
+void blake3_update_split(blake3_state* self, const void* input, size_t input_len,
+				size_t min_subtree_len, blake3_subtree_fn subtree_fn, void* arg);
+
+/*
+ * Write out_len bytes of output, starting seek bytes in, without
+ * modifying self. The first BLAKE3_OUT_LEN bytes are the digest.
+ */
+void blake3_final_seek(const blake3_state* self, uint64_t seek, uint8_t* out, size_t out_len);
+
+/* The default blake3_subtree_fn, which uses the calling thread only */
+void blake3_compress_subtree(void* arg, const uint32_t key[8], uint8_t flags, const uint8_t* input,
+			     size_t input_len, uint64_t chunk_counter, uint8_t out[2 * BLAKE3_OUT_LEN]);
+
+/* Write the chaining value of the parent of the two chaining values at children to out */
+void blake3_parent_cv(const uint32_t key[8], uint8_t flags, const uint8_t children[2 * BLAKE3_OUT_LEN],
+		      uint8_t out[BLAKE3_OUT_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLAKE3_H */
@@ -0,0 +1,173 @@
+/*
+ * BLAKE3 chunks and parents eight at a time using AVX2, see blake3.c.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * As blake3_sse41.c, but with eight inputs to a 256-bit register. Any
+ * inputs left over once the rest have been taken eight at a time are
+ * hashed by blake3_hash_many_generic().
+ */
+
+#include <immintrin.h>
+
+#include "blake3.h"
+#include "dispatch.h"
+
+static const uint32_t blake3_IV[4] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL
+};
+
+static const uint8_t blake3_schedule[7][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{  2,  6,  3, 10,  7,  0,  4, 13,  1, 11, 12,  5,  9, 14, 15,  8 },
+	{  3,  4, 10, 12, 13,  2,  7, 14,  6,  5,  9,  0, 11, 15,  8,  1 },
+	{ 10,  7, 12,  9, 14,  3, 13, 15,  4,  0, 11,  2,  5,  8,  1,  6 },
+	{ 12, 13,  9, 11, 15, 10, 14,  8,  7,  2,  5,  3,  0,  1,  6,  4 },
+	{  9, 14, 11,  5,  8, 12, 15,  1, 13,  3,  0, 10,  2,  6,  4,  7 },
+	{ 11, 15,  5,  0,  1,  9,  8,  6, 14, 10,  2, 12,  3,  4,  7, 13 }
+};
+
+#define ADD(x, y)	_mm256_add_epi32((x), (y))
+#define XOR(x, y)	_mm256_xor_si256((x), (y))
+
+#define ROTR16(x)	_mm256_shuffle_epi8((x), r16)
+#define ROTR12(x)	_mm256_or_si256(_mm256_srli_epi32((x), 12), _mm256_slli_epi32((x), 20))
+#define ROTR8(x)	_mm256_shuffle_epi8((x), r8)
+#define ROTR7(x)	_mm256_or_si256(_mm256_srli_epi32((x), 7), _mm256_slli_epi32((x), 25))
+
+#define G(r, i, a, b, c, d) do { \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake3_schedule[r][2 * (i) + 0]]); \
+	v[d] = ROTR16(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR12(XOR(v[b], v[c])); \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake3_schedule[r][2 * (i) + 1]]); \
+	v[d] = ROTR8(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR7(XOR(v[b], v[c])); \
+} while (0)
+
+#define ROUND(r) do { \
+	G(r, 0, 0, 4,  8, 12); \
+	G(r, 1, 1, 5,  9, 13); \
+	G(r, 2, 2, 6, 10, 14); \
+	G(r, 3, 3, 7, 11, 15); \
+	G(r, 4, 0, 5, 10, 15); \
+	G(r, 5, 1, 6, 11, 12); \
+	G(r, 6, 2, 7,  8, 13); \
+	G(r, 7, 3, 4,  9, 14); \
+} while (0)
+
+/* Transpose the eight rows of words in r, in place, so that r[i] holds word i of each row */
+static void transpose(__m256i* r)
+{
+	__m256i t0, t1, t2, t3, t4, t5, t6, t7;
+	__m256i u0, u1, u2, u3, u4, u5, u6, u7;
+
+	t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+	t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+	t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+	t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+	t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+	t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+	t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+	t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+	u0 = _mm256_unpacklo_epi64(t0, t2);
+	u1 = _mm256_unpackhi_epi64(t0, t2);
+	u2 = _mm256_unpacklo_epi64(t1, t3);
+	u3 = _mm256_unpackhi_epi64(t1, t3);
+	u4 = _mm256_unpacklo_epi64(t4, t6);
+	u5 = _mm256_unpackhi_epi64(t4, t6);
+	u6 = _mm256_unpacklo_epi64(t5, t7);
+	u7 = _mm256_unpackhi_epi64(t5, t7);
+
+	r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+/* Load eight words at offset from each input and transpose them into m[0..7] */
+static void load_words(__m256i* m, const uint8_t* const* inputs, size_t offset)
+{
+	size_t j;
+
+	for (j = 0; j < 8; j++)
+		m[j] = _mm256_loadu_si256((const __m256i*)(inputs[j] + offset));
+	transpose(m);
+}
+
+static void hash8(const uint8_t* const* inputs, size_t blocks, const uint32_t key[8], uint64_t counter,
+		  int increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end, uint8_t* out)
+{
+	const __m256i r16 = _mm256_setr_epi8(
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+		2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m256i r8 = _mm256_setr_epi8(
+		1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+		1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+	uint32_t lo[8], hi[8];
+	__m256i h[8], v[16], m[16], counter_lo, counter_hi;
+	uint8_t block_flags = flags | flags_start;
+	size_t i, b;
+	uint64_t c;
+
+	for (i = 0; i < 8; i++) {
+		c = counter + (increment_counter ? i : 0);
+		lo[i] = (uint32_t)c;
+		hi[i] = (uint32_t)(c >> 32);
+	}
+	counter_lo = _mm256_loadu_si256((const __m256i*)lo);
+	counter_hi = _mm256_loadu_si256((const __m256i*)hi);
+
+	for (i = 0; i < 8; i++)
+		h[i] = _mm256_set1_epi32((int)key[i]);
+
+	for (b = 0; b < blocks; b++) {
+		if (b + 1 == blocks)
+			block_flags |= flags_end;
+
+		load_words(m + 0, inputs, b * BLAKE3_BLOCK_LEN + 0);
+		load_words(m + 8, inputs, b * BLAKE3_BLOCK_LEN + 32);
+
+		for (i = 0; i < 8; i++)
+			v[i] = h[i];
+		for (i = 0; i < 4; i++)
+			v[i + 8] = _mm256_set1_epi32((int)blake3_IV[i]);
+		v[12] = counter_lo;
+		v[13] = counter_hi;
+		v[14] = _mm256_set1_epi32(BLAKE3_BLOCK_LEN);
+		v[15] = _mm256_set1_epi32(block_flags);
+
+		ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4); ROUND(5); ROUND(6);
+
+		for (i = 0; i < 8; i++)
+			h[i] = XOR(v[i], v[i + 8]);
+		block_flags = flags;
+	}
+
+	/* Back from one word of every lane per register to one lane per 32 bytes of output */
+	transpose(h);
+	for (i = 0; i < 8; i++)
+		_mm256_storeu_si256((__m256i*)(out + i * BLAKE3_OUT_LEN), h[i]);
+}
+
+void blake3_hash_many_avx2(const uint8_t* const* inputs, size_t num_inputs, size_t blocks,
+			   const uint32_t key[8], uint64_t counter, int increment_counter, uint8_t flags,
+			   uint8_t flags_start, uint8_t flags_end, uint8_t* out)
+{
+	for (; num_inputs >= 8; num_inputs -= 8, inputs += 8, out += 8 * BLAKE3_OUT_LEN) {
+		hash8(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+		if (increment_counter)
+			counter += 8;
+	}
+
+	blake3_hash_many_generic(inputs, num_inputs, blocks, key, counter, increment_counter, flags,
+				 flags_start, flags_end, out);
+}
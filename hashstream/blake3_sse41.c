@@ -0,0 +1,158 @@
+/*
+ * BLAKE3 chunks and parents four at a time using SSE4.1, see blake3.c.
+ *
+ * This file is compiled with -msse4.1 and must only be called through
+ * the kernel table, which selects it when the CPU reports SSSE3 and
+ * SSE4.1, see dispatch.c.
+ *
+ * Each 128-bit register holds the same 32-bit word of the working state
+ * for four inputs, so the rounds are exactly those of blake3_compress()
+ * in blake3.c performed on four lanes at once. Rotations by 16 and 8
+ * bits are byte shuffles. Any inputs left over once the rest have been
+ * taken four at a time are hashed by blake3_hash_many_generic().
+ */
+
+#include <smmintrin.h>
+
+#include "blake3.h"
+#include "dispatch.h"
+
+static const uint32_t blake3_IV[4] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL
+};
+
+static const uint8_t blake3_schedule[7][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{  2,  6,  3, 10,  7,  0,  4, 13,  1, 11, 12,  5,  9, 14, 15,  8 },
+	{  3,  4, 10, 12, 13,  2,  7, 14,  6,  5,  9,  0, 11, 15,  8,  1 },
+	{ 10,  7, 12,  9, 14,  3, 13, 15,  4,  0, 11,  2,  5,  8,  1,  6 },
+	{ 12, 13,  9, 11, 15, 10, 14,  8,  7,  2,  5,  3,  0,  1,  6,  4 },
+	{  9, 14, 11,  5,  8, 12, 15,  1, 13,  3,  0, 10,  2,  6,  4,  7 },
+	{ 11, 15,  5,  0,  1,  9,  8,  6, 14, 10,  2, 12,  3,  4,  7, 13 }
+};
+
+#define ADD(x, y)	_mm_add_epi32((x), (y))
+#define XOR(x, y)	_mm_xor_si128((x), (y))
+
+#define ROTR16(x)	_mm_shuffle_epi8((x), r16)
+#define ROTR12(x)	_mm_or_si128(_mm_srli_epi32((x), 12), _mm_slli_epi32((x), 20))
+#define ROTR8(x)	_mm_shuffle_epi8((x), r8)
+#define ROTR7(x)	_mm_or_si128(_mm_srli_epi32((x), 7), _mm_slli_epi32((x), 25))
+
+#define G(r, i, a, b, c, d) do { \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake3_schedule[r][2 * (i) + 0]]); \
+	v[d] = ROTR16(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR12(XOR(v[b], v[c])); \
+	v[a] = ADD(ADD(v[a], v[b]), m[blake3_schedule[r][2 * (i) + 1]]); \
+	v[d] = ROTR8(XOR(v[d], v[a])); \
+	v[c] = ADD(v[c], v[d]); \
+	v[b] = ROTR7(XOR(v[b], v[c])); \
+} while (0)
+
+#define ROUND(r) do { \
+	G(r, 0, 0, 4,  8, 12); \
+	G(r, 1, 1, 5,  9, 13); \
+	G(r, 2, 2, 6, 10, 14); \
+	G(r, 3, 3, 7, 11, 15); \
+	G(r, 4, 0, 5, 10, 15); \
+	G(r, 5, 1, 6, 11, 12); \
+	G(r, 6, 2, 7,  8, 13); \
+	G(r, 7, 3, 4,  9, 14); \
+} while (0)
+
+/* Transpose the four rows of words in r, in place, so that r[i] holds word i of each row */
+static void transpose(__m128i* r)
+{
+	__m128i t0, t1, t2, t3;
+
+	t0 = _mm_unpacklo_epi32(r[0], r[1]);
+	t1 = _mm_unpackhi_epi32(r[0], r[1]);
+	t2 = _mm_unpacklo_epi32(r[2], r[3]);
+	t3 = _mm_unpackhi_epi32(r[2], r[3]);
+
+	r[0] = _mm_unpacklo_epi64(t0, t2);
+	r[1] = _mm_unpackhi_epi64(t0, t2);
+	r[2] = _mm_unpacklo_epi64(t1, t3);
+	r[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+/* Load four words at offset from each input and transpose them into m[0..3] */
+static void load_words(__m128i* m, const uint8_t* const* inputs, size_t offset)
+{
+	size_t j;
+
+	for (j = 0; j < 4; j++)
+		m[j] = _mm_loadu_si128((const __m128i*)(inputs[j] + offset));
+	transpose(m);
+}
+
+static void hash4(const uint8_t* const* inputs, size_t blocks, const uint32_t key[8], uint64_t counter,
+		  int increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end, uint8_t* out)
+{
+	const __m128i r16 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+	const __m128i r8 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+	uint32_t lo[4], hi[4];
+	__m128i h[8], v[16], m[16], counter_lo, counter_hi;
+	uint8_t block_flags = flags | flags_start;
+	size_t i, b;
+	uint64_t c;
+
+	for (i = 0; i < 4; i++) {
+		c = counter + (increment_counter ? i : 0);
+		lo[i] = (uint32_t)c;
+		hi[i] = (uint32_t)(c >> 32);
+	}
+	counter_lo = _mm_loadu_si128((const __m128i*)lo);
+	counter_hi = _mm_loadu_si128((const __m128i*)hi);
+
+	for (i = 0; i < 8; i++)
+		h[i] = _mm_set1_epi32((int)key[i]);
+
+	for (b = 0; b < blocks; b++) {
+		if (b + 1 == blocks)
+			block_flags |= flags_end;
+
+		load_words(m + 0, inputs, b * BLAKE3_BLOCK_LEN + 0);
+		load_words(m + 4, inputs, b * BLAKE3_BLOCK_LEN + 16);
+		load_words(m + 8, inputs, b * BLAKE3_BLOCK_LEN + 32);
+		load_words(m + 12, inputs, b * BLAKE3_BLOCK_LEN + 48);
+
+		for (i = 0; i < 8; i++)
+			v[i] = h[i];
+		for (i = 0; i < 4; i++)
+			v[i + 8] = _mm_set1_epi32((int)blake3_IV[i]);
+		v[12] = counter_lo;
+		v[13] = counter_hi;
+		v[14] = _mm_set1_epi32(BLAKE3_BLOCK_LEN);
+		v[15] = _mm_set1_epi32(block_flags);
+
+		ROUND(0); ROUND(1); ROUND(2); ROUND(3); ROUND(4); ROUND(5); ROUND(6);
+
+		for (i = 0; i < 8; i++)
+			h[i] = XOR(v[i], v[i + 8]);
+		block_flags = flags;
+	}
+
+	/* Back from one word of every lane per register to one lane per 32 bytes of output */
+	transpose(h + 0);
+	transpose(h + 4);
+	for (i = 0; i < 4; i++) {
+		_mm_storeu_si128((__m128i*)(out + i * BLAKE3_OUT_LEN + 0), h[i]);
+		_mm_storeu_si128((__m128i*)(out + i * BLAKE3_OUT_LEN + 16), h[i + 4]);
+	}
+}
+
+void blake3_hash_many_sse41(const uint8_t* const* inputs, size_t num_inputs, size_t blocks,
+			    const uint32_t key[8], uint64_t counter, int increment_counter, uint8_t flags,
+			    uint8_t flags_start, uint8_t flags_end, uint8_t* out)
+{
+	for (; num_inputs >= 4; num_inputs -= 4, inputs += 4, out += 4 * BLAKE3_OUT_LEN) {
+		hash4(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+		if (increment_counter)
+			counter += 4;
+	}
+
+	blake3_hash_many_generic(inputs, num_inputs, blocks, key, counter, increment_counter, flags,
+				 flags_start, flags_end, out);
+}
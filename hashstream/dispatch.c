@@ -0,0 +1,286 @@
+/*
+ * Runtime selection of hash function kernels, see dispatch.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "dispatch.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HASHSTREAM_X86 1
+#include <cpuid.h>
+
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static unsigned int cpuid_max_leaf(void)
+{
+	return __get_cpuid_max(0, 0);
+}
+
+static uint64_t xgetbv0(void)
+{
+	uint32_t lo, hi;
+	__asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define HASHSTREAM_X86 1
+#include <intrin.h>
+
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+}
+
+static unsigned int cpuid_max_leaf(void)
+{
+	unsigned int regs[4];
+	cpuid(0, 0, regs);
+	return regs[0];
+}
+
+static uint64_t xgetbv0(void)
+{
+	return _xgetbv(0);
+}
+
+#endif
+
+/*
+ * The feature set and the kernel table are written once, by resolve(),
+ * under a once-only guard which also publishes them to every thread that
+ * later passes through it. Nothing reads them without doing so first.
+ */
+static unsigned int		cpu_features;
+static hashstream_kernels	kernels;
+
+static unsigned int detect_cpu_features(void)
+{
+	unsigned int features = 0;
+#ifdef HASHSTREAM_X86
+	unsigned int regs[4], max_leaf = cpuid_max_leaf();
+
+	if (max_leaf < 1)
+		return 0;
+
+	cpuid(1, 0, regs);
+	if (regs[3] & (1u << 26))
+		features |= HASHSTREAM_CPU_SSE2;
+	if (regs[2] & (1u << 9))
+		features |= HASHSTREAM_CPU_SSSE3;
+	if (regs[2] & (1u << 19))
+		features |= HASHSTREAM_CPU_SSE41;
+
+	/* AVX needs the OS to save the ymm registers on context switch */
+	if ((regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && ((xgetbv0() & 0x6) == 0x6))
+		features |= HASHSTREAM_CPU_AVX;
+
+	if (max_leaf >= 7) {
+		cpuid(7, 0, regs);
+		if ((features & HASHSTREAM_CPU_AVX) && (regs[1] & (1u << 5)))
+			features |= HASHSTREAM_CPU_AVX2;
+		if (regs[1] & (1u << 8))
+			features |= HASHSTREAM_CPU_BMI2;
+		if (regs[1] & (1u << 29))
+			features |= HASHSTREAM_CPU_SHA;
+	}
+#endif
+	return features;
+}
+
+static unsigned int disabled_cpu_features(void)
+{
+	static const struct {
+		const char*	name;
+		unsigned int	flag;
+	} names[] = {
+		{ "sse2",	HASHSTREAM_CPU_SSE2 },
+		{ "ssse3",	HASHSTREAM_CPU_SSSE3 },
+		{ "sse4.1",	HASHSTREAM_CPU_SSE41 },
+		{ "avx",	HASHSTREAM_CPU_AVX },
+		{ "avx2",	HASHSTREAM_CPU_AVX2 },
+		{ "bmi2",	HASHSTREAM_CPU_BMI2 },
+		{ "sha",	HASHSTREAM_CPU_SHA },
+		{ "all",	~0u },
+	};
+	const char* s = getenv("HASHSTREAM_CPU_DISABLE");
+	unsigned int disabled = 0;
+	size_t i, len;
+
+	while (s != NULL && *s != '\0') {
+		len = strcspn(s, ",");
+		for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+			if (strlen(names[i].name) == len && strncmp(names[i].name, s, len) == 0)
+				disabled |= names[i].flag;
+		}
+		s += len;
+		if (*s == ',')
+			s++;
+	}
+
+	return disabled;
+}
+
+static int has_features(unsigned int features, unsigned int required)
+{
+	return (features & required) == required;
+}
+
+static void resolve_kernels(unsigned int features)
+{
+	hashstream_kernels k;
+
+	k.md5_blocks = md5_blocks_generic;
+	k.sha1_blocks = sha1_blocks_generic;
+	k.sha256_blocks = sha256_blocks_generic;
+	k.sha512_blocks = sha512_blocks_generic;
+	k.blake2b_blocks = blake2b_blocks_generic;
+	k.blake2s_blocks = blake2s_blocks_generic;
+	k.blake3_hash_many = blake3_hash_many_generic;
+	k.blake3_simd_degree = 1;
+	k.md5_lanes = NULL;
+	k.md5_lane_count = 0;
+	k.sha1_lanes = NULL;
+	k.sha1_lane_count = 0;
+	k.sha256_lanes = NULL;
+	k.sha256_lane_count = 0;
+	k.sha512_lanes = NULL;
+	k.sha512_lane_count = 0;
+	k.blake2bp_leaves = NULL;
+	k.blake2sp_leaves = NULL;
+	k.keccak_lanes = NULL;
+	k.keccak_lane_count = 0;
+
+#ifdef HASHSTREAM_HAVE_SSE2
+	if (has_features(features, HASHSTREAM_CPU_SSE2)) {
+		k.md5_lanes = md5_x4_sse2;
+		k.md5_lane_count = 4;
+	}
+#endif
+
+#ifdef HASHSTREAM_HAVE_SSE41
+	if (has_features(features, HASHSTREAM_CPU_SSSE3 | HASHSTREAM_CPU_SSE41)) {
+		k.blake2b_blocks = blake2b_blocks_sse41;
+		k.blake2s_blocks = blake2s_blocks_sse41;
+		k.blake3_hash_many = blake3_hash_many_sse41;
+		k.blake3_simd_degree = 4;
+	}
+#endif
+
+#ifdef HASHSTREAM_HAVE_SHA_SHANI
+	if (has_features(features, HASHSTREAM_CPU_SSSE3 | HASHSTREAM_CPU_SSE41 | HASHSTREAM_CPU_SHA)) {
+		k.sha1_blocks = sha1_blocks_shani;
+		k.sha256_blocks = sha256_blocks_shani;
+	}
+#endif
+
+#ifdef HASHSTREAM_HAVE_AVX2
+	if (has_features(features, HASHSTREAM_CPU_AVX2)) {
+		k.md5_lanes = md5_x8_avx2;
+		k.md5_lane_count = 8;
+	}
+
+	/*
+	 * Eight SHA-1 lanes outrun even SHA-NI, whose SHA-1 rounds are
+	 * bound by latency. Eight SHA-256 lanes outrun the scalar transform
+	 * several times over, but not SHA-NI, so prefer the latter there.
+	 */
+	if (has_features(features, HASHSTREAM_CPU_AVX2)) {
+		k.sha1_lanes = sha1_x8_avx2;
+		k.sha1_lane_count = 8;
+	}
+
+	if (has_features(features, HASHSTREAM_CPU_AVX2) && k.sha256_blocks == sha256_blocks_generic) {
+		k.sha256_lanes = sha256_x8_avx2;
+		k.sha256_lane_count = 8;
+	}
+
+	if (has_features(features, HASHSTREAM_CPU_AVX2)) {
+		k.sha512_lanes = sha512_x4_avx2;
+		k.sha512_lane_count = 4;
+	}
+
+	/* Single streams, where the rounds are scalar code using rorx */
+	if (has_features(features, HASHSTREAM_CPU_AVX2 | HASHSTREAM_CPU_BMI2) && k.sha256_blocks == sha256_blocks_generic)
+		k.sha256_blocks = sha256_blocks_avx2;
+
+	if (has_features(features, HASHSTREAM_CPU_AVX2 | HASHSTREAM_CPU_BMI2))
+		k.sha512_blocks = sha512_blocks_avx2;
+
+	if (has_features(features, HASHSTREAM_CPU_AVX2))
+		k.blake2b_blocks = blake2b_blocks_avx2;
+
+	/* The leaves of the BLAKE2 parallel modes, one per lane */
+	if (has_features(features, HASHSTREAM_CPU_AVX2)) {
+		k.blake2bp_leaves = blake2b_x4_avx2;
+		k.blake2sp_leaves = blake2s_x8_avx2;
+	}
+
+	if (has_features(features, HASHSTREAM_CPU_AVX2)) {
+		k.blake3_hash_many = blake3_hash_many_avx2;
+		k.blake3_simd_degree = 8;
+	}
+
+	if (has_features(features, HASHSTREAM_CPU_AVX2)) {
+		k.keccak_lanes = keccak_x4_avx2;
+		k.keccak_lane_count = 4;
+	}
+#endif
+
+	kernels = k;
+}
+
+static void resolve(void)
+{
+	cpu_features = detect_cpu_features() & ~disabled_cpu_features();
+	resolve_kernels(cpu_features);
+}
+
+#ifdef _WIN32
+static INIT_ONCE resolve_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK resolve_once_callback(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	(void)once;
+	(void)param;
+	(void)context;
+	resolve();
+	return TRUE;
+}
+
+static void ensure_resolved(void)
+{
+	InitOnceExecuteOnce(&resolve_once, resolve_once_callback, NULL, NULL);
+}
+#else
+static pthread_once_t resolve_once = PTHREAD_ONCE_INIT;
+
+static void ensure_resolved(void)
+{
+	pthread_once(&resolve_once, resolve);
+}
+#endif
+
+unsigned int hashstream_cpu_features(void)
+{
+	ensure_resolved();
+	return cpu_features;
+}
+
+const hashstream_kernels* hashstream_get_kernels(void)
+{
+	ensure_resolved();
+	return &kernels;
+}
@@ -0,0 +1,184 @@
+/*
+ * Runtime selection of hash function kernels.
+ *
+ * The block functions of each hash function are called through a table
+ * of function pointers which is resolved once, on first use or at
+ * program startup where the compiler supports it, according to the
+ * features of the CPU the library is running on. This allows a single
+ * binary to make use of instruction set extensions where they are
+ * present while falling back to portable C elsewhere.
+ *
+ * Individual features may be masked out by setting the
+ * HASHSTREAM_CPU_DISABLE environment variable to a comma-separated list
+ * of feature names (sse2, ssse3, sse4.1, avx, avx2, bmi2, sha) or to
+ * "all". This is intended for testing and benchmarking.
+ */
+
+#ifndef __HASHSTREAM_DISPATCH_H
+#define __HASHSTREAM_DISPATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CPU features which kernels may make use of */
+#define HASHSTREAM_CPU_SSE2	0x0001
+#define HASHSTREAM_CPU_SSSE3	0x0002
+#define HASHSTREAM_CPU_SSE41	0x0004
+#define HASHSTREAM_CPU_AVX	0x0008
+#define HASHSTREAM_CPU_AVX2	0x0010
+#define HASHSTREAM_CPU_BMI2	0x0020
+#define HASHSTREAM_CPU_SHA	0x0040
+
+/* Return the set of HASHSTREAM_CPU_* features usable on this machine */
+unsigned int hashstream_cpu_features(void);
+
+/*
+ * Block functions: each processes n_blocks consecutive whole blocks from
+ * data, updating the chaining variables in state.
+ */
+typedef void (*hashstream_md5_blocks_fn)(uint32_t abcd[4], const uint8_t* data, size_t n_blocks);
+typedef void (*hashstream_sha1_blocks_fn)(uint32_t state[5], const uint8_t* data, size_t n_blocks);
+typedef void (*hashstream_sha256_blocks_fn)(uint32_t state[8], const uint8_t* data, size_t n_blocks);
+typedef void (*hashstream_sha512_blocks_fn)(uint64_t state[8], const uint8_t* data, size_t n_blocks);
+
+/*
+ * BLAKE2 block functions: before compressing each block, the byte
+ * counter t is advanced by inc, which is the block length for all but
+ * the final block. The finalisation flags f are applied to every block,
+ * so they are only set when compressing the final block alone.
+ */
+typedef void (*hashstream_blake2b_blocks_fn)(uint64_t h[8], uint64_t t[2], const uint64_t f[2],
+					     const uint8_t* data, size_t n_blocks, size_t inc);
+typedef void (*hashstream_blake2s_blocks_fn)(uint32_t h[8], uint32_t t[2], const uint32_t f[2],
+					     const uint8_t* data, size_t n_blocks, size_t inc);
+
+/*
+ * BLAKE2bp and BLAKE2sp leaf functions: each compresses n_blocks blocks
+ * into every leaf of the tree at once, one leaf per lane. Lane j reads
+ * its blocks from data[j] at intervals of stride bytes. The chaining
+ * variables are interleaved as for the multi-buffer functions below.
+ * The leaves are always compressed in step, so they share the byte
+ * counter t, and none of the blocks may be a final block.
+ */
+typedef void (*hashstream_blake2bp_leaves_fn)(uint64_t* h, uint64_t t[2], const uint8_t* const* data,
+					      size_t n_blocks, size_t stride);
+typedef void (*hashstream_blake2sp_leaves_fn)(uint32_t* h, uint32_t t[2], const uint8_t* const* data,
+					      size_t n_blocks, size_t stride);
+
+/*
+ * BLAKE3 many-input function: compresses each of num_inputs inputs of
+ * blocks 64-byte blocks, starting from the chaining value key, and
+ * writes the 32-byte chaining values one after another to out. Every
+ * block is compressed with flags, the first of each input also with
+ * flags_start and the last also with flags_end. Input i has counter
+ * counter + i if increment_counter is set, otherwise counter.
+ */
+typedef void (*hashstream_blake3_many_fn)(const uint8_t* const* inputs, size_t num_inputs, size_t blocks,
+					  const uint32_t key[8], uint64_t counter, int increment_counter,
+					  uint8_t flags, uint8_t flags_start, uint8_t flags_end, uint8_t* out);
+
+/*
+ * Keccak multi-buffer function: XORs one block of rate bytes from each
+ * blocks[j] into the sponge state of lane j, then applies
+ * Keccak-f[1600] to every lane. The lanes are interleaved as for the
+ * multi-buffer functions below and held plain, unlike those of
+ * sha3_state. See sha3_many() in sha3.c.
+ */
+typedef void (*hashstream_keccak_lanes_fn)(uint64_t* state, const uint8_t* const* blocks, size_t rate);
+
+/* The same, independent of the number of chaining variables */
+typedef void (*hashstream_blocks32_fn)(uint32_t* state, const uint8_t* data, size_t n_blocks);
+typedef void (*hashstream_blocks64_fn)(uint64_t* state, const uint8_t* data, size_t n_blocks);
+
+/*
+ * Multi-buffer block functions: each processes one block from each of
+ * several independent messages, one per lane. The chaining variables
+ * of the lanes are interleaved so that state[i * lanes + j] is word i
+ * of lane j. See multibuf.h.
+ */
+typedef void (*hashstream_lanes32_fn)(uint32_t* state, const uint8_t* const* blocks);
+typedef void (*hashstream_lanes64_fn)(uint64_t* state, const uint8_t* const* blocks);
+
+typedef struct {
+	hashstream_md5_blocks_fn	md5_blocks;
+	hashstream_sha1_blocks_fn	sha1_blocks;
+	hashstream_sha256_blocks_fn	sha256_blocks;
+	hashstream_sha512_blocks_fn	sha512_blocks;
+	hashstream_blake2b_blocks_fn	blake2b_blocks;
+	hashstream_blake2s_blocks_fn	blake2s_blocks;
+
+	/* BLAKE3 chunks and parents, blake3_simd_degree inputs at a time at best */
+	hashstream_blake3_many_fn	blake3_hash_many;
+	unsigned int			blake3_simd_degree;
+
+	/* Multi-buffer kernels, NULL where none is usable */
+	hashstream_lanes32_fn		md5_lanes;
+	unsigned int			md5_lane_count;
+	hashstream_lanes32_fn		sha1_lanes;
+	unsigned int			sha1_lane_count;
+	hashstream_lanes32_fn		sha256_lanes;
+	unsigned int			sha256_lane_count;
+	hashstream_lanes64_fn		sha512_lanes;
+	unsigned int			sha512_lane_count;
+	hashstream_blake2bp_leaves_fn	blake2bp_leaves;
+	hashstream_blake2sp_leaves_fn	blake2sp_leaves;
+	hashstream_keccak_lanes_fn	keccak_lanes;
+	unsigned int			keccak_lane_count;
+} hashstream_kernels;
+
+/* Return the kernels selected for this machine */
+const hashstream_kernels* hashstream_get_kernels(void);
+
+/* Portable C kernels, always available */
+void md5_blocks_generic(uint32_t abcd[4], const uint8_t* data, size_t n_blocks);
+void sha1_blocks_generic(uint32_t state[5], const uint8_t* data, size_t n_blocks);
+void sha256_blocks_generic(uint32_t state[8], const uint8_t* data, size_t n_blocks);
+void sha512_blocks_generic(uint64_t state[8], const uint8_t* data, size_t n_blocks);
+void blake2b_blocks_generic(uint64_t h[8], uint64_t t[2], const uint64_t f[2],
+			    const uint8_t* data, size_t n_blocks, size_t inc);
+void blake2s_blocks_generic(uint32_t h[8], uint32_t t[2], const uint32_t f[2],
+			    const uint8_t* data, size_t n_blocks, size_t inc);
+void blake3_hash_many_generic(const uint8_t* const* inputs, size_t num_inputs, size_t blocks,
+			      const uint32_t key[8], uint64_t counter, int increment_counter, uint8_t flags,
+			      uint8_t flags_start, uint8_t flags_end, uint8_t* out);
+
+/*
+ * Kernels using instruction set extensions. These are only built where
+ * the compiler supports the extension, as signalled by the
+ * corresponding HASHSTREAM_HAVE_* macro, and are only selected where the
+ * CPU does.
+ */
+void md5_x4_sse2(uint32_t* state, const uint8_t* const* blocks);
+void md5_x8_avx2(uint32_t* state, const uint8_t* const* blocks);
+void sha1_x8_avx2(uint32_t* state, const uint8_t* const* blocks);
+void sha1_blocks_shani(uint32_t state[5], const uint8_t* data, size_t n_blocks);
+void sha256_blocks_shani(uint32_t state[8], const uint8_t* data, size_t n_blocks);
+void sha256_blocks_avx2(uint32_t state[8], const uint8_t* data, size_t n_blocks);
+void sha256_x8_avx2(uint32_t* state, const uint8_t* const* blocks);
+void sha512_blocks_avx2(uint64_t state[8], const uint8_t* data, size_t n_blocks);
+void sha512_x4_avx2(uint64_t* state, const uint8_t* const* blocks);
+void blake2b_blocks_sse41(uint64_t h[8], uint64_t t[2], const uint64_t f[2],
+			  const uint8_t* data, size_t n_blocks, size_t inc);
+void blake2b_blocks_avx2(uint64_t h[8], uint64_t t[2], const uint64_t f[2],
+			 const uint8_t* data, size_t n_blocks, size_t inc);
+void blake2s_blocks_sse41(uint32_t h[8], uint32_t t[2], const uint32_t f[2],
+			  const uint8_t* data, size_t n_blocks, size_t inc);
+void blake2b_x4_avx2(uint64_t* h, uint64_t t[2], const uint8_t* const* data, size_t n_blocks, size_t stride);
+void blake2s_x8_avx2(uint32_t* h, uint32_t t[2], const uint8_t* const* data, size_t n_blocks, size_t stride);
+void blake3_hash_many_sse41(const uint8_t* const* inputs, size_t num_inputs, size_t blocks,
+			    const uint32_t key[8], uint64_t counter, int increment_counter, uint8_t flags,
+			    uint8_t flags_start, uint8_t flags_end, uint8_t* out);
+void blake3_hash_many_avx2(const uint8_t* const* inputs, size_t num_inputs, size_t blocks,
+			   const uint32_t key[8], uint64_t counter, int increment_counter, uint8_t flags,
+			   uint8_t flags_start, uint8_t flags_end, uint8_t* out);
+void keccak_x4_avx2(uint64_t* state, const uint8_t* const* blocks, size_t rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HASHSTREAM_DISPATCH_H */
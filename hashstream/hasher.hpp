@@ -0,0 +1,908 @@
+#ifndef __HASHER_HPP
+#define __HASHER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/array.hpp>
+
+// Aladdin licensed MD5 implementation, see md5.c
+#include "md5.h"
+
+// Steve Reid's public domain implementation, see sha1.c
+#include "sha1.h"
+
+// Aaron D. Gifford's sha2 implementation, BSD licensed, see sha2.c
+#include "sha2.h"
+
+// BLAKE2b and BLAKE2s, see blake2b.c and blake2s.c
+#include "blake2.h"
+
+// BLAKE3, see blake3.c
+#include "blake3.h"
+
+// SHA-3 and SHAKE, see sha3.c
+#include "sha3.h"
+
+namespace hashstream
+{
+    /// @addtogroup hash
+    /// @{
+
+    /// @brief Serialise the intermediate state of a hash function.
+    ///
+    /// The serialised form is versioned and portable between machines: all multi-byte values are written
+    /// in big-endian byte order. It records \p algorithm_tag, the chaining variables, the total number of
+    /// message bytes absorbed and any message bytes not yet processed.
+    ///
+    /// @param algorithm_tag A value uniquely identifying the hash function.
+    /// @param word_bytes The size of each chaining variable in bytes, either 4 or 8.
+    /// @param words The chaining variables.
+    /// @param n_words The number of chaining variables.
+    /// @param n_bytes The total number of message bytes absorbed.
+    /// @param pending Message bytes which have been absorbed but not yet processed.
+    /// @param n_pending The number of bytes pointed to by \p pending.
+    ///
+    /// @return The serialised state.
+    std::vector<uint8_t> encode_hash_state(uint8_t algorithm_tag, size_t word_bytes,
+                                           const uint64_t* words, size_t n_words,
+                                           uint64_t n_bytes, const uint8_t* pending, size_t n_pending);
+
+    /// @brief Parse the intermediate state of a hash function serialised by encode_hash_state().
+    ///
+    /// @param state The serialised state.
+    /// @param algorithm_tag The expected algorithm tag.
+    /// @param word_bytes The expected size of each chaining variable in bytes.
+    /// @param words Where to write the chaining variables.
+    /// @param n_words The expected number of chaining variables.
+    /// @param n_bytes Where to write the total number of message bytes absorbed.
+    /// @param n_pending Where to write the number of message bytes not yet processed.
+    ///
+    /// @return A pointer within \p state to the *n_pending message bytes not yet processed.
+    ///
+    /// @throw std::invalid_argument if \p state is malformed or does not match the expected algorithm.
+    const uint8_t* decode_hash_state(const std::vector<uint8_t>& state, uint8_t algorithm_tag,
+                                     size_t word_bytes, uint64_t* words, size_t n_words,
+                                     uint64_t* n_bytes, size_t* n_pending);
+
+    /// @brief Compile-time descriptions of the standard hash functions for use with basic_hasher.
+    ///
+    /// Each algorithm is a struct providing a context_type typedef, block_length and digest_length
+    /// constants and static init(), update() and final() member functions operating on a context_type.
+    ///
+    /// For saving and restoring state, each also provides state_tag, state_word_bytes and state_word_count
+    /// constants along with static get_state() and set_state() member functions. get_state() extracts the
+    /// chaining variables and returns the number of message bytes absorbed, the unprocessed tail of which
+    /// is given by pending_bytes() and is pending_length() bytes long. set_state() is the inverse.
+    ///
+    /// The BLAKE2 functions take a digest length and an optional key. Their init() selects the longest
+    /// digest and no key, and they also provide a static init_key() member function choosing both. Their
+    /// final() writes only as many bytes as the digest length chosen.
+    ///
+    /// The BLAKE2 parallel modes, blake2bp and blake2sp, have a block_length of one stripe: a block for
+    /// each of their leaf_count leaves. They provide a static update_leaves() member function updating
+    /// some of the leaves only, so that the leaves may be shared between threads, but do not support
+    /// saving and restoring state.
+    ///
+    /// BLAKE3 has a block_length of one chunk. Its init_key() takes a key of exactly key_length bytes and
+    /// its output may be extended to any length with final_seek(). It provides a static update_split()
+    /// member function handing large subtrees of the message to a callback, so that they may be shared
+    /// between threads. It does not support saving and restoring state.
+    ///
+    /// The SHA-3 and SHAKE functions are instances of the keccak template, with a block_length of the sponge
+    /// rate. The output of all of them may be continued past the digest with squeeze(), although only that
+    /// of the SHAKE functions is intended for use.
+    namespace algorithm
+    {
+        /// @brief The MD5 hash function.
+        struct md5
+        {
+            typedef md5_state_t context_type;
+            static const size_t block_length = 64;
+            static const size_t digest_length = 16;
+
+            static void init(context_type* ctx)
+            {
+                md5_init(ctx);
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                // md5_append() takes an int length, so it is only given the bytes either side of the whole
+                // blocks, which go straight to md5_transform_blocks()
+                size_t head((block_length - ((ctx->count[0] >> 3) % block_length)) % block_length);
+                if(head > n_bytes)
+                    head = n_bytes;
+                md5_append(ctx, bytes, static_cast<int>(head));
+                bytes += head;
+                n_bytes -= head;
+
+                const size_t n_blocks(n_bytes / block_length);
+                md5_transform_blocks(ctx, bytes, n_blocks);
+                bytes += n_blocks * block_length;
+                md5_append(ctx, bytes, static_cast<int>(n_bytes % block_length));
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                md5_finish(ctx, digest);
+            }
+
+            static const uint8_t state_tag = 1;
+            static const size_t state_word_bytes = 4;
+            static const size_t state_word_count = 4;
+
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    words[i] = ctx.abcd[i];
+                return ((uint64_t(ctx.count[1]) << 32) | ctx.count[0]) >> 3;
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buf;
+            }
+
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return static_cast<size_t>(n_bytes % block_length);
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    ctx->abcd[i] = static_cast<md5_word_t>(words[i]);
+                ctx->count[0] = static_cast<md5_word_t>(n_bytes << 3);
+                ctx->count[1] = static_cast<md5_word_t>(n_bytes >> 29);
+                memcpy(ctx->buf, pending, n_pending);
+            }
+        };
+
+        /// @brief The SHA-1 hash function.
+        struct sha1
+        {
+            typedef SHA1_CTX context_type;
+            static const size_t block_length = 64;
+            static const size_t digest_length = SHA1_DIGEST_SIZE;
+
+            static void init(context_type* ctx)
+            {
+                SHA1_Init(ctx);
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                SHA1_Update(ctx, bytes, n_bytes);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                SHA1_Final(ctx, digest);
+            }
+
+            static const uint8_t state_tag = 2;
+            static const size_t state_word_bytes = 4;
+            static const size_t state_word_count = 5;
+
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    words[i] = ctx.state[i];
+                return ((uint64_t(ctx.count[1]) << 32) | ctx.count[0]) >> 3;
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buffer;
+            }
+
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return static_cast<size_t>(n_bytes % block_length);
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    ctx->state[i] = static_cast<uint32_t>(words[i]);
+                ctx->count[0] = static_cast<uint32_t>(n_bytes << 3);
+                ctx->count[1] = static_cast<uint32_t>(n_bytes >> 29);
+                memcpy(ctx->buffer, pending, n_pending);
+            }
+        };
+
+        /// @brief The SHA-256 variant of SHA-2.
+        struct sha256
+        {
+            typedef SHA256_CTX context_type;
+            static const size_t block_length = SHA256_BLOCK_LENGTH;
+            static const size_t digest_length = SHA256_DIGEST_LENGTH;
+
+            static void init(context_type* ctx)
+            {
+                SHA256_Init(ctx);
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                SHA256_Update(ctx, bytes, n_bytes);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                SHA256_Final(digest, ctx);
+            }
+
+            static const uint8_t state_tag = 3;
+            static const size_t state_word_bytes = 4;
+            static const size_t state_word_count = 8;
+
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    words[i] = ctx.state[i];
+                return ctx.bitcount >> 3;
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buffer;
+            }
+
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return static_cast<size_t>(n_bytes % block_length);
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    ctx->state[i] = static_cast<uint32_t>(words[i]);
+                ctx->bitcount = n_bytes << 3;
+                memcpy(ctx->buffer, pending, n_pending);
+            }
+        };
+
+        /// @brief The SHA-384 variant of SHA-2.
+        struct sha384
+        {
+            typedef SHA384_CTX context_type;
+            static const size_t block_length = SHA384_BLOCK_LENGTH;
+            static const size_t digest_length = SHA384_DIGEST_LENGTH;
+
+            static void init(context_type* ctx)
+            {
+                SHA384_Init(ctx);
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                SHA384_Update(ctx, bytes, n_bytes);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                SHA384_Final(digest, ctx);
+            }
+
+            static const uint8_t state_tag = 4;
+            static const size_t state_word_bytes = 8;
+            static const size_t state_word_count = 8;
+
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    words[i] = ctx.state[i];
+                return (ctx.bitcount[0] >> 3) | (ctx.bitcount[1] << 61);
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buffer;
+            }
+
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return static_cast<size_t>(n_bytes % block_length);
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    ctx->state[i] = words[i];
+                ctx->bitcount[0] = n_bytes << 3;
+                ctx->bitcount[1] = n_bytes >> 61;
+                memcpy(ctx->buffer, pending, n_pending);
+            }
+        };
+
+        /// @brief The SHA-512 variant of SHA-2.
+        struct sha512
+        {
+            typedef SHA512_CTX context_type;
+            static const size_t block_length = SHA512_BLOCK_LENGTH;
+            static const size_t digest_length = SHA512_DIGEST_LENGTH;
+
+            static void init(context_type* ctx)
+            {
+                SHA512_Init(ctx);
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                SHA512_Update(ctx, bytes, n_bytes);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                SHA512_Final(digest, ctx);
+            }
+
+            static const uint8_t state_tag = 5;
+            static const size_t state_word_bytes = 8;
+            static const size_t state_word_count = 8;
+
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    words[i] = ctx.state[i];
+                return (ctx.bitcount[0] >> 3) | (ctx.bitcount[1] << 61);
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buffer;
+            }
+
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return static_cast<size_t>(n_bytes % block_length);
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                for(size_t i=0; i<state_word_count; ++i)
+                    ctx->state[i] = words[i];
+                ctx->bitcount[0] = n_bytes << 3;
+                ctx->bitcount[1] = n_bytes >> 61;
+                memcpy(ctx->buffer, pending, n_pending);
+            }
+        };
+
+        /// @brief The BLAKE2b hash function, optimised for 64-bit machines.
+        struct blake2b
+        {
+            typedef blake2b_state context_type;
+            static const size_t block_length = BLAKE2B_BLOCKBYTES;
+            static const size_t digest_length = BLAKE2B_OUTBYTES;
+            static const size_t max_key_length = BLAKE2B_KEYBYTES;
+
+            static void init(context_type* ctx)
+            {
+                blake2b_init(ctx, digest_length);
+            }
+
+            static void init_key(context_type* ctx, size_t n_digest, const void* key, size_t n_key)
+            {
+                if(blake2b_init_key(ctx, n_digest, key, n_key) != 0)
+                    throw std::invalid_argument("BLAKE2b digest or key length out of range");
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                blake2b_update(ctx, bytes, n_bytes);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                blake2b_final(ctx, digest);
+            }
+
+            // the chaining variables followed by the digest length, which is not recoverable from them
+            static const uint8_t state_tag = 6;
+            static const size_t state_word_bytes = 8;
+            static const size_t state_word_count = 9;
+
+            // the pending block of a keyed context is the key itself until the first message byte arrives
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                if((ctx.keylen > 0) && (ctx.t[0] == 0) && (ctx.t[1] == 0))
+                    throw std::runtime_error("the state of a keyed BLAKE2b hash cannot be saved before it has hashed "
+                                             "any message");
+
+                for(size_t i=0; i<8; ++i)
+                    words[i] = ctx.h[i];
+                words[8] = ctx.outlen;
+                return ctx.t[0] + ctx.buflen;
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buf;
+            }
+
+            // the final block is held back, so a non-empty message always has a non-empty tail
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return (n_bytes == 0) ? 0 : static_cast<size_t>((n_bytes - 1) % block_length) + 1;
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                if((words[8] == 0) || (words[8] > digest_length))
+                    throw std::invalid_argument("saved hash state has an invalid BLAKE2b digest length");
+
+                memset(ctx, 0, sizeof(*ctx));
+                for(size_t i=0; i<8; ++i)
+                    ctx->h[i] = words[i];
+                ctx->t[0] = n_bytes - n_pending;
+                ctx->outlen = static_cast<size_t>(words[8]);
+                memcpy(ctx->buf, pending, n_pending);
+                ctx->buflen = n_pending;
+            }
+        };
+
+        /// @brief The BLAKE2s hash function, optimised for 32-bit machines.
+        struct blake2s
+        {
+            typedef blake2s_state context_type;
+            static const size_t block_length = BLAKE2S_BLOCKBYTES;
+            static const size_t digest_length = BLAKE2S_OUTBYTES;
+            static const size_t max_key_length = BLAKE2S_KEYBYTES;
+
+            static void init(context_type* ctx)
+            {
+                blake2s_init(ctx, digest_length);
+            }
+
+            static void init_key(context_type* ctx, size_t n_digest, const void* key, size_t n_key)
+            {
+                if(blake2s_init_key(ctx, n_digest, key, n_key) != 0)
+                    throw std::invalid_argument("BLAKE2s digest or key length out of range");
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                blake2s_update(ctx, bytes, n_bytes);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                blake2s_final(ctx, digest);
+            }
+
+            static const uint8_t state_tag = 7;
+            static const size_t state_word_bytes = 4;
+            static const size_t state_word_count = 9;
+
+            // the pending block of a keyed context is the key itself until the first message byte arrives
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                if((ctx.keylen > 0) && (ctx.t[0] == 0) && (ctx.t[1] == 0))
+                    throw std::runtime_error("the state of a keyed BLAKE2s hash cannot be saved before it has hashed "
+                                             "any message");
+
+                for(size_t i=0; i<8; ++i)
+                    words[i] = ctx.h[i];
+                words[8] = ctx.outlen;
+                return ((uint64_t(ctx.t[1]) << 32) | ctx.t[0]) + ctx.buflen;
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buf;
+            }
+
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return (n_bytes == 0) ? 0 : static_cast<size_t>((n_bytes - 1) % block_length) + 1;
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                if((words[8] == 0) || (words[8] > digest_length))
+                    throw std::invalid_argument("saved hash state has an invalid BLAKE2s digest length");
+
+                memset(ctx, 0, sizeof(*ctx));
+                for(size_t i=0; i<8; ++i)
+                    ctx->h[i] = static_cast<uint32_t>(words[i]);
+                ctx->t[0] = static_cast<uint32_t>(n_bytes - n_pending);
+                ctx->t[1] = static_cast<uint32_t>((n_bytes - n_pending) >> 32);
+                ctx->outlen = static_cast<size_t>(words[8]);
+                memcpy(ctx->buf, pending, n_pending);
+                ctx->buflen = n_pending;
+            }
+        };
+
+        /// @brief BLAKE2bp, the four-way parallel mode of BLAKE2b.
+        struct blake2bp
+        {
+            typedef blake2bp_state context_type;
+            static const size_t block_length = BLAKE2BP_STRIPEBYTES;
+            static const size_t digest_length = BLAKE2B_OUTBYTES;
+            static const size_t max_key_length = BLAKE2B_KEYBYTES;
+            static const size_t leaf_count = BLAKE2BP_LEAVES;
+
+            static void init(context_type* ctx)
+            {
+                blake2bp_init(ctx, digest_length);
+            }
+
+            static void init_key(context_type* ctx, size_t n_digest, const void* key, size_t n_key)
+            {
+                if(blake2bp_init_key(ctx, n_digest, key, n_key) != 0)
+                    throw std::invalid_argument("BLAKE2bp digest or key length out of range");
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                blake2bp_update(ctx, bytes, n_bytes);
+            }
+
+            // only valid when the context holds no partial stripe, see blake2bp_update_leaves()
+            static void update_leaves(context_type* ctx, size_t first, size_t count,
+                                      const uint8_t* bytes, size_t n_blocks)
+            {
+                blake2bp_update_leaves(ctx, first, count, bytes, n_blocks);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                blake2bp_final(ctx, digest);
+            }
+        };
+
+        /// @brief BLAKE2sp, the eight-way parallel mode of BLAKE2s.
+        struct blake2sp
+        {
+            typedef blake2sp_state context_type;
+            static const size_t block_length = BLAKE2SP_STRIPEBYTES;
+            static const size_t digest_length = BLAKE2S_OUTBYTES;
+            static const size_t max_key_length = BLAKE2S_KEYBYTES;
+            static const size_t leaf_count = BLAKE2SP_LEAVES;
+
+            static void init(context_type* ctx)
+            {
+                blake2sp_init(ctx, digest_length);
+            }
+
+            static void init_key(context_type* ctx, size_t n_digest, const void* key, size_t n_key)
+            {
+                if(blake2sp_init_key(ctx, n_digest, key, n_key) != 0)
+                    throw std::invalid_argument("BLAKE2sp digest or key length out of range");
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                blake2sp_update(ctx, bytes, n_bytes);
+            }
+
+            static void update_leaves(context_type* ctx, size_t first, size_t count,
+                                      const uint8_t* bytes, size_t n_blocks)
+            {
+                blake2sp_update_leaves(ctx, first, count, bytes, n_blocks);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                blake2sp_final(ctx, digest);
+            }
+        };
+
+        /// @brief BLAKE3.
+        struct blake3
+        {
+            typedef blake3_state context_type;
+            static const size_t block_length = BLAKE3_CHUNK_LEN;
+            static const size_t digest_length = BLAKE3_OUT_LEN;
+            static const size_t key_length = BLAKE3_KEY_LEN;
+
+            static void init(context_type* ctx)
+            {
+                blake3_init(ctx);
+            }
+
+            static void init_key(context_type* ctx, const void* key, size_t n_key)
+            {
+                if(n_key != key_length)
+                    throw std::invalid_argument("BLAKE3 keys must be 32 bytes long");
+                blake3_init_key(ctx, static_cast<const uint8_t*>(key));
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                blake3_update(ctx, bytes, n_bytes);
+            }
+
+            // see blake3_update_split()
+            static void update_split(context_type* ctx, const uint8_t* bytes, size_t n_bytes,
+                                     size_t min_subtree_length, blake3_subtree_fn subtree_fn, void* arg)
+            {
+                blake3_update_split(ctx, bytes, n_bytes, min_subtree_length, subtree_fn, arg);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                blake3_final_seek(ctx, 0, digest, digest_length);
+            }
+
+            // the output from offset bytes in, of which the digest is the first digest_length bytes
+            static void final_seek(const context_type* ctx, uint64_t offset, uint8_t* out, size_t n_out)
+            {
+                blake3_final_seek(ctx, offset, out, n_out);
+            }
+        };
+
+        /// @brief A sponge function on Keccak-f[1600], see the sha3_* and shake* typedefs below.
+        ///
+        /// \p Rate is the number of bytes absorbed per permutation and \p Domain the domain separation byte
+        /// beginning the padding. The SHAKE functions have a digest_length of twice their security strength.
+        template<size_t Rate, size_t Digest, uint8_t Domain, uint8_t Tag>
+        struct keccak
+        {
+            typedef sha3_state context_type;
+            static const size_t block_length = Rate;
+            static const size_t digest_length = Digest;
+            static const uint8_t domain = Domain;
+
+            static void init(context_type* ctx)
+            {
+                sha3_init(ctx, Rate, Domain);
+            }
+
+            static void update(context_type* ctx, const uint8_t* bytes, size_t n_bytes)
+            {
+                sha3_update(ctx, bytes, n_bytes);
+            }
+
+            static void final(context_type* ctx, uint8_t* digest)
+            {
+                sha3_squeeze(ctx, digest, digest_length);
+            }
+
+            // the next n_out bytes of output, the first call finalising the hash
+            static void squeeze(context_type* ctx, uint8_t* out, size_t n_out)
+            {
+                sha3_squeeze(ctx, out, n_out);
+            }
+
+            // the lanes of the sponge, complete blocks being absorbed as soon as they arrive
+            static const uint8_t state_tag = Tag;
+            static const size_t state_word_bytes = 8;
+            static const size_t state_word_count = 25;
+
+            static uint64_t get_state(const context_type& ctx, uint64_t* words)
+            {
+                sha3_get_lanes(&ctx, words);
+                return ctx.n_bytes;
+            }
+
+            static const uint8_t* pending_bytes(const context_type& ctx)
+            {
+                return ctx.buf;
+            }
+
+            static size_t pending_length(uint64_t n_bytes)
+            {
+                return static_cast<size_t>(n_bytes % block_length);
+            }
+
+            static void set_state(context_type* ctx, const uint64_t* words, uint64_t n_bytes,
+                                  const uint8_t* pending, size_t n_pending)
+            {
+                sha3_init(ctx, Rate, Domain);
+                sha3_set_lanes(ctx, words);
+                ctx->n_bytes = n_bytes;
+                memcpy(ctx->buf, pending, n_pending);
+                ctx->buflen = n_pending;
+            }
+        };
+
+        typedef keccak<SHA3_224_RATE, 28, SHA3_DOMAIN, 8> sha3_224;     ///< SHA3-224.
+        typedef keccak<SHA3_256_RATE, 32, SHA3_DOMAIN, 9> sha3_256;     ///< SHA3-256.
+        typedef keccak<SHA3_384_RATE, 48, SHA3_DOMAIN, 10> sha3_384;    ///< SHA3-384.
+        typedef keccak<SHA3_512_RATE, 64, SHA3_DOMAIN, 11> sha3_512;    ///< SHA3-512.
+        typedef keccak<SHAKE128_RATE, 32, SHAKE_DOMAIN, 12> shake128;   ///< SHAKE128.
+        typedef keccak<SHAKE256_RATE, 64, SHAKE_DOMAIN, 13> shake256;   ///< SHAKE256.
+    }
+
+    /// @brief A hash function selected at compile time.
+    ///
+    /// Unlike hashbuf, a basic_hasher has no virtual member functions and holds the hash function's context
+    /// by value. It may therefore be allocated on the stack and its member functions inlined into the
+    /// caller. The \p Algorithm parameter is one of the structures in the hashstream::algorithm namespace.
+    ///
+    /// An example of using this class:
+    ///
+    /// @code
+    /// hashstream::sha256_hasher h;
+    /// h.update("abc", 3);
+    /// hashstream::sha256_hasher::digest_type d(h.finalise());
+    /// @endcode
+    ///
+    /// @note Once finalise() has been called, no further data may be passed to update() until reset() has
+    /// been called.
+    template<typename Algorithm>
+    class basic_hasher
+    {
+        public:
+            typedef Algorithm                               algorithm_type;     ///< The hash function.
+            typedef typename Algorithm::context_type        context_type;       ///< The hash context.
+
+            /// @brief The length, in bytes, of the blocks processed by the hash function.
+            static const size_t block_length = Algorithm::block_length;
+
+            /// @brief The length, in bytes, of the digest.
+            static const size_t digest_length = Algorithm::digest_length;
+
+            /// @brief A fixed-size array holding a digest.
+            typedef boost::array<uint8_t, Algorithm::digest_length> digest_type;
+
+            basic_hasher()
+            {
+                Algorithm::init(&initial_);
+                ctx_ = initial_;
+            }
+
+            /// @brief Construct a hasher continuing from an existing context.
+            ///
+            /// This allows a hash function to be initialised other than by Algorithm::init(), for example
+            /// with a key via Algorithm::init_key() where the algorithm provides one. Where the context
+            /// selects a digest shorter than digest_length, finalise() writes only that many leading bytes.
+            /// reset() returns the hasher to \p ctx.
+            explicit basic_hasher(const context_type& ctx)
+                : initial_(ctx)
+                , ctx_(ctx)
+            { }
+
+            /// @brief Update the hash with a contiguous buffer of bytes.
+            ///
+            /// @param data A pointer to the bytes to hash.
+            /// @param n_bytes The number of bytes pointed to by \p data.
+            void update(const void* data, size_t n_bytes)
+            {
+                Algorithm::update(&ctx_, static_cast<const uint8_t*>(data), n_bytes);
+            }
+
+            /// @brief Update the hash with the contents of a string.
+            void update(const std::string& s)
+            {
+                update(s.data(), s.size());
+            }
+
+            /// @brief Finalise the hash and write the digest to caller memory.
+            ///
+            /// @param out Where to write the digest_length bytes of the digest.
+            void finalise(uint8_t* out)
+            {
+                Algorithm::final(&ctx_, out);
+            }
+
+            /// @brief Finalise the hash and return the digest.
+            ///
+            /// Where the context selects a digest shorter than digest_length, the remaining bytes are zero.
+            digest_type finalise()
+            {
+                digest_type digest;
+                digest.assign(0);
+                finalise(digest.data());
+                return digest;
+            }
+
+            /// @brief Compute the digest of the data passed to update() so far without finalising.
+            ///
+            /// The context is copied and the copy finalised so that further data may still be passed to
+            /// update(). A basic_hasher may also simply be copied to fork a hash which shares a common prefix.
+            digest_type peek_digest() const
+            {
+                basic_hasher copy(*this);
+                return copy.finalise();
+            }
+
+            /// @brief Serialise the intermediate state of the hash.
+            ///
+            /// The state may be persisted and later passed to restore_state(), possibly on another machine,
+            /// to continue hashing from where this hash left off. See encode_hash_state().
+            ///
+            /// @throw std::runtime_error if the state would include a BLAKE2 key, which a keyed context holds
+            /// as its pending block until the first message byte is passed to update().
+            std::vector<uint8_t> save_state() const
+            {
+                uint64_t words[Algorithm::state_word_count];
+                uint64_t n_bytes(Algorithm::get_state(ctx_, words));
+                return encode_hash_state(Algorithm::state_tag, Algorithm::state_word_bytes,
+                                         words, Algorithm::state_word_count,
+                                         n_bytes, Algorithm::pending_bytes(ctx_), Algorithm::pending_length(n_bytes));
+            }
+
+            /// @brief Restore the intermediate state of the hash from a value returned by save_state().
+            ///
+            /// @throw std::invalid_argument if \p state is malformed or was saved from a different hash function.
+            void restore_state(const std::vector<uint8_t>& state)
+            {
+                uint64_t words[Algorithm::state_word_count];
+                uint64_t n_bytes;
+                size_t n_pending;
+                const uint8_t* pending(decode_hash_state(state, Algorithm::state_tag,
+                                                         Algorithm::state_word_bytes,
+                                                         words, Algorithm::state_word_count,
+                                                         &n_bytes, &n_pending));
+                if(n_pending != Algorithm::pending_length(n_bytes))
+                    throw std::invalid_argument("saved hash state has an inconsistent number of pending bytes");
+                Algorithm::set_state(&ctx_, words, n_bytes, pending, n_pending);
+            }
+
+            /// @brief Return the hash to the state it was constructed in, discarding any data passed to update().
+            ///
+            /// A hasher constructed from a context, for example one carrying a key, returns to that context.
+            void reset()
+            {
+                ctx_ = initial_;
+            }
+
+            /// @brief Obtain the underlying hash context.
+            const context_type& context() const
+            {
+                return ctx_;
+            }
+
+        protected:
+            context_type    initial_;   ///< The context as constructed, restored by reset().
+            context_type    ctx_;       ///< The hash function context.
+    };
+
+    /// @brief Compute the digest of a contiguous buffer of bytes in one shot.
+    ///
+    /// The hash function is selected at compile time and computed entirely on the stack. For example:
+    ///
+    /// @code
+    /// uint8_t out[hashstream::algorithm::sha256::digest_length];
+    /// hashstream::digest<hashstream::algorithm::sha256>(key.data(), key.size(), out);
+    /// @endcode
+    ///
+    /// @param data A pointer to the bytes to hash.
+    /// @param n_bytes The number of bytes pointed to by \p data.
+    /// @param out Where to write the Algorithm::digest_length bytes of the digest.
+    template<typename Algorithm>
+    inline void digest(const void* data, size_t n_bytes, uint8_t* out)
+    {
+        typename Algorithm::context_type ctx;
+        Algorithm::init(&ctx);
+        Algorithm::update(&ctx, static_cast<const uint8_t*>(data), n_bytes);
+        Algorithm::final(&ctx, out);
+    }
+
+    typedef basic_hasher<algorithm::md5>    md5_hasher;     ///< A basic_hasher computing MD5.
+    typedef basic_hasher<algorithm::sha1>   sha1_hasher;    ///< A basic_hasher computing SHA-1.
+    typedef basic_hasher<algorithm::sha256> sha256_hasher;  ///< A basic_hasher computing SHA-256.
+    typedef basic_hasher<algorithm::sha384> sha384_hasher;  ///< A basic_hasher computing SHA-384.
+    typedef basic_hasher<algorithm::sha512> sha512_hasher;  ///< A basic_hasher computing SHA-512.
+    typedef basic_hasher<algorithm::blake2b> blake2b_hasher; ///< A basic_hasher computing unkeyed BLAKE2b-512.
+    typedef basic_hasher<algorithm::blake2s> blake2s_hasher; ///< A basic_hasher computing unkeyed BLAKE2s-256.
+    typedef basic_hasher<algorithm::blake2bp> blake2bp_hasher; ///< A basic_hasher computing unkeyed BLAKE2bp-512.
+    typedef basic_hasher<algorithm::blake2sp> blake2sp_hasher; ///< A basic_hasher computing unkeyed BLAKE2sp-256.
+    typedef basic_hasher<algorithm::blake3> blake3_hasher;  ///< A basic_hasher computing unkeyed BLAKE3.
+    typedef basic_hasher<algorithm::sha3_224> sha3_224_hasher; ///< A basic_hasher computing SHA3-224.
+    typedef basic_hasher<algorithm::sha3_256> sha3_256_hasher; ///< A basic_hasher computing SHA3-256.
+    typedef basic_hasher<algorithm::sha3_384> sha3_384_hasher; ///< A basic_hasher computing SHA3-384.
+    typedef basic_hasher<algorithm::sha3_512> sha3_512_hasher; ///< A basic_hasher computing SHA3-512.
+    typedef basic_hasher<algorithm::shake128> shake128_hasher; ///< A basic_hasher computing SHAKE128 to 32 bytes.
+    typedef basic_hasher<algorithm::shake256> shake256_hasher; ///< A basic_hasher computing SHAKE256 to 64 bytes.
+
+    /// @}
+}
+
+#endif // __HASHER_HPP
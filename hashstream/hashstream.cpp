@@ -24,48 +24,212 @@
 //  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <istream>
-#include <sstream>
 #include <string>
 
-#include <cstring> // for memcpy
+#include <cstring> // for memcpy, memcmp
+#include <stdexcept>
 
 #include "hashstream.hpp"
 
 namespace hashstream
 {
+    namespace
+    {
+        // two lower-case hex characters for each possible byte value
+        const char hex_pairs[] =
+            "000102030405060708090a0b0c0d0e0f"
+            "101112131415161718191a1b1c1d1e1f"
+            "202122232425262728292a2b2c2d2e2f"
+            "303132333435363738393a3b3c3d3e3f"
+            "404142434445464748494a4b4c4d4e4f"
+            "505152535455565758595a5b5c5d5e5f"
+            "606162636465666768696a6b6c6d6e6f"
+            "707172737475767778797a7b7c7d7e7f"
+            "808182838485868788898a8b8c8d8e8f"
+            "909192939495969798999a9b9c9d9e9f"
+            "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+            "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+            "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+            "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+            "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+            "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+    }
+
+    void hex_encode(const uint8_t* bytes, size_t n_bytes, char* out)
+    {
+        for(size_t i=0; i<n_bytes; ++i, out += 2)
+            memcpy(out, hex_pairs + 2 * bytes[i], 2);
+    }
+
+    // ////// hash_digest implementation //////
+
+    hash_digest::hash_digest()
+        : size_(0)
+    { }
+
+    hash_digest::hash_digest(const uint8_t* bytes, size_t n_bytes)
+        : size_(n_bytes)
+    {
+        if(n_bytes > max_size)
+            throw std::invalid_argument("digest is too large to be stored in a hash_digest");
+        memcpy(bytes_, bytes, n_bytes);
+    }
+
+    const uint8_t* hash_digest::data() const
+    {
+        return bytes_;
+    }
+
+    size_t hash_digest::size() const
+    {
+        return size_;
+    }
+
+    bool hash_digest::empty() const
+    {
+        return size_ == 0;
+    }
+
+    uint8_t hash_digest::operator[] (size_t i) const
+    {
+        return bytes_[i];
+    }
+
+    bool hash_digest::operator== (const hash_digest& other) const
+    {
+        return (size_ == other.size_) && (memcmp(bytes_, other.bytes_, size_) == 0);
+    }
+
+    bool hash_digest::operator!= (const hash_digest& other) const
+    {
+        return !(*this == other);
+    }
+
     // ////// hashbuf implementation //////
 
-    hashbuf::hashbuf()
+    hashbuf::hashbuf(size_t block_length)
         : std::streambuf()
         , is_finalised_(false)
-        , digest_size_(0)
-    { }
+        , block_length_(block_length)
+        , put_area_size_(max_put_area_size)
+    {
+        if(block_length_ == 0)
+            throw std::invalid_argument("hash block length must be non-zero");
+
+        // the put area must hold at least one block so that only whole blocks are drained from it
+        if(block_length_ > max_put_area_size)
+            throw std::invalid_argument("hash block length must be at most hashbuf::max_put_area_size");
+
+        // use the largest whole number of blocks which fits
+        put_area_size_ = max_put_area_size - (max_put_area_size % block_length_);
+
+        setp(put_area_, put_area_ + put_area_size_);
+    }
+
+    hashbuf::hashbuf(const hashbuf& other)
+        : std::streambuf()
+        , is_finalised_(other.is_finalised_)
+        , digest_(other.digest_)
+        , block_length_(other.block_length_)
+        , put_area_size_(other.put_area_size_)
+    {
+        if(is_finalised_)
+        {
+            memcpy(hex_digest_, other.hex_digest_, 2 * digest_.size());
+            setp(NULL, NULL);
+            return;
+        }
+
+        size_t n_pending(other.pptr() - other.pbase());
+        memcpy(put_area_, other.put_area_, n_pending);
+        setp(put_area_, put_area_ + put_area_size_);
+        pbump(static_cast<int>(n_pending));
+    }
 
     hashbuf::~hashbuf()
     { }
 
+    void hashbuf::update(const void* data, size_t n_bytes)
+    {
+        if(n_bytes == 0)
+            return;
+
+        if(n_bytes <= static_cast<size_t>(epptr() - pptr()))
+        {
+            memcpy(pptr(), data, n_bytes);
+            pbump(static_cast<int>(n_bytes));
+        }
+        else
+        {
+            put_bytes(static_cast<const uint8_t*>(data), n_bytes);
+        }
+    }
+
+    void hashbuf::update(const std::string& s)
+    {
+        update(s.data(), s.size());
+    }
+
+    void hashbuf::update(const std::vector<uint8_t>& v)
+    {
+        if(!v.empty())
+            update(&v[0], v.size());
+    }
+
+    const hash_digest& hashbuf::digest() const
+    {
+        if(!is_finalised_)
+            throw std::runtime_error("hash not finalised when calling hashbuf::digest()");
+        return digest_;
+    }
+
     const uint8_t* hashbuf::digest_bytes() const
     {
         if(!is_finalised_)
             throw std::runtime_error("hash not finalised when calling hashbuf::digest_bytes()");
-        return digest_bytes_.get();
+        return digest_.data();
     }
 
     size_t hashbuf::digest_size() const
     {
         if(!is_finalised_)
             throw std::runtime_error("hash not finalised when calling hashbuf::digest_size()");
-        return digest_size_;
+        return digest_.size();
+    }
+
+    std::string hashbuf::hex_digest() const
+    {
+        if(!is_finalised_)
+            throw std::runtime_error("hash not finalised when calling hashbuf::hex_digest()");
+        return std::string(hex_digest_, 2 * digest_.size());
+    }
+
+    size_t hashbuf::hex_digest_into(char* out) const
+    {
+        if(!is_finalised_)
+            throw std::runtime_error("hash not finalised when calling hashbuf::hex_digest_into()");
+
+        size_t n_chars(2 * digest_.size());
+        memcpy(out, hex_digest_, n_chars);
+        out[n_chars] = '\0';
+        return n_chars;
     }
 
     void hashbuf::finalise()
     {
         if(is_finalised_)
             throw std::runtime_error("hashes may only be finalised once");
+        flush_put_area();
         this->xfinal();
-        if(digest_size_ == 0)
+        if(digest_.empty())
             throw std::runtime_error("internal hash implementation did not set digest");
+
+        // encode once here so that the const accessors never write to the hashbuf
+        hex_encode(digest_.data(), digest_.size(), hex_digest_);
         is_finalised_ = true;
+
+        // any further writes will now reach overflow() or put_bytes() and throw
+        setp(NULL, NULL);
     }
 
     void hashbuf::ensure_finalised()
@@ -79,23 +243,201 @@ namespace hashstream
         return is_finalised_;
     }
 
+    void hashbuf::squeeze(void* out, size_t n_bytes)
+    {
+        if(!is_finalised_)
+            throw std::runtime_error("hash not finalised when calling hashbuf::squeeze()");
+        this->xsqueeze(reinterpret_cast<uint8_t*>(out), n_bytes);
+    }
+
+    boost::shared_ptr<hashbuf> hashbuf::clone() const
+    {
+        return this->xclone();
+    }
+
+    hash_digest hashbuf::peek_digest() const
+    {
+        if(is_finalised_)
+            return digest_;
+
+        boost::shared_ptr<hashbuf> copy(this->xclone());
+        copy->finalise();
+        return copy->digest();
+    }
+
+    std::vector<uint8_t> hashbuf::save_state()
+    {
+        if(is_finalised_)
+            throw std::runtime_error("the state of a finalised hash cannot be saved");
+
+        // the hash function only ever sees whole blocks, any partial block is saved from the put area
+        drain_whole_blocks();
+        std::vector<uint8_t> hash_state(this->xsave_state());
+
+        // a saved hashbuf is the number of bytes in the put area as a 2 byte big-endian value, those bytes and
+        // then the state of the hash function
+        size_t n_pending(pptr() - pbase());
+        std::vector<uint8_t> state;
+        state.reserve(2 + n_pending + hash_state.size());
+        state.push_back(static_cast<uint8_t>(n_pending >> 8));
+        state.push_back(static_cast<uint8_t>(n_pending));
+        state.insert(state.end(), put_area_, put_area_ + n_pending);
+        state.insert(state.end(), hash_state.begin(), hash_state.end());
+
+        return state;
+    }
+
+    void hashbuf::restore_state(const std::vector<uint8_t>& state)
+    {
+        if(state.size() < 2)
+            throw std::invalid_argument("not a saved hash state");
+
+        size_t n_pending((static_cast<size_t>(state[0]) << 8) | state[1]);
+        if((n_pending >= block_length_) || (state.size() < 2 + n_pending))
+            throw std::invalid_argument("saved hash state has an unexpected partial block");
+
+        this->xrestore_state(std::vector<uint8_t>(state.begin() + 2 + n_pending, state.end()));
+        is_finalised_ = false;
+        digest_ = hash_digest();
+        setp(put_area_, put_area_ + put_area_size_);
+
+        if(n_pending > 0)
+        {
+            memcpy(put_area_, &state[2], n_pending);
+            pbump(static_cast<int>(n_pending));
+        }
+    }
+
+    void hashbuf::reset()
+    {
+        this->xreset();
+        is_finalised_ = false;
+        digest_ = hash_digest();
+        setp(put_area_, put_area_ + put_area_size_);
+    }
+
+    void hashbuf::xreset()
+    {
+        throw std::runtime_error("this hash function does not support being reset");
+    }
+
+    boost::shared_ptr<hashbuf> hashbuf::xclone() const
+    {
+        throw std::runtime_error("this hash function does not support cloning");
+    }
+
+    std::vector<uint8_t> hashbuf::xsave_state() const
+    {
+        throw std::runtime_error("this hash function does not support saving its state");
+    }
+
+    void hashbuf::xrestore_state(const std::vector<uint8_t>&)
+    {
+        throw std::runtime_error("this hash function does not support restoring its state");
+    }
+
+    void hashbuf::xsqueeze(uint8_t*, size_t)
+    {
+        throw std::runtime_error("this hash function does not have extendable output");
+    }
+
     void hashbuf::set_digest(const uint8_t* bytes, size_t n_bytes)
     {
-        digest_bytes_ = boost::shared_ptr<uint8_t>(new uint8_t[n_bytes]);
-        memcpy(digest_bytes_.get(), bytes, n_bytes);
-        digest_size_ = n_bytes;
+        digest_ = hash_digest(bytes, n_bytes);
+    }
+
+    void hashbuf::drain_whole_blocks()
+    {
+        // only drain whole blocks so that the hash function never sees a partial block early
+        size_t n_pending(pptr() - pbase());
+        size_t n_blocks_bytes(n_pending - (n_pending % block_length_));
+        if(n_blocks_bytes == 0)
+            return;
+
+        this->xupdate(reinterpret_cast<const uint8_t*>(put_area_), n_blocks_bytes);
+        memmove(put_area_, put_area_ + n_blocks_bytes, n_pending - n_blocks_bytes);
+        setp(put_area_, put_area_ + put_area_size_);
+        pbump(static_cast<int>(n_pending - n_blocks_bytes));
+    }
+
+    void hashbuf::flush_put_area()
+    {
+        size_t n_pending(pptr() - pbase());
+        if(n_pending > 0)
+            this->xupdate(reinterpret_cast<const uint8_t*>(put_area_), n_pending);
+        setp(put_area_, put_area_ + put_area_size_);
+    }
+
+    void hashbuf::put_bytes(const uint8_t* bytes, size_t n_bytes)
+    {
+        if(is_finalised_)
+            throw std::runtime_error("attempt to write to a hash which has been finalised");
+
+        // top up any pending data to a full put area and drain it
+        size_t n_pending(pptr() - pbase());
+        if(n_pending > 0)
+        {
+            size_t n_room(epptr() - pptr());
+            if(n_room > n_bytes)
+                n_room = n_bytes;
+            memcpy(pptr(), bytes, n_room);
+            pbump(static_cast<int>(n_room));
+            bytes += n_room;
+            n_bytes -= n_room;
+
+            if(pptr() != epptr())
+                return;
+            flush_put_area();
+        }
+
+        // pass whole blocks straight through
+        size_t n_direct(n_bytes - (n_bytes % block_length_));
+        if(n_direct > 0)
+        {
+            this->xupdate(bytes, n_direct);
+            bytes += n_direct;
+            n_bytes -= n_direct;
+        }
+
+        // keep the remainder for later
+        if(n_bytes > 0)
+        {
+            memcpy(pptr(), bytes, n_bytes);
+            pbump(static_cast<int>(n_bytes));
+        }
     }
 
     int hashbuf::overflow(int c)
     {
-        if((c >= 0) && (c <= 127))
+        if(is_finalised_)
+            throw std::runtime_error("attempt to write to a hash which has been finalised");
+
+        flush_put_area();
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
         {
-            char ch(c);
-            this->xsputn(&ch, 1);
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
         }
+
+        return traits_type::not_eof(c);
+    }
+
+    int hashbuf::sync()
+    {
+        if(!is_finalised_)
+            drain_whole_blocks();
         return 0;
     }
 
+    std::streamsize hashbuf::xsputn(const char* s, std::streamsize n)
+    {
+        if(n <= 0)
+            return 0;
+
+        update(s, static_cast<size_t>(n));
+        return n;
+    }
+
     // ////// hashstream implementation //////
 
     hashstream::hashstream(standard_hash hf)
@@ -119,23 +461,37 @@ namespace hashstream
         return hb_.get();
     }
 
-    std::string hashstream::hex_digest() const
+    void hashstream::update(const void* data, size_t n_bytes)
     {
-        hb_->ensure_finalised();
-        size_t digest_size(hb_->digest_size());
-        const uint8_t* digest_bytes(hb_->digest_bytes());
+        hb_->update(data, n_bytes);
+    }
 
-        if((digest_size == 0) || (digest_bytes == NULL))
-            throw std::runtime_error("internal error: hash digest was NULL or zero-bytes in length.");
+    void hashstream::update(const std::string& s)
+    {
+        hb_->update(s);
+    }
 
-        std::stringstream ss;
-        ss << std::hex;
-        for(size_t i=0; i<digest_size; ++i)
-        {
-            ss << (digest_bytes[i] >> 4) << (digest_bytes[i] & 0xf);
-        }
+    void hashstream::update(const std::vector<uint8_t>& v)
+    {
+        hb_->update(v);
+    }
 
-        return ss.str();
+    void hashstream::reset()
+    {
+        hb_->reset();
+        clear();
+    }
+
+    std::string hashstream::hex_digest() const
+    {
+        hb_->ensure_finalised();
+        return hb_->hex_digest();
+    }
+
+    size_t hashstream::hex_digest_into(char* out) const
+    {
+        hb_->ensure_finalised();
+        return hb_->hex_digest_into(out);
     }
 
     // ////// convenience wrappers //////
@@ -155,9 +511,11 @@ namespace hashstream
 
     std::string hex_digest(standard_hash hf, const std::string& s)
     {
-        hashstream hs(hf);
-        hs << s;
-        return hs.hex_digest();
+        uint8_t bytes[hash_digest::max_size];
+        char hex[2 * hash_digest::max_size];
+        size_t n_bytes(digest(hf, s.data(), s.size(), bytes));
+        hex_encode(bytes, n_bytes, hex);
+        return std::string(hex, 2 * n_bytes);
     }
 
     std::ostream& operator<< (std::ostream& os, const hashbuf& hb)
@@ -168,7 +526,9 @@ namespace hashstream
 
     std::ostream& operator<< (std::ostream& os, const hashstream& hs)
     {
-        os << hs.hex_digest();
+        char hex[2 * hash_digest::max_size + 1];
+        hs.hex_digest_into(hex);
+        os << hex;
         return os;
     }
 }
@@ -4,6 +4,7 @@
 #include <string>
 #include <streambuf>
 #include <istream>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <boost/shared_ptr.hpp>
@@ -22,6 +23,61 @@ namespace hashstream
         SHA256,         ///< SHA-256 variant of SHA-2
         SHA384,         ///< SHA-384 variant of SHA-2
         SHA512,         ///< SHA-512 variant of SHA-2
+        BLAKE2B,        ///< BLAKE2b with a 64 byte digest, see also make_blake2b_hashbuf()
+        BLAKE2S,        ///< BLAKE2s with a 32 byte digest, see also make_blake2s_hashbuf()
+        BLAKE2BP,       ///< BLAKE2bp, the 4-way parallel BLAKE2b, see also make_blake2bp_hashbuf()
+        BLAKE2SP,       ///< BLAKE2sp, the 8-way parallel BLAKE2s, see also make_blake2sp_hashbuf()
+        BLAKE3,         ///< BLAKE3 with a 32 byte digest, see also make_blake3_hashbuf()
+        SHA3_224,       ///< SHA3-224 variant of SHA-3
+        SHA3_256,       ///< SHA3-256 variant of SHA-3
+        SHA3_384,       ///< SHA3-384 variant of SHA-3
+        SHA3_512,       ///< SHA3-512 variant of SHA-3
+        SHAKE128,       ///< SHAKE128 with a 32 byte digest, extendable with hashbuf::squeeze()
+        SHAKE256,       ///< SHAKE256 with a 64 byte digest, extendable with hashbuf::squeeze()
+    };
+
+    /// @brief A fixed-capacity value type holding the digest computed by a hash function.
+    ///
+    /// The digest bytes are stored inline and so constructing, copying or returning a hash_digest never
+    /// touches the allocator. The capacity is sufficient for the largest digest in the hash library.
+    class hash_digest
+    {
+        public:
+            /// @brief The maximum number of bytes which a hash_digest may hold.
+            static const size_t max_size = 64;
+
+            /// @brief Construct an empty digest.
+            hash_digest();
+
+            /// @brief Construct a digest by copying bytes.
+            ///
+            /// @param bytes A pointer to the digest bytes.
+            /// @param n_bytes The number of bytes in the digest.
+            ///
+            /// @throw std::invalid_argument if \p n_bytes is greater than max_size.
+            hash_digest(const uint8_t* bytes, size_t n_bytes);
+
+            /// @brief Obtain a pointer to the digest bytes.
+            const uint8_t* data() const;
+
+            /// @brief Return the number of bytes in the digest.
+            size_t size() const;
+
+            /// @brief Query if this digest is empty.
+            bool empty() const;
+
+            /// @brief Return the byte at index \p i within the digest.
+            uint8_t operator[] (size_t i) const;
+
+            /// @brief Compare two digests for equality.
+            bool operator== (const hash_digest& other) const;
+
+            /// @brief Compare two digests for inequality.
+            bool operator!= (const hash_digest& other) const;
+
+        protected:
+            uint8_t     bytes_[max_size];   ///< Storage for the digest.
+            size_t      size_;              ///< Number of bytes of bytes_ in use.
     };
 
     /// @brief A std::streambuf implementation which computes the hash of its input.
@@ -30,7 +86,11 @@ namespace hashstream
     /// class provides the infrastructure to interface a hash function with the C++ standard iostream library.
     ///
     /// New hash functions should be added to the library by deriving from this class and implementing the
-    /// xsputn and xfinal abstract virtual member functions.
+    /// xupdate and xfinal abstract virtual member functions.
+    ///
+    /// Data written to a hashbuf is collected in an internal put area whose size is a multiple of the hash
+    /// function's block length. Short writes are simply copied into the put area and the implementation only
+    /// sees data via xupdate() when a run of whole blocks is available, or when the hash is finalised.
     ///
     /// A user may define their own hash function and use it with a hashstream via the
     /// hashstream::hashstream(boost::shared_ptr< hashbuf >) constructor.
@@ -41,9 +101,39 @@ namespace hashstream
     class hashbuf : public std::streambuf
     {
         public:
-            hashbuf();
+            /// @brief Construct a hashbuf for a hash function with a given block length.
+            ///
+            /// @param block_length The length, in bytes, of the blocks processed by the underlying hash
+            /// function. The internal put area is sized to the largest multiple of this which fits in
+            /// max_put_area_size bytes.
+            ///
+            /// @throw std::invalid_argument if \p block_length is zero or greater than max_put_area_size, 1024 bytes.
+            explicit hashbuf(size_t block_length = 64);
             ~hashbuf();
 
+            /// @brief Update the hash with a contiguous buffer of bytes.
+            ///
+            /// This bypasses the std::streambuf machinery entirely. Short runs of bytes are copied into the put
+            /// area and longer runs are passed to the hash function directly. Writes via update() may be freely
+            /// interleaved with writes via a std::ostream.
+            ///
+            /// @param data A pointer to the bytes to hash.
+            /// @param n_bytes The number of bytes pointed to by \p data.
+            ///
+            /// @throw std::runtime_error if the hash has been finalised.
+            void update(const void* data, size_t n_bytes);
+
+            /// @brief Update the hash with the contents of a string.
+            void update(const std::string& s);
+
+            /// @brief Update the hash with the contents of a vector of bytes.
+            void update(const std::vector<uint8_t>& v);
+
+            /// @brief Obtain the computed digest.
+            ///
+            /// @throw std::runtime_error if called before finalise().
+            const hash_digest& digest() const;
+
             /// @brief Obtain a pointer to the computed digest.
             ///
             /// @throw std::runtime_error if called before finalise().
@@ -54,11 +144,30 @@ namespace hashstream
             /// @throw std::runtime_error if called before finalise().
             size_t          digest_size() const;
 
+            /// @brief Return the hexadecimal representation of the computed digest.
+            ///
+            /// The representation is computed once by finalise().
+            ///
+            /// @throw std::runtime_error if called before finalise().
+            std::string hex_digest() const;
+
+            /// @brief Write the hexadecimal representation of the computed digest to caller memory.
+            ///
+            /// Writes 2 * digest_size() characters followed by a terminating NUL character. A buffer of
+            /// 2 * hash_digest::max_size + 1 characters is always sufficient. No allocation is performed.
+            ///
+            /// @param out Where to write the representation.
+            ///
+            /// @return The number of characters written, not including the terminating NUL.
+            ///
+            /// @throw std::runtime_error if called before finalise().
+            size_t hex_digest_into(char* out) const;
+
             /// @brief Finalise the hash computation.
             ///
             /// For hashes which require a finalise step, this member function performs it and extracts the
-            /// digest. Calls to digest_bytes() and digest_size() are only valid if this member function has
-            /// been called.
+            /// digest. Any data pending in the put area is passed to the hash function first. Calls to
+            /// digest_bytes() and digest_size() are only valid if this member function has been called.
             ///
             /// @throw std::runtime_error if finalise() has already been called.
             void finalise();
@@ -72,10 +181,104 @@ namespace hashstream
             /// @brief Query if this hash has been finalised.
             bool is_finalised() const;
 
+            /// @brief Read output from an extendable-output hash function.
+            ///
+            /// Hash functions such as BLAKE3 and SHAKE produce as many bytes of output as are asked for, of which the
+            /// digest is only the start. Each call returns the next \p n_bytes bytes of that output, the
+            /// first call starting from its beginning, so the output does not depend on how it is split
+            /// between calls. reset() returns to the beginning.
+            ///
+            /// @param out Where to write the output.
+            /// @param n_bytes The number of bytes to write.
+            ///
+            /// @throw std::runtime_error if called before finalise() or the hash function does not have
+            /// extendable output.
+            void squeeze(void* out, size_t n_bytes);
+
+            /// @brief Duplicate this hash, including any data written so far.
+            ///
+            /// The new hashbuf is entirely independent of this one. This allows a common prefix to be hashed
+            /// once and then the hash forked for each of a number of messages sharing that prefix:
+            ///
+            /// @code
+            /// hashstream::hashstream prefix(hashstream::SHA256);
+            /// prefix << "some common header";
+            /// hashstream::hashstream message(prefix.rdbuf()->clone());
+            /// message << "message body";
+            /// @endcode
+            ///
+            /// @throw std::runtime_error if the hash function does not support cloning.
+            boost::shared_ptr<hashbuf> clone() const;
+
+            /// @brief Compute the digest of the data written so far without finalising this hash.
+            ///
+            /// A copy of the hash is finalised and its digest returned. Further data may still be written
+            /// to this hash. If this hash has already been finalised, its digest is returned.
+            ///
+            /// @throw std::runtime_error if the hash function does not support cloning.
+            hash_digest peek_digest() const;
+
+            /// @brief Serialise the intermediate state of this hash.
+            ///
+            /// The returned state is portable between machines and records the hash function, the number of
+            /// bytes absorbed, the hash function's internal state and any partial block still held in the put
+            /// area. It may be persisted and later passed to restore_state() on a hashbuf for the same hash
+            /// function to continue hashing from this point.
+            /// This allows, for example, the digest of an append-only file to be updated by hashing only the
+            /// newly appended bytes.
+            ///
+            /// @throw std::runtime_error if the hash has been finalised or the hash function does not support
+            /// saving its state.
+            std::vector<uint8_t> save_state();
+
+            /// @brief Restore the intermediate state of this hash from a value returned by save_state().
+            ///
+            /// Any data written so far is discarded along with any computed digest.
+            ///
+            /// @throw std::invalid_argument if \p state is malformed or was saved from a different hash
+            /// function.
+            /// @throw std::runtime_error if the hash function does not support restoring its state.
+            void restore_state(const std::vector<uint8_t>& state);
+
+            /// @brief Return this hash to its initial state.
+            ///
+            /// Any data written so far is discarded along with any computed digest and the hash may then be
+            /// used to compute the digest of a new message. This allows a hashbuf to be reused rather than
+            /// constructing a new one for each message.
+            ///
+            /// @throw std::runtime_error if the hash function does not support being reset.
+            void reset();
+
         protected:
+            /// @brief The maximum size of the internal put area in bytes.
+            static const size_t max_put_area_size = 1024;
+
             bool                        is_finalised_;      ///< Flag indicating if we're finalised.
-            boost::shared_ptr<uint8_t>  digest_bytes_;      ///< Pointer to the digest.
-            size_t                      digest_size_;       ///< Size of the digest.
+            hash_digest                 digest_;            ///< The computed digest.
+            char                        hex_digest_[2 * hash_digest::max_size]; ///< Hex digest, set by finalise().
+            size_t                      block_length_;      ///< Block length of the hash function.
+            size_t                      put_area_size_;     ///< Size of the put area in use.
+            char                        put_area_[max_put_area_size]; ///< Storage for the put area.
+
+            /// @brief Copy the state of another hashbuf.
+            ///
+            /// Any data pending in the put area of \p other is copied along with its digest, if finalised.
+            /// Derived classes may use this to implement xclone().
+            hashbuf(const hashbuf& other);
+
+            /// @brief Pass any data pending in the put area to xupdate() and empty the put area.
+            void flush_put_area();
+
+            /// @brief Pass any whole blocks pending in the put area to xupdate() and keep the remainder.
+            void drain_whole_blocks();
+
+            /// @brief Pass a run of bytes which do not fit in the put area on to the hash function.
+            ///
+            /// Any pending data in the put area is topped up to a full put area and passed to xupdate() along
+            /// with as many whole blocks from \p bytes as possible. The remainder is left in the put area.
+            ///
+            /// @throw std::runtime_error if the hash has been finalised.
+            void put_bytes(const uint8_t* bytes, size_t n_bytes);
 
             /// @brief Set the cached digest.
             ///
@@ -85,32 +288,86 @@ namespace hashstream
             ///
             /// @param bytes A pointer to the computed digest.
             /// @param n_bytes The number of bytes in this digest.
+            ///
+            /// @throw std::invalid_argument if \p n_bytes is greater than hash_digest::max_size.
             void set_digest(const uint8_t* bytes, size_t n_bytes);
 
-            /// @brief Simple implementation of overflow.
+            /// @brief Drain a full put area into the hash function.
             ///
-            /// An implementation of the standard overflow member which never returns an EOF.
+            /// An implementation of the standard overflow member which passes the contents of the put area to
+            /// xupdate() and then stores \p c in the newly emptied put area.
             ///
             /// @sa The C++ standard library.
             ///
             /// @param c
+            ///
+            /// @throw std::runtime_error if the hash has been finalised.
             virtual int overflow(int c);
 
-            /// @brief Update the hash with a set of bytes.
+            /// @brief Drain any whole blocks in the put area into the hash function.
             ///
-            /// Overrides the std::streambuf::xsputn member function/
+            /// @sa The C++ standard library.
+            virtual int sync();
+
+            /// @brief Write a set of bytes to the hash.
+            ///
+            /// Overrides the std::streambuf::xsputn member function. Writes which fit within the put area are
+            /// copied into it, larger writes are passed to xupdate() directly in whole blocks.
             ///
             /// @sa The C++ standard library.
             ///
             /// @param s
             /// @param n
-            virtual std::streamsize xsputn(const char* s, std::streamsize n) = 0;
+            virtual std::streamsize xsputn(const char* s, std::streamsize n);
+
+            /// @brief Update the hash with a set of bytes.
+            ///
+            /// Called with the contents of the put area as it is drained, or with whole blocks passed straight
+            /// through from large writes. Unless the hash is being finalised, \p n_bytes will be a multiple of
+            /// the block length passed to the constructor.
+            ///
+            /// @param bytes
+            /// @param n_bytes
+            virtual void xupdate(const uint8_t* bytes, size_t n_bytes) = 0;
 
             /// @brief Finalise the hash and compute the digest.
             ///
             /// Called once via finalise(). Implementations may assume this will only be called once.
             /// Implementations should call set_digest() after computing the digest.
             virtual void xfinal() = 0;
+
+            /// @brief Re-initialise the hash function.
+            ///
+            /// Called via reset(). Implementations should return their context to the state it had on
+            /// construction. The default implementation throws std::runtime_error.
+            virtual void xreset();
+
+            /// @brief Return a new hashbuf with the same state as this one.
+            ///
+            /// Called via clone(). The default implementation throws std::runtime_error.
+            virtual boost::shared_ptr<hashbuf> xclone() const;
+
+            /// @brief Serialise the state of the hash function.
+            ///
+            /// Called via save_state() once any whole blocks in the put area have been passed to xupdate().
+            /// The partial block left in the put area is saved by hashbuf alongside the returned state. The
+            /// default implementation throws std::runtime_error.
+            virtual std::vector<uint8_t> xsave_state() const;
+
+            /// @brief Restore the state of the hash function.
+            ///
+            /// Called via restore_state() with a value returned by xsave_state(). The default implementation
+            /// throws std::runtime_error.
+            virtual void xrestore_state(const std::vector<uint8_t>& state);
+
+            /// @brief Write the next bytes of output of an extendable-output hash function.
+            ///
+            /// Called via squeeze(), only once finalised. Implementations should continue from where the
+            /// previous call left off. The default implementation throws std::runtime_error.
+            virtual void xsqueeze(uint8_t* out, size_t n_bytes);
+
+        private:
+            hashbuf& operator= (const hashbuf&);    // not assignable
     };
 
     /// @brief Construct a hashbuf representing a standard hash function.
@@ -120,6 +377,143 @@ namespace hashstream
     /// @return A boost::shared_ptr pointing to the new hashbuf.
     boost::shared_ptr<hashbuf> make_standard_hashbuf(standard_hash hf);
 
+    /// @brief Construct a hashbuf computing BLAKE2b with a chosen digest length and optional key.
+    ///
+    /// BLAKE2b produces a digest of 1 to 64 bytes and, given a key of up to 64 bytes, serves as a message
+    /// authentication code. The digest length is an input to the hash function, so a short digest is not a
+    /// prefix of a longer one. make_standard_hashbuf(BLAKE2B) is equivalent to make_blake2b_hashbuf().
+    ///
+    /// A keyed hash holds its key as the pending block until a whole block of message has been written, so
+    /// that saving its state would expose the key. Until then save_state() throws std::runtime_error.
+    ///
+    /// @param digest_length The number of bytes in the digest.
+    /// @param key A pointer to the key, which is copied. May be NULL if \p key_length is zero.
+    /// @param key_length The number of bytes pointed to by \p key, zero for unkeyed hashing.
+    ///
+    /// @return A boost::shared_ptr pointing to the new hashbuf.
+    ///
+    /// @throw std::invalid_argument if \p digest_length or \p key_length is out of range.
+    boost::shared_ptr<hashbuf> make_blake2b_hashbuf(size_t digest_length = 64, const void* key = NULL,
+                                                    size_t key_length = 0);
+
+    /// @brief Construct a hashbuf computing BLAKE2s with a chosen digest length and optional key.
+    ///
+    /// As make_blake2b_hashbuf() but for BLAKE2s, whose digest and key are each at most 32 bytes.
+    boost::shared_ptr<hashbuf> make_blake2s_hashbuf(size_t digest_length = 32, const void* key = NULL,
+                                                    size_t key_length = 0);
+
+    /// @brief Construct a hashbuf computing BLAKE2bp with a chosen digest length, key and number of threads.
+    ///
+    /// BLAKE2bp deals the message out a block at a time to four independent BLAKE2b leaves and hashes their
+    /// digests together, so a single digest may be computed by several cores. Large updates, such as a
+    /// whole file passed to hashbuf::update(), are shared between up to four threads. With a single thread,
+    /// the four leaves are instead compressed together using SIMD instructions where the CPU allows. The
+    /// digest does not depend on the number of threads but differs from that of BLAKE2b. The hashbuf
+    /// supports reset() and clone() but not save_state(). make_standard_hashbuf(BLAKE2BP) is equivalent to
+    /// make_blake2bp_hashbuf().
+    ///
+    /// @param digest_length The number of bytes in the digest.
+    /// @param key A pointer to the key, which is copied. May be NULL if \p key_length is zero.
+    /// @param key_length The number of bytes pointed to by \p key, zero for unkeyed hashing.
+    /// @param threads The greatest number of threads to use, zero for one per core.
+    ///
+    /// @return A boost::shared_ptr pointing to the new hashbuf.
+    ///
+    /// @throw std::invalid_argument if \p digest_length or \p key_length is out of range.
+    boost::shared_ptr<hashbuf> make_blake2bp_hashbuf(size_t digest_length = 64, const void* key = NULL,
+                                                     size_t key_length = 0, unsigned int threads = 0);
+
+    /// @brief Construct a hashbuf computing BLAKE2sp with a chosen digest length, key and number of threads.
+    ///
+    /// As make_blake2bp_hashbuf() but with eight BLAKE2s leaves, and so up to eight threads, and a digest
+    /// and key of at most 32 bytes each.
+    boost::shared_ptr<hashbuf> make_blake2sp_hashbuf(size_t digest_length = 32, const void* key = NULL,
+                                                     size_t key_length = 0, unsigned int threads = 0);
+
+    /// @brief Construct a hashbuf computing BLAKE3 with an optional key and a chosen number of threads.
+    ///
+    /// BLAKE3 hashes the message in independent 1 KiB chunks joined by a binary tree, so a single digest
+    /// may be computed by several SIMD lanes and several cores at once. Large updates, such as a whole
+    /// file passed to hashbuf::update(), share complete subtrees of at least 512 KiB between threads,
+    /// which are started on the first such update and kept until the hashbuf is destroyed. The digest
+    /// does not depend on the number of threads. Given a 32 byte key, BLAKE3 serves as a message
+    /// authentication code. Once finalised, hashbuf::squeeze() returns any length of output. The hashbuf
+    /// supports reset() and clone() but not save_state(). make_standard_hashbuf(BLAKE3) is equivalent to
+    /// make_blake3_hashbuf().
+    ///
+    /// @param key A pointer to the key, which is copied. May be NULL if \p key_length is zero.
+    /// @param key_length The number of bytes pointed to by \p key, either 32 or zero for unkeyed hashing.
+    /// @param threads The greatest number of threads to use, zero for one per core.
+    ///
+    /// @return A boost::shared_ptr pointing to the new hashbuf.
+    ///
+    /// @throw std::invalid_argument if \p key_length is neither 0 nor 32.
+    boost::shared_ptr<hashbuf> make_blake3_hashbuf(const void* key = NULL, size_t key_length = 0,
+                                                   unsigned int threads = 0);
+
+    /// @brief Return the number of bytes in the digest computed by a standard hash function.
+    ///
+    /// @param hf Which hash function to query.
+    ///
+    /// @throw std::invalid_argument if \p hf is not a known hash function.
+    size_t digest_size(standard_hash hf);
+
+    /// @brief Compute the digest of a contiguous buffer of bytes in one shot.
+    ///
+    /// The hash is computed entirely on the stack: no hashbuf, std::ostream or heap allocation is involved.
+    /// For hash functions known at compile time, see also the digest() function template in hasher.hpp.
+    ///
+    /// @param hf Which hash function to compute.
+    /// @param data A pointer to the bytes to hash.
+    /// @param n_bytes The number of bytes pointed to by \p data.
+    /// @param out Where to write the digest. Must have room for digest_size(hf) bytes.
+    ///
+    /// @return The number of bytes written to \p out.
+    ///
+    /// @throw std::invalid_argument if \p hf is not a known hash function.
+    size_t digest(standard_hash hf, const void* data, size_t n_bytes, uint8_t* out);
+
+    /// @brief Compute the digest of a contiguous buffer of bytes in one shot.
+    ///
+    /// As digest(standard_hash, const void*, size_t, uint8_t*) but returning the digest by value.
+    hash_digest digest(standard_hash hf, const void* data, size_t n_bytes);
+
+    /// @brief Compute the digests of many independent buffers in one call.
+    ///
+    /// Where the CPU allows, several messages are hashed at once in the lanes of a SIMD kernel. For large
+    /// numbers of small messages this is considerably faster than calling digest() for each in turn, which
+    /// is what happens otherwise. Messages may be of any and differing lengths.
+    ///
+    /// @param hf Which hash function to compute.
+    /// @param data An array of \p n pointers to the bytes of each message.
+    /// @param n_bytes An array of the \p n message lengths.
+    /// @param n The number of messages.
+    /// @param out Where to write the digests, one after another. Must have room for n * digest_size(hf) bytes.
+    ///
+    /// @return The number of bytes written to \p out.
+    ///
+    /// @throw std::invalid_argument if \p hf is not a known hash function.
+    size_t digest_many(standard_hash hf, const void* const* data, const size_t* n_bytes, size_t n, uint8_t* out);
+
+    /// @brief Compute BLAKE3 output for a contiguous buffer of bytes in one shot.
+    ///
+    /// Intended for a message held entirely in memory, such as a memory-mapped file. As with
+    /// make_blake3_hashbuf(), a buffer of at least 512 KiB is shared between threads, which are started
+    /// for this call only. Any amount of output may be produced, the first 32 bytes of which are the
+    /// digest.
+    ///
+    /// @param data A pointer to the bytes to hash.
+    /// @param n_bytes The number of bytes pointed to by \p data.
+    /// @param out Where to write the output.
+    /// @param n_out The number of bytes of output to write.
+    /// @param key A pointer to the key. May be NULL if \p key_length is zero.
+    /// @param key_length The number of bytes pointed to by \p key, either 32 or zero for unkeyed hashing.
+    /// @param threads The greatest number of threads to use, zero for one per core.
+    ///
+    /// @throw std::invalid_argument if \p key_length is neither 0 nor 32.
+    void blake3_digest(const void* data, size_t n_bytes, uint8_t* out, size_t n_out = 32, const void* key = NULL,
+                       size_t key_length = 0, unsigned int threads = 0);
+
     /// @brief std::ostream derived class which can compute a hash
     ///
     /// Computing hashes is best done via the hashstream class. A hashstream can be used where any
@@ -161,6 +555,21 @@ namespace hashstream
             /// @sa The std::ostream::rdbuf() member function.
             hashbuf* rdbuf() const;
 
+            /// @brief Update the hash with a contiguous buffer of bytes.
+            ///
+            /// A convenience wrapper around hashbuf::update() which avoids the formatting and state checks
+            /// performed by std::ostream. The stream's state flags are not consulted or modified.
+            ///
+            /// @param data A pointer to the bytes to hash.
+            /// @param n_bytes The number of bytes pointed to by \p data.
+            void update(const void* data, size_t n_bytes);
+
+            /// @brief Update the hash with the contents of a string.
+            void update(const std::string& s);
+
+            /// @brief Update the hash with the contents of a vector of bytes.
+            void update(const std::vector<uint8_t>& v);
+
             /// @brief Compute the hash function.
             ///
             /// This is a convenience member function for those who simply need to output the digest to the
@@ -170,10 +579,33 @@ namespace hashstream
             /// @return A string giving the hexadecimal representation of the digest.
             std::string hex_digest() const;
 
+            /// @brief Compute the hash function and write its hexadecimal representation to caller memory.
+            ///
+            /// Like hex_digest() but without allocating a std::string. See hashbuf::hex_digest_into().
+            ///
+            /// @param out Where to write the representation followed by a terminating NUL.
+            ///
+            /// @return The number of characters written, not including the terminating NUL.
+            size_t hex_digest_into(char* out) const;
+
+            /// @brief Return the stream and its hash to their initial state.
+            ///
+            /// Resets the associated hashbuf via hashbuf::reset() and clears the stream's state flags.
+            void reset();
+
         protected:
             boost::shared_ptr<hashbuf> hb_;     ///< The hashbuf used by this stream.
     };
 
+    /// @brief Write the lower-case hexadecimal representation of a sequence of bytes.
+    ///
+    /// Exactly 2 * \p n_bytes characters are written to \p out. No terminating NUL is written.
+    ///
+    /// @param bytes The bytes to encode.
+    /// @param n_bytes The number of bytes to encode.
+    /// @param out Where to write the representation.
+    void hex_encode(const uint8_t* bytes, size_t n_bytes, char* out);
+
     /// @brief Read bytes from an input stream into a hashstream.
     ///
     /// Read bytes from \p is into \p hs until the EOF condition is met.
@@ -0,0 +1,172 @@
+/*
+ * Keccak-f[1600] on four independent states at once using AVX2, for
+ * sha3_many() in sha3.c.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * Each 256-bit register holds the same lane of all four states, so the
+ * rounds are exactly those of keccak_f1600() in sha3.c performed four
+ * times over. The lanes are held plain rather than complemented since
+ * AVX2 has an AND-NOT instruction. Rotations by 8 and 56 bits are byte
+ * shuffles.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint64_t keccak_round_constants[24] = {
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+	0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+#define XOR(x, y)	_mm256_xor_si256((x), (y))
+#define ANDNOT(x, y)	_mm256_andnot_si256((x), (y))
+#define ROL(x, n)	_mm256_or_si256(_mm256_slli_epi64((x), (n)), _mm256_srli_epi64((x), 64 - (n)))
+#define ROL8(x)		_mm256_shuffle_epi8((x), r8)
+#define ROL56(x)	_mm256_shuffle_epi8((x), r56)
+
+/* chi of one row of five lanes B0 ... B4 into Y##a ... Y##u */
+#define CHI(Y) do { \
+	Y##a = XOR(B0, ANDNOT(B1, B2)); \
+	Y##e = XOR(B1, ANDNOT(B2, B3)); \
+	Y##i = XOR(B2, ANDNOT(B3, B4)); \
+	Y##o = XOR(B3, ANDNOT(B4, B0)); \
+	Y##u = XOR(B4, ANDNOT(B0, B1)); \
+} while (0)
+
+/* As KECCAK_ROUND() in sha3.c */
+#define KECCAK_ROUND(X, Y, rc) do { \
+	Ca = XOR(XOR(XOR(X##ba, X##ga), XOR(X##ka, X##ma)), X##sa); \
+	Ce = XOR(XOR(XOR(X##be, X##ge), XOR(X##ke, X##me)), X##se); \
+	Ci = XOR(XOR(XOR(X##bi, X##gi), XOR(X##ki, X##mi)), X##si); \
+	Co = XOR(XOR(XOR(X##bo, X##go), XOR(X##ko, X##mo)), X##so); \
+	Cu = XOR(XOR(XOR(X##bu, X##gu), XOR(X##ku, X##mu)), X##su); \
+	Da = XOR(Cu, ROL(Ce, 1)); \
+	De = XOR(Ca, ROL(Ci, 1)); \
+	Di = XOR(Ce, ROL(Co, 1)); \
+	Do = XOR(Ci, ROL(Cu, 1)); \
+	Du = XOR(Co, ROL(Ca, 1)); \
+	\
+	B0 = XOR(X##ba, Da); \
+	B1 = ROL(XOR(X##ge, De), 44); \
+	B2 = ROL(XOR(X##ki, Di), 43); \
+	B3 = ROL(XOR(X##mo, Do), 21); \
+	B4 = ROL(XOR(X##su, Du), 14); \
+	CHI(Y##b); \
+	Y##ba = XOR(Y##ba, _mm256_set1_epi64x((long long)(rc))); \
+	\
+	B0 = ROL(XOR(X##bo, Do), 28); \
+	B1 = ROL(XOR(X##gu, Du), 20); \
+	B2 = ROL(XOR(X##ka, Da), 3); \
+	B3 = ROL(XOR(X##me, De), 45); \
+	B4 = ROL(XOR(X##si, Di), 61); \
+	CHI(Y##g); \
+	\
+	B0 = ROL(XOR(X##be, De), 1); \
+	B1 = ROL(XOR(X##gi, Di), 6); \
+	B2 = ROL(XOR(X##ko, Do), 25); \
+	B3 = ROL8(XOR(X##mu, Du)); \
+	B4 = ROL(XOR(X##sa, Da), 18); \
+	CHI(Y##k); \
+	\
+	B0 = ROL(XOR(X##bu, Du), 27); \
+	B1 = ROL(XOR(X##ga, Da), 36); \
+	B2 = ROL(XOR(X##ke, De), 10); \
+	B3 = ROL(XOR(X##mi, Di), 15); \
+	B4 = ROL56(XOR(X##so, Do)); \
+	CHI(Y##m); \
+	\
+	B0 = ROL(XOR(X##bi, Di), 62); \
+	B1 = ROL(XOR(X##go, Do), 55); \
+	B2 = ROL(XOR(X##ku, Du), 39); \
+	B3 = ROL(XOR(X##ma, Da), 41); \
+	B4 = ROL(XOR(X##se, De), 2); \
+	CHI(Y##s); \
+} while (0)
+
+/* The 64-bit word at offset in each of the four blocks */
+static __m256i load_lane(const uint8_t* const* blocks, size_t offset)
+{
+	__m128i lo, hi;
+
+	lo = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(blocks[0] + offset)),
+				_mm_loadl_epi64((const __m128i*)(blocks[1] + offset)));
+	hi = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(blocks[2] + offset)),
+				_mm_loadl_epi64((const __m128i*)(blocks[3] + offset)));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/* XOR one block from each of blocks into the lanes, four lanes at a time where possible */
+static void absorb(__m256i* A, const uint8_t* const* blocks, size_t rate)
+{
+	__m256i r0, r1, r2, r3, t0, t1, t2, t3;
+	size_t i = 0;
+
+	for (; 8 * i + 32 <= rate; i += 4) {
+		r0 = _mm256_loadu_si256((const __m256i*)(blocks[0] + 8 * i));
+		r1 = _mm256_loadu_si256((const __m256i*)(blocks[1] + 8 * i));
+		r2 = _mm256_loadu_si256((const __m256i*)(blocks[2] + 8 * i));
+		r3 = _mm256_loadu_si256((const __m256i*)(blocks[3] + 8 * i));
+
+		t0 = _mm256_unpacklo_epi64(r0, r1);
+		t1 = _mm256_unpackhi_epi64(r0, r1);
+		t2 = _mm256_unpacklo_epi64(r2, r3);
+		t3 = _mm256_unpackhi_epi64(r2, r3);
+
+		A[i + 0] = XOR(A[i + 0], _mm256_permute2x128_si256(t0, t2, 0x20));
+		A[i + 1] = XOR(A[i + 1], _mm256_permute2x128_si256(t1, t3, 0x20));
+		A[i + 2] = XOR(A[i + 2], _mm256_permute2x128_si256(t0, t2, 0x31));
+		A[i + 3] = XOR(A[i + 3], _mm256_permute2x128_si256(t1, t3, 0x31));
+	}
+
+	for (; 8 * i < rate; i++)
+		A[i] = XOR(A[i], load_lane(blocks, 8 * i));
+}
+
+void keccak_x4_avx2(uint64_t* state, const uint8_t* const* blocks, size_t rate)
+{
+	const __m256i r8 = _mm256_setr_epi8(
+		7, 0, 1, 2, 3, 4, 5, 6, 15, 8, 9, 10, 11, 12, 13, 14,
+		7, 0, 1, 2, 3, 4, 5, 6, 15, 8, 9, 10, 11, 12, 13, 14);
+	const __m256i r56 = _mm256_setr_epi8(
+		1, 2, 3, 4, 5, 6, 7, 0, 9, 10, 11, 12, 13, 14, 15, 8,
+		1, 2, 3, 4, 5, 6, 7, 0, 9, 10, 11, 12, 13, 14, 15, 8);
+	__m256i A[25];
+	__m256i Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako, Aku;
+	__m256i Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+	__m256i Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko, Eku;
+	__m256i Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+	__m256i Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du, B0, B1, B2, B3, B4;
+	size_t i, round;
+
+	for (i = 0; i < 25; i++)
+		A[i] = _mm256_loadu_si256((const __m256i*)(state + 4 * i));
+	absorb(A, blocks, rate);
+
+	Aba = A[0];  Abe = A[1];  Abi = A[2];  Abo = A[3];  Abu = A[4];
+	Aga = A[5];  Age = A[6];  Agi = A[7];  Ago = A[8];  Agu = A[9];
+	Aka = A[10]; Ake = A[11]; Aki = A[12]; Ako = A[13]; Aku = A[14];
+	Ama = A[15]; Ame = A[16]; Ami = A[17]; Amo = A[18]; Amu = A[19];
+	Asa = A[20]; Ase = A[21]; Asi = A[22]; Aso = A[23]; Asu = A[24];
+
+	for (round = 0; round < 24; round += 2) {
+		KECCAK_ROUND(A, E, keccak_round_constants[round]);
+		KECCAK_ROUND(E, A, keccak_round_constants[round + 1]);
+	}
+
+	A[0] = Aba;  A[1] = Abe;  A[2] = Abi;  A[3] = Abo;  A[4] = Abu;
+	A[5] = Aga;  A[6] = Age;  A[7] = Agi;  A[8] = Ago;  A[9] = Agu;
+	A[10] = Aka; A[11] = Ake; A[12] = Aki; A[13] = Ako; A[14] = Aku;
+	A[15] = Ama; A[16] = Ame; A[17] = Ami; A[18] = Amo; A[19] = Amu;
+	A[20] = Asa; A[21] = Ase; A[22] = Asi; A[23] = Aso; A[24] = Asu;
+
+	for (i = 0; i < 25; i++)
+		_mm256_storeu_si256((__m256i*)(state + 4 * i), A[i]);
+}
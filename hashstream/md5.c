@@ -33,14 +33,30 @@
   <ghost@aladdin.com>.  Other authors are noted in the change history
   that follows (in reverse chronological order):
 
+  2026-10-16 hashstream Added md5_transform_blocks(), through which
+	md5_append() now passes whole blocks.
+  2026-10-16 hashstream Added md5_many() over the multi-buffer kernels.
+  2026-10-16 hashstream Process runs of blocks in one call with the
+	chaining variables kept in registers; read message words with a
+	single load on little-endian machines, where the build now sets
+	ARCH_IS_BIG_ENDIAN; add rather than or the terms of G.
+  2026-10-16 hashstream Process whole blocks through the runtime-selected
+	kernel table in dispatch.h; md5_process() now takes the chaining
+	variables directly.
   1999-11-04 lpd Edited comments slightly for automatic TOC extraction.
   1999-10-18 lpd Fixed typo in header comment (ansi2knr rather than md5).
   1999-05-03 lpd Original version.
  */
 
 #include "md5.h"
+#include "dispatch.h"
+#include "multibuf.h"
 #include "string.h"
 
+#ifndef ARCH_IS_BIG_ENDIAN
+# define ARCH_IS_BIG_ENDIAN 1	/* slower, default implementation */
+#endif
+
 #ifdef TEST
 /*
  * Compile with -DTEST to create a self-contained executable test program.
@@ -162,57 +178,50 @@ main()
 #define T63 0x2ad7d2bb
 #define T64 0xeb86d391
 
-static void
-md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
+/* Read a little-endian message word. */
+static md5_word_t
+md5_load(const md5_byte_t *p)
 {
-    md5_word_t
-	a = pms->abcd[0], b = pms->abcd[1],
-	c = pms->abcd[2], d = pms->abcd[3];
-    md5_word_t t;
-
-#ifndef ARCH_IS_BIG_ENDIAN
-# define ARCH_IS_BIG_ENDIAN 1	/* slower, default implementation */
-#endif
 #if ARCH_IS_BIG_ENDIAN
-
     /*
      * On big-endian machines, we must arrange the bytes in the right
      * order.  (This also works on machines of unknown byte order.)
      */
-    md5_word_t X[16];
-    const md5_byte_t *xp = data;
-    int i;
-
-    for (i = 0; i < 16; ++i, xp += 4)
-	X[i] = xp[0] + (xp[1] << 8) + (xp[2] << 16) + (xp[3] << 24);
-
-#else  /* !ARCH_IS_BIG_ENDIAN */
-
+    return p[0] + (p[1] << 8) + (p[2] << 16) + ((md5_word_t)p[3] << 24);
+#else
     /*
-     * On little-endian machines, we can process properly aligned data
-     * without copying it.
+     * On little-endian machines, the bytes are already in the right
+     * order and a single load, aligned or not, suffices.
      */
-    md5_word_t xbuf[16];
-    const md5_word_t *X;
-
-    if (!((data - (const md5_byte_t *)0) & 3)) {
-	/* data are properly aligned */
-	X = (const md5_word_t *)data;
-    } else {
-	/* not aligned */
-	memcpy(xbuf, data, 64);
-	X = xbuf;
-    }
+    md5_word_t w;
+
+    memcpy(&w, p, sizeof(w));
+    return w;
 #endif
+}
+
+static void
+md5_process(md5_word_t *abcd, const md5_byte_t *data, size_t n_blocks)
+{
+    md5_word_t
+	a = abcd[0], b = abcd[1],
+	c = abcd[2], d = abcd[3];
+    md5_word_t aa, bb, cc, dd, t;
+
+    /* The chaining variables stay in registers from block to block. */
+  for (; n_blocks > 0; --n_blocks, data += 64) {
+    aa = a, bb = b, cc = c, dd = d;
+
+#define X(k) md5_load(data + 4 * (k))
 
 #define ROTATE_LEFT(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
 
     /* Round 1. */
     /* Let [abcd k s i] denote the operation
-       a = b + ((a + F(b,c,d) + X[k] + T[i]) <<< s). */
-#define F(x, y, z) (((x) & (y)) | (~(x) & (z)))
+       a = b + ((a + F(b,c,d) + X(k) + T[i]) <<< s). */
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + F(b,c,d) + X[k] + Ti;\
+  t = a + F(b,c,d) + X(k) + Ti;\
   a = ROTATE_LEFT(t, s) + b
     /* Do the following 16 operations. */
     SET(a, b, c, d,  0,  7,  T1);
@@ -235,10 +244,13 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
 
      /* Round 2. */
      /* Let [abcd k s i] denote the operation
-          a = b + ((a + G(b,c,d) + X[k] + T[i]) <<< s). */
-#define G(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+          a = b + ((a + G(b,c,d) + X(k) + T[i]) <<< s). */
+     /* The two terms of G are disjoint and so may be added rather than
+        or'ed, adding the term not involving b first to shorten the chain
+        of dependencies on the previous operation. */
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + G(b,c,d) + X[k] + Ti;\
+  t = a + X(k) + Ti + (c & ~d);\
+  t += b & d;\
   a = ROTATE_LEFT(t, s) + b
      /* Do the following 16 operations. */
     SET(a, b, c, d,  1,  5, T17);
@@ -261,10 +273,10 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
 
      /* Round 3. */
      /* Let [abcd k s t] denote the operation
-          a = b + ((a + H(b,c,d) + X[k] + T[i]) <<< s). */
+          a = b + ((a + H(b,c,d) + X(k) + T[i]) <<< s). */
 #define H(x, y, z) ((x) ^ (y) ^ (z))
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + H(b,c,d) + X[k] + Ti;\
+  t = a + H(b,c,d) + X(k) + Ti;\
   a = ROTATE_LEFT(t, s) + b
      /* Do the following 16 operations. */
     SET(a, b, c, d,  5,  4, T33);
@@ -287,10 +299,10 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
 
      /* Round 4. */
      /* Let [abcd k s t] denote the operation
-          a = b + ((a + I(b,c,d) + X[k] + T[i]) <<< s). */
+          a = b + ((a + I(b,c,d) + X(k) + T[i]) <<< s). */
 #define I(x, y, z) ((y) ^ ((x) | ~(z)))
 #define SET(a, b, c, d, k, s, Ti)\
-  t = a + I(b,c,d) + X[k] + Ti;\
+  t = a + I(b,c,d) + X(k) + Ti;\
   a = ROTATE_LEFT(t, s) + b
      /* Do the following 16 operations. */
     SET(a, b, c, d,  0,  6, T49);
@@ -311,23 +323,57 @@ md5_process(md5_state_t *pms, const md5_byte_t *data /*[64]*/)
     SET(b, c, d, a,  9, 21, T64);
 #undef SET
 
+#undef X
+
      /* Then perform the following additions. (That is increment each
         of the four registers by the value it had before this block
         was started.) */
-    pms->abcd[0] += a;
-    pms->abcd[1] += b;
-    pms->abcd[2] += c;
-    pms->abcd[3] += d;
+    a += aa;
+    b += bb;
+    c += cc;
+    d += dd;
+  }
+
+    abcd[0] = a;
+    abcd[1] = b;
+    abcd[2] = c;
+    abcd[3] = d;
 }
 
+void
+md5_blocks_generic(uint32_t abcd[4], const uint8_t *data, size_t n_blocks)
+{
+    md5_process(abcd, data, n_blocks);
+}
+
+static const md5_word_t md5_initial_abcd[4] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+};
+
 void
 md5_init(md5_state_t *pms)
 {
     pms->count[0] = pms->count[1] = 0;
-    pms->abcd[0] = 0x67452301;
-    pms->abcd[1] = 0xefcdab89;
-    pms->abcd[2] = 0x98badcfe;
-    pms->abcd[3] = 0x10325476;
+    memcpy(pms->abcd, md5_initial_abcd, sizeof(md5_initial_abcd));
+}
+
+/* Add nbytes to the message length. */
+static void
+md5_count(md5_state_t *pms, size_t nbytes)
+{
+    md5_word_t nbits = (md5_word_t)(nbytes << 3);
+
+    pms->count[1] += (md5_word_t)(nbytes >> 29);
+    pms->count[0] += nbits;
+    if (pms->count[0] < nbits)
+	pms->count[1]++;
+}
+
+void
+md5_transform_blocks(md5_state_t *pms, const md5_byte_t *data, size_t nblocks)
+{
+    hashstream_get_kernels()->md5_blocks(pms->abcd, data, nblocks);
+    md5_count(pms, nblocks * 64);
 }
 
 void
@@ -336,36 +382,35 @@ md5_append(md5_state_t *pms, const md5_byte_t *data, int nbytes)
     const md5_byte_t *p = data;
     int left = nbytes;
     int offset = (pms->count[0] >> 3) & 63;
-    md5_word_t nbits = (md5_word_t)(nbytes << 3);
 
     if (nbytes <= 0)
 	return;
 
-    /* Update the message length. */
-    pms->count[1] += nbytes >> 29;
-    pms->count[0] += nbits;
-    if (pms->count[0] < nbits)
-	pms->count[1]++;
-
     /* Process an initial partial block. */
     if (offset) {
 	int copy = (offset + nbytes > 64 ? 64 - offset : nbytes);
 
 	memcpy(pms->buf + offset, p, copy);
+	md5_count(pms, copy);
 	if (offset + copy < 64)
 	    return;
 	p += copy;
 	left -= copy;
-	md5_process(pms, pms->buf);
+	hashstream_get_kernels()->md5_blocks(pms->abcd, pms->buf, 1);
     }
 
     /* Process full blocks. */
-    for (; left >= 64; p += 64, left -= 64)
-	md5_process(pms, p);
+    if (left >= 64) {
+	md5_transform_blocks(pms, p, left / 64);
+	p += left & ~63;
+	left &= 63;
+    }
 
     /* Process a final partial block. */
-    if (left)
+    if (left) {
 	memcpy(pms->buf, p, left);
+	md5_count(pms, left);
+    }
 }
 
 void
@@ -390,3 +435,37 @@ md5_finish(md5_state_t *pms, md5_byte_t digest[16])
     for (i = 0; i < 16; ++i)
 	digest[i] = (md5_byte_t)(pms->abcd[i >> 2] >> ((i & 3) << 3));
 }
+
+void
+md5_many(const md5_byte_t *const *data, const size_t *nbytes, size_t n, md5_byte_t (*digest)[16])
+{
+    const hashstream_kernels *kernels = hashstream_get_kernels();
+    hashstream_multibuf_algorithm alg;
+    md5_state_t state;
+    size_t i, nblocks;
+
+    if (kernels->md5_lanes == 0) {
+	/* No multi-buffer kernel: hash each message in turn. */
+	for (i = 0; i < n; ++i) {
+	    nblocks = nbytes[i] / 64;
+	    md5_init(&state);
+	    md5_transform_blocks(&state, data[i], nblocks);
+	    md5_append(&state, data[i] + nblocks * 64, (int)(nbytes[i] & 63));
+	    md5_finish(&state, digest[i]);
+	}
+	return;
+    }
+
+    memset(&alg, 0, sizeof(alg));
+    alg.lanes = kernels->md5_lane_count;
+    alg.block_length = 64;
+    alg.word_bytes = 4;
+    alg.state_words = 4;
+    alg.length_bytes = 8;
+    alg.big_endian = 0;
+    alg.initial_state = md5_initial_abcd;
+    alg.digest_length = 16;
+    alg.lane_blocks32 = kernels->md5_lanes;
+    alg.blocks32 = kernels->md5_blocks;
+    hashstream_multibuf(&alg, data, nbytes, n, (md5_byte_t *)digest);
+}
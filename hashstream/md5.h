@@ -33,6 +33,8 @@
   <ghost@aladdin.com>.  Other authors are noted in the change history
   that follows (in reverse chronological order):
 
+  2026-10-16 hashstream Added md5_transform_blocks().
+  2026-10-16 hashstream Added md5_many().
   1999-11-04 lpd Edited comments slightly for automatic TOC extraction.
   1999-10-18 lpd Fixed typo in header comment (ansi2knr rather than md5);
 	added conditionalization for C++ compilation from Martin
@@ -43,6 +45,8 @@
 #ifndef md5_INCLUDED
 #  define md5_INCLUDED
 
+#include <stddef.h>
+
 /*
  * This code has some adaptations for the Ghostscript environment, but it
  * will compile and run correctly in any environment with 8-bit chars and
@@ -80,6 +84,12 @@ void md5_append(P3(md5_state_t *pms, const md5_byte_t *data, int nbytes));
 void md5_append(md5_state_t *pms, const md5_byte_t *data, int nbytes);
 #endif
 
+/*
+ * Append nblocks whole 64-byte blocks to a message whose length so far
+ * is a multiple of 64 bytes, without copying them through the buffer.
+ */
+void md5_transform_blocks(md5_state_t *pms, const md5_byte_t *data, size_t nblocks);
+
 /* Finish the message and return the digest. */
 #ifdef P2
 void md5_finish(P2(md5_state_t *pms, md5_byte_t digest[16]));
@@ -87,6 +97,9 @@ void md5_finish(P2(md5_state_t *pms, md5_byte_t digest[16]));
 void md5_finish(md5_state_t *pms, md5_byte_t digest[16]);
 #endif
 
+/* Compute the digests of n independent messages, several at a time. */
+void md5_many(const md5_byte_t *const *data, const size_t *nbytes, size_t n, md5_byte_t (*digest)[16]);
+
 #ifdef __cplusplus
 }  /* end extern "C" */
 #endif
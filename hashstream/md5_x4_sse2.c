@@ -0,0 +1,143 @@
+/*
+ * Four-lane MD5 using SSE2, see multibuf.h.
+ *
+ * This file is compiled with -msse2 and must only be called through the
+ * kernel table, which selects it when the CPU reports SSE2 and no wider
+ * MD5 kernel is usable, see dispatch.c.
+ *
+ * Each register holds the same variable for four independent messages,
+ * so the operations are exactly those of md5_process() in md5.c on four
+ * 32-bit lanes at once. There is no vector rotate, so rotations are a
+ * pair of shifts. MD5 words are little-endian and need no byte swap.
+ */
+
+#include <emmintrin.h>
+
+#include "dispatch.h"
+
+#define ADD(x, y)	_mm_add_epi32((x), (y))
+#define ROTL(x, n)	_mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+#define F(x, y, z)	_mm_xor_si128((z), _mm_and_si128((x), _mm_xor_si128((y), (z))))
+#define G(x, y, z)	_mm_or_si128(_mm_and_si128((x), (z)), _mm_andnot_si128((z), (y)))
+#define H(x, y, z)	_mm_xor_si128(_mm_xor_si128((x), (y)), (z))
+#define I(x, y, z)	_mm_xor_si128((y), _mm_or_si128((x), _mm_xor_si128((z), ones)))
+
+/* a = b + ((a + f(b,c,d) + X[k] + t) <<< s) */
+#define STEP(f, a, b, c, d, k, s, t) \
+	(a) = ADD((b), ROTL(ADD(ADD((a), f((b), (c), (d))), ADD(X[k], _mm_set1_epi32((int)(t)))), (s)))
+
+/* Load four words at offset from each lane's block and transpose them into X[0..3] */
+static void load_words(__m128i* X, const uint8_t* const* blocks, size_t offset)
+{
+	__m128i r0, r1, r2, r3, t0, t1, t2, t3;
+
+	r0 = _mm_loadu_si128((const __m128i*)(blocks[0] + offset));
+	r1 = _mm_loadu_si128((const __m128i*)(blocks[1] + offset));
+	r2 = _mm_loadu_si128((const __m128i*)(blocks[2] + offset));
+	r3 = _mm_loadu_si128((const __m128i*)(blocks[3] + offset));
+
+	t0 = _mm_unpacklo_epi32(r0, r1);
+	t1 = _mm_unpacklo_epi32(r2, r3);
+	t2 = _mm_unpackhi_epi32(r0, r1);
+	t3 = _mm_unpackhi_epi32(r2, r3);
+
+	X[0] = _mm_unpacklo_epi64(t0, t1);
+	X[1] = _mm_unpackhi_epi64(t0, t1);
+	X[2] = _mm_unpacklo_epi64(t2, t3);
+	X[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+void md5_x4_sse2(uint32_t* state, const uint8_t* const* blocks)
+{
+	const __m128i ones = _mm_set1_epi32(-1);
+	__m128i a, b, c, d, aa, bb, cc, dd;
+	__m128i X[16];
+
+	load_words(X + 0, blocks, 0);
+	load_words(X + 4, blocks, 16);
+	load_words(X + 8, blocks, 32);
+	load_words(X + 12, blocks, 48);
+
+	a = aa = _mm_loadu_si128((const __m128i*)(state + 0 * 4));
+	b = bb = _mm_loadu_si128((const __m128i*)(state + 1 * 4));
+	c = cc = _mm_loadu_si128((const __m128i*)(state + 2 * 4));
+	d = dd = _mm_loadu_si128((const __m128i*)(state + 3 * 4));
+
+	/* Round 1. */
+	STEP(F, a, b, c, d,  0,  7, 0xd76aa478UL);
+	STEP(F, d, a, b, c,  1, 12, 0xe8c7b756UL);
+	STEP(F, c, d, a, b,  2, 17, 0x242070dbUL);
+	STEP(F, b, c, d, a,  3, 22, 0xc1bdceeeUL);
+	STEP(F, a, b, c, d,  4,  7, 0xf57c0fafUL);
+	STEP(F, d, a, b, c,  5, 12, 0x4787c62aUL);
+	STEP(F, c, d, a, b,  6, 17, 0xa8304613UL);
+	STEP(F, b, c, d, a,  7, 22, 0xfd469501UL);
+	STEP(F, a, b, c, d,  8,  7, 0x698098d8UL);
+	STEP(F, d, a, b, c,  9, 12, 0x8b44f7afUL);
+	STEP(F, c, d, a, b, 10, 17, 0xffff5bb1UL);
+	STEP(F, b, c, d, a, 11, 22, 0x895cd7beUL);
+	STEP(F, a, b, c, d, 12,  7, 0x6b901122UL);
+	STEP(F, d, a, b, c, 13, 12, 0xfd987193UL);
+	STEP(F, c, d, a, b, 14, 17, 0xa679438eUL);
+	STEP(F, b, c, d, a, 15, 22, 0x49b40821UL);
+
+	/* Round 2. */
+	STEP(G, a, b, c, d,  1,  5, 0xf61e2562UL);
+	STEP(G, d, a, b, c,  6,  9, 0xc040b340UL);
+	STEP(G, c, d, a, b, 11, 14, 0x265e5a51UL);
+	STEP(G, b, c, d, a,  0, 20, 0xe9b6c7aaUL);
+	STEP(G, a, b, c, d,  5,  5, 0xd62f105dUL);
+	STEP(G, d, a, b, c, 10,  9, 0x02441453UL);
+	STEP(G, c, d, a, b, 15, 14, 0xd8a1e681UL);
+	STEP(G, b, c, d, a,  4, 20, 0xe7d3fbc8UL);
+	STEP(G, a, b, c, d,  9,  5, 0x21e1cde6UL);
+	STEP(G, d, a, b, c, 14,  9, 0xc33707d6UL);
+	STEP(G, c, d, a, b,  3, 14, 0xf4d50d87UL);
+	STEP(G, b, c, d, a,  8, 20, 0x455a14edUL);
+	STEP(G, a, b, c, d, 13,  5, 0xa9e3e905UL);
+	STEP(G, d, a, b, c,  2,  9, 0xfcefa3f8UL);
+	STEP(G, c, d, a, b,  7, 14, 0x676f02d9UL);
+	STEP(G, b, c, d, a, 12, 20, 0x8d2a4c8aUL);
+
+	/* Round 3. */
+	STEP(H, a, b, c, d,  5,  4, 0xfffa3942UL);
+	STEP(H, d, a, b, c,  8, 11, 0x8771f681UL);
+	STEP(H, c, d, a, b, 11, 16, 0x6d9d6122UL);
+	STEP(H, b, c, d, a, 14, 23, 0xfde5380cUL);
+	STEP(H, a, b, c, d,  1,  4, 0xa4beea44UL);
+	STEP(H, d, a, b, c,  4, 11, 0x4bdecfa9UL);
+	STEP(H, c, d, a, b,  7, 16, 0xf6bb4b60UL);
+	STEP(H, b, c, d, a, 10, 23, 0xbebfbc70UL);
+	STEP(H, a, b, c, d, 13,  4, 0x289b7ec6UL);
+	STEP(H, d, a, b, c,  0, 11, 0xeaa127faUL);
+	STEP(H, c, d, a, b,  3, 16, 0xd4ef3085UL);
+	STEP(H, b, c, d, a,  6, 23, 0x04881d05UL);
+	STEP(H, a, b, c, d,  9,  4, 0xd9d4d039UL);
+	STEP(H, d, a, b, c, 12, 11, 0xe6db99e5UL);
+	STEP(H, c, d, a, b, 15, 16, 0x1fa27cf8UL);
+	STEP(H, b, c, d, a,  2, 23, 0xc4ac5665UL);
+
+	/* Round 4. */
+	STEP(I, a, b, c, d,  0,  6, 0xf4292244UL);
+	STEP(I, d, a, b, c,  7, 10, 0x432aff97UL);
+	STEP(I, c, d, a, b, 14, 15, 0xab9423a7UL);
+	STEP(I, b, c, d, a,  5, 21, 0xfc93a039UL);
+	STEP(I, a, b, c, d, 12,  6, 0x655b59c3UL);
+	STEP(I, d, a, b, c,  3, 10, 0x8f0ccc92UL);
+	STEP(I, c, d, a, b, 10, 15, 0xffeff47dUL);
+	STEP(I, b, c, d, a,  1, 21, 0x85845dd1UL);
+	STEP(I, a, b, c, d,  8,  6, 0x6fa87e4fUL);
+	STEP(I, d, a, b, c, 15, 10, 0xfe2ce6e0UL);
+	STEP(I, c, d, a, b,  6, 15, 0xa3014314UL);
+	STEP(I, b, c, d, a, 13, 21, 0x4e0811a1UL);
+	STEP(I, a, b, c, d,  4,  6, 0xf7537e82UL);
+	STEP(I, d, a, b, c, 11, 10, 0xbd3af235UL);
+	STEP(I, c, d, a, b,  2, 15, 0x2ad7d2bbUL);
+	STEP(I, b, c, d, a,  9, 21, 0xeb86d391UL);
+
+	_mm_storeu_si128((__m128i*)(state + 0 * 4), ADD(a, aa));
+	_mm_storeu_si128((__m128i*)(state + 1 * 4), ADD(b, bb));
+	_mm_storeu_si128((__m128i*)(state + 2 * 4), ADD(c, cc));
+	_mm_storeu_si128((__m128i*)(state + 3 * 4), ADD(d, dd));
+}
@@ -0,0 +1,190 @@
+/*
+ * Hashing many independent messages at once, see multibuf.h.
+ */
+
+#include <string.h>
+
+#include "multibuf.h"
+
+typedef struct {
+	int		active;
+	size_t		index;		/* of the message in the batch */
+	const uint8_t*	data;
+	size_t		full_blocks;	/* whole blocks read directly from data */
+	size_t		n_blocks;	/* full_blocks plus one or two in tail */
+	size_t		next;		/* next block to be processed */
+	uint8_t		tail[2 * HASHSTREAM_MULTIBUF_MAX_BLOCK_LENGTH];
+} lane_t;
+
+typedef union {
+	uint32_t	w32[HASHSTREAM_MULTIBUF_MAX_STATE_WORDS * HASHSTREAM_MULTIBUF_MAX_LANES];
+	uint64_t	w64[HASHSTREAM_MULTIBUF_MAX_STATE_WORDS * HASHSTREAM_MULTIBUF_MAX_LANES];
+} lane_state_t;
+
+/* Fed to lanes with no message left to hash, whose results are discarded */
+static const uint8_t idle_block[HASHSTREAM_MULTIBUF_MAX_BLOCK_LENGTH];
+
+static void store_length(const hashstream_multibuf_algorithm* alg, uint8_t* end, uint64_t len)
+{
+	uint64_t lo = len << 3, hi = len >> 61;
+	uint8_t* p = end - alg->length_bytes;
+	size_t i;
+
+	/*
+	 * The length in bits as a length_bytes wide integer ending at end.
+	 * The tail is zeroed beforehand, so at most the low nine bytes of a
+	 * wider field need writing.
+	 */
+	if (alg->big_endian) {
+		for (i = 0; i < 8; i++)
+			end[-1 - (ptrdiff_t)i] = (uint8_t)(lo >> (8 * i));
+		if (alg->length_bytes > 8)
+			end[-9] = (uint8_t)hi;
+	} else {
+		for (i = 0; i < 8; i++)
+			p[i] = (uint8_t)(lo >> (8 * i));
+		if (alg->length_bytes > 8)
+			p[8] = (uint8_t)hi;
+	}
+}
+
+static void start_lane(const hashstream_multibuf_algorithm* alg, lane_t* lane, lane_state_t* state,
+		       unsigned int l, size_t index, const uint8_t* data, size_t len)
+{
+	size_t i, remainder = len % alg->block_length;
+	size_t tail_blocks = (remainder + 1 + alg->length_bytes > alg->block_length) ? 2 : 1;
+
+	lane->active = 1;
+	lane->index = index;
+	lane->data = data;
+	lane->full_blocks = len / alg->block_length;
+	lane->n_blocks = lane->full_blocks + tail_blocks;
+	lane->next = 0;
+
+	memset(lane->tail, 0, tail_blocks * alg->block_length);
+	if (remainder > 0)
+		memcpy(lane->tail, data + len - remainder, remainder);
+	lane->tail[remainder] = 0x80;
+	store_length(alg, lane->tail + tail_blocks * alg->block_length, (uint64_t)len);
+
+	for (i = 0; i < alg->state_words; i++) {
+		if (alg->word_bytes == 4)
+			state->w32[i * alg->lanes + l] = ((const uint32_t*)alg->initial_state)[i];
+		else
+			state->w64[i * alg->lanes + l] = ((const uint64_t*)alg->initial_state)[i];
+	}
+}
+
+static const uint8_t* lane_block(const hashstream_multibuf_algorithm* alg, const lane_t* lane, size_t i)
+{
+	if (i < lane->full_blocks)
+		return lane->data + i * alg->block_length;
+	return lane->tail + (i - lane->full_blocks) * alg->block_length;
+}
+
+static void store_digest(const hashstream_multibuf_algorithm* alg, const void* words, size_t stride,
+			 uint8_t* digest)
+{
+	const uint32_t* w32 = (const uint32_t*)words;
+	const uint64_t* w64 = (const uint64_t*)words;
+	size_t i, shift;
+	uint64_t w = 0;
+
+	/* Byte order and word size are fixed per algorithm, so these branches predict perfectly */
+	for (i = 0; i < alg->digest_length; i++) {
+		shift = i & (alg->word_bytes - 1);
+		if (shift == 0)
+			w = alg->word_bytes == 4 ? w32[(i >> 2) * stride] : w64[(i >> 3) * stride];
+		if (alg->big_endian)
+			shift = alg->word_bytes - 1 - shift;
+		digest[i] = (uint8_t)(w >> (8 * shift));
+	}
+}
+
+/* Finish the message in lane l with the single-stream kernel */
+static void finish_lane(const hashstream_multibuf_algorithm* alg, const lane_t* lane, const lane_state_t* state,
+			unsigned int l, uint8_t* digests)
+{
+	uint32_t w32[HASHSTREAM_MULTIBUF_MAX_STATE_WORDS];
+	uint64_t w64[HASHSTREAM_MULTIBUF_MAX_STATE_WORDS];
+	size_t i, n_full = 0, first_tail = 0;
+	uint8_t* digest = digests + lane->index * alg->digest_length;
+
+	if (lane->next < lane->full_blocks)
+		n_full = lane->full_blocks - lane->next;
+	else
+		first_tail = lane->next - lane->full_blocks;
+
+	if (alg->word_bytes == 4) {
+		for (i = 0; i < alg->state_words; i++)
+			w32[i] = state->w32[i * alg->lanes + l];
+		if (n_full > 0)
+			alg->blocks32(w32, lane->data + lane->next * alg->block_length, n_full);
+		alg->blocks32(w32, lane->tail + first_tail * alg->block_length,
+			      lane->n_blocks - lane->full_blocks - first_tail);
+		store_digest(alg, w32, 1, digest);
+	} else {
+		for (i = 0; i < alg->state_words; i++)
+			w64[i] = state->w64[i * alg->lanes + l];
+		if (n_full > 0)
+			alg->blocks64(w64, lane->data + lane->next * alg->block_length, n_full);
+		alg->blocks64(w64, lane->tail + first_tail * alg->block_length,
+			      lane->n_blocks - lane->full_blocks - first_tail);
+		store_digest(alg, w64, 1, digest);
+	}
+}
+
+void hashstream_multibuf(const hashstream_multibuf_algorithm* alg,
+			 const uint8_t* const* data, const size_t* len, size_t n,
+			 uint8_t* digests)
+{
+	lane_t lanes[HASHSTREAM_MULTIBUF_MAX_LANES];
+	lane_state_t state;
+	const uint8_t* blocks[HASHSTREAM_MULTIBUF_MAX_LANES];
+	size_t next_message = 0, n_active = 0;
+	unsigned int l;
+
+	memset(&state, 0, sizeof(state));
+	for (l = 0; l < alg->lanes; l++) {
+		lanes[l].active = 0;
+		if (next_message < n) {
+			start_lane(alg, &lanes[l], &state, l, next_message, data[next_message], len[next_message]);
+			next_message++;
+			n_active++;
+		}
+	}
+
+	/* Lanes are refilled as they finish, so only the tail of the batch runs partly idle */
+	while (n_active > 1) {
+		for (l = 0; l < alg->lanes; l++)
+			blocks[l] = lanes[l].active ? lane_block(alg, &lanes[l], lanes[l].next) : idle_block;
+
+		if (alg->word_bytes == 4)
+			alg->lane_blocks32(state.w32, blocks);
+		else
+			alg->lane_blocks64(state.w64, blocks);
+
+		for (l = 0; l < alg->lanes; l++) {
+			if (!lanes[l].active || ++lanes[l].next < lanes[l].n_blocks)
+				continue;
+
+			if (alg->word_bytes == 4)
+				store_digest(alg, state.w32 + l, alg->lanes, digests + lanes[l].index * alg->digest_length);
+			else
+				store_digest(alg, state.w64 + l, alg->lanes, digests + lanes[l].index * alg->digest_length);
+
+			if (next_message < n) {
+				start_lane(alg, &lanes[l], &state, l, next_message, data[next_message], len[next_message]);
+				next_message++;
+			} else {
+				lanes[l].active = 0;
+				n_active--;
+			}
+		}
+	}
+
+	for (l = 0; l < alg->lanes; l++) {
+		if (lanes[l].active)
+			finish_lane(alg, &lanes[l], &state, l, digests);
+	}
+}
@@ -0,0 +1,61 @@
+/*
+ * Hashing many independent messages at once.
+ *
+ * Multi-buffer kernels process one block from each of several messages
+ * in parallel, one message per SIMD lane. hashstream_multibuf() drives
+ * such a kernel: it pads each message itself, starts the next message
+ * in a lane as soon as the previous one finishes so that lanes are kept
+ * busy whatever the spread of message lengths, and hands the last
+ * message in flight to the single-stream kernel rather than running a
+ * mostly idle batch to completion.
+ */
+
+#ifndef __HASHSTREAM_MULTIBUF_H
+#define __HASHSTREAM_MULTIBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HASHSTREAM_MULTIBUF_MAX_LANES		8
+#define HASHSTREAM_MULTIBUF_MAX_BLOCK_LENGTH	128
+#define HASHSTREAM_MULTIBUF_MAX_STATE_WORDS	8
+
+/* Description of a Merkle-Damgard hash function for hashstream_multibuf() */
+typedef struct {
+	unsigned int	lanes;		/* messages processed together by the lane kernel */
+	size_t		block_length;	/* bytes per block */
+	size_t		word_bytes;	/* 4 or 8 */
+	size_t		state_words;	/* chaining variables */
+	size_t		length_bytes;	/* bytes of message length closing the padding */
+	int		big_endian;	/* byte order of the length and the digest */
+	const void*	initial_state;	/* state_words words */
+	size_t		digest_length;	/* leading bytes of the final state output */
+
+	/* Used when word_bytes is 4 */
+	hashstream_lanes32_fn	lane_blocks32;
+	hashstream_blocks32_fn	blocks32;
+
+	/* Used when word_bytes is 8 */
+	hashstream_lanes64_fn	lane_blocks64;
+	hashstream_blocks64_fn	blocks64;
+} hashstream_multibuf_algorithm;
+
+/*
+ * Hash the n messages data[i] of len[i] bytes, writing each digest to
+ * digests + i * digest_length.
+ */
+void hashstream_multibuf(const hashstream_multibuf_algorithm* alg,
+			 const uint8_t* const* data, const size_t* len, size_t n,
+			 uint8_t* digests);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HASHSTREAM_MULTIBUF_H */
@@ -64,6 +64,22 @@ code cleanup, removed attribution comments
 switched SHA1Final() argument order for consistency
 use SHA1_ prefix for public api
 move public api to sha1.h
+
+-----------------
+Modified 10/2026
+For the hashstream library
+Still 100% public domain
+process whole blocks through the runtime-selected kernel table in
+dispatch.h, with SHA1_Transform() as the portable fallback
+SHA1_Transform() expands the message schedule into a local array
+rather than into the caller's buffer, which is never written to; this
+makes it reentrant and endian-independent, so SHA1HANDSOFF and
+WORDS_BIGENDIAN are no longer needed
+added SHA1_Many() over the multi-buffer kernels
+added SHA1_Transform_blocks() to feed whole blocks from a context
+straight to the block function, and route SHA1_Update() through it;
+fixed the carry into count[1] for a single SHA1_Update() of 512MB or
+more
 */
 
 /*
@@ -76,8 +92,6 @@ A million repetitions of "a"
   34AA973C D4C4DAA4 F61EEB2B DBAD2731 6534016F
 */
 
-/* #define SHA1HANDSOFF  */
-
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -87,22 +101,19 @@ A million repetitions of "a"
 
 #include <stdint.h>
 #include "sha1.h"
+#include "dispatch.h"
+#include "multibuf.h"
 
 void SHA1_Transform(uint32_t state[5], const uint8_t buffer[64]);
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
 
-/* blk0() and blk() perform the initial expand. */
+/* blk0() and blk() perform the initial expand into the local schedule W[]. */
 /* I got the idea of expanding during the round function from SSLeay */
-/* FIXME: can we do this in an endian-proof way? */
-#ifdef WORDS_BIGENDIAN
-#define blk0(i) block->l[i]
-#else
-#define blk0(i) (block->l[i] = (rol(block->l[i],24)&0xFF00FF00) \
-    |(rol(block->l[i],8)&0x00FF00FF))
-#endif
-#define blk(i) (block->l[i&15] = rol(block->l[(i+13)&15]^block->l[(i+8)&15] \
-    ^block->l[(i+2)&15]^block->l[i&15],1))
+#define blk0(i) (W[i] = ((uint32_t)buffer[4*(i)] << 24) | ((uint32_t)buffer[4*(i)+1] << 16) \
+    | ((uint32_t)buffer[4*(i)+2] << 8) | (uint32_t)buffer[4*(i)+3])
+#define blk(i) (W[i&15] = rol(W[(i+13)&15]^W[(i+8)&15] \
+    ^W[(i+2)&15]^W[i&15],1))
 
 /* (R0+R1), R2, R3, R4 are the different operations used in SHA1 */
 #define R0(v,w,x,y,z,i) z+=((w&(x^y))^y)+blk0(i)+0x5A827999+rol(v,5);w=rol(w,30);
@@ -126,22 +137,11 @@ void SHAPrintContext(SHA1_CTX *context, char *msg){
 #endif /* VERBOSE */
 
 /* Hash a single 512-bit block. This is the core of the algorithm. */
+/* buffer is only read and all working storage is local, so this is reentrant. */
 void SHA1_Transform(uint32_t state[5], const uint8_t buffer[64])
 {
     uint32_t a, b, c, d, e;
-    typedef union {
-        uint8_t c[64];
-        uint32_t l[16];
-    } CHAR64LONG16;
-    CHAR64LONG16* block;
-
-#ifdef SHA1HANDSOFF
-    static uint8_t workspace[64];
-    block = (CHAR64LONG16*)workspace;
-    memcpy(block, buffer, 64);
-#else
-    block = (CHAR64LONG16*)buffer;
-#endif
+    uint32_t W[16];
 
     /* Copy context->state[] to working vars */
     a = state[0];
@@ -181,22 +181,52 @@ void SHA1_Transform(uint32_t state[5], const uint8_t buffer[64])
 
     /* Wipe variables */
     a = b = c = d = e = 0;
+    memset(W, 0, sizeof(W));
+}
+
+
+/* Hash whole 512-bit blocks with the portable transform */
+void sha1_blocks_generic(uint32_t state[5], const uint8_t* data, size_t n_blocks)
+{
+    for ( ; n_blocks > 0; n_blocks--, data += 64) {
+        SHA1_Transform(state, data);
+    }
 }
 
 
+/* SHA1 initialization constants */
+static const uint32_t SHA1_initial_state[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+
 /* SHA1Init - Initialize new context */
 void SHA1_Init(SHA1_CTX* context)
 {
-    /* SHA1 initialization constants */
-    context->state[0] = 0x67452301;
-    context->state[1] = 0xEFCDAB89;
-    context->state[2] = 0x98BADCFE;
-    context->state[3] = 0x10325476;
-    context->state[4] = 0xC3D2E1F0;
+    memcpy(context->state, SHA1_initial_state, sizeof(SHA1_initial_state));
     context->count[0] = context->count[1] = 0;
 }
 
 
+/* Add len bytes to the message length */
+static void SHA1_Count(SHA1_CTX* context, uint64_t len)
+{
+    uint64_t bits = len << 3;
+
+    if ((context->count[0] += (uint32_t)bits) < (uint32_t)bits) context->count[1]++;
+    context->count[1] += (uint32_t)(bits >> 32);
+}
+
+
+/* Hash n_blocks whole 512-bit blocks. The context must be on a block */
+/* boundary, i.e. all data given to it so far is a multiple of 64 bytes. */
+void SHA1_Transform_blocks(SHA1_CTX* context, const uint8_t* data, size_t n_blocks)
+{
+    hashstream_get_kernels()->sha1_blocks(context->state, data, n_blocks);
+    SHA1_Count(context, (uint64_t)n_blocks * 64);
+}
+
+
 /* Run your data through this. */
 void SHA1_Update(SHA1_CTX* context, const uint8_t* data, const size_t len)
 {
@@ -207,18 +237,19 @@ void SHA1_Update(SHA1_CTX* context, const uint8_t* data, const size_t len)
 #endif
 
     j = (context->count[0] >> 3) & 63;
-    if ((context->count[0] += len << 3) < (len << 3)) context->count[1]++;
-    context->count[1] += (len >> 29);
     if ((j + len) > 63) {
         memcpy(&context->buffer[j], data, (i = 64-j));
-        SHA1_Transform(context->state, context->buffer);
-        for ( ; i + 63 < len; i += 64) {
-            SHA1_Transform(context->state, data + i);
+        SHA1_Count(context, i);
+        hashstream_get_kernels()->sha1_blocks(context->state, context->buffer, 1);
+        if (i + 63 < len) {
+            SHA1_Transform_blocks(context, data + i, (len - i) / 64);
+            i += (len - i) & ~(size_t)63;
         }
         j = 0;
     }
     else i = 0;
     memcpy(&context->buffer[j], &data[i], len - i);
+    SHA1_Count(context, len - i);
 
 #ifdef VERBOSE
     SHAPrintContext(context, "after ");
@@ -252,10 +283,39 @@ void SHA1_Final(SHA1_CTX* context, uint8_t digest[SHA1_DIGEST_SIZE])
     memset(context->state, 0, 20);
     memset(context->count, 0, 8);
     memset(finalcount, 0, 8);	/* SWR */
+}
 
-#ifdef SHA1HANDSOFF  /* make SHA1Transform overwrite its own static vars */
-    SHA1_Transform(context->state, context->buffer);
-#endif
+
+/* Hash n independent messages, several at a time where a multi-buffer */
+/* kernel is available (see multibuf.h) and one after another otherwise. */
+void SHA1_Many(const uint8_t* const* data, const size_t* len, size_t n, uint8_t (*digest)[SHA1_DIGEST_SIZE])
+{
+    const hashstream_kernels* kernels = hashstream_get_kernels();
+    hashstream_multibuf_algorithm alg;
+    SHA1_CTX context;
+    size_t i;
+
+    if (kernels->sha1_lanes == NULL) {
+        for (i = 0; i < n; i++) {
+            SHA1_Init(&context);
+            SHA1_Update(&context, data[i], len[i]);
+            SHA1_Final(&context, digest[i]);
+        }
+        return;
+    }
+
+    memset(&alg, 0, sizeof(alg));
+    alg.lanes = kernels->sha1_lane_count;
+    alg.block_length = 64;
+    alg.word_bytes = 4;
+    alg.state_words = 5;
+    alg.length_bytes = 8;
+    alg.big_endian = 1;
+    alg.initial_state = SHA1_initial_state;
+    alg.digest_length = SHA1_DIGEST_SIZE;
+    alg.lane_blocks32 = kernels->sha1_lanes;
+    alg.blocks32 = kernels->sha1_blocks;
+    hashstream_multibuf(&alg, data, len, n, (uint8_t*)digest);
 }
   
 /*************************************************************/
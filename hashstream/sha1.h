@@ -18,8 +18,12 @@ typedef struct {
 
 void SHA1_Init(SHA1_CTX* context);
 void SHA1_Update(SHA1_CTX* context, const uint8_t* data, const size_t len);
+void SHA1_Transform_blocks(SHA1_CTX* context, const uint8_t* data, size_t n_blocks);
 void SHA1_Final(SHA1_CTX* context, uint8_t digest[SHA1_DIGEST_SIZE]);
 
+/* Hash n independent messages data[i] of len[i] bytes into digest[i] */
+void SHA1_Many(const uint8_t* const* data, const size_t* len, size_t n, uint8_t (*digest)[SHA1_DIGEST_SIZE]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,139 @@
+/*
+ * SHA-1 block function using the Intel SHA extensions.
+ *
+ * This file is compiled with -msse4.1 -msha and must only be called
+ * through the kernel table, which selects it when the CPU reports both
+ * the SHA and SSE4.1 extensions, see dispatch.c.
+ *
+ * A, B, C and D are held in one register and E in the top lane of
+ * another. Each sha1rnds4 performs four rounds, with sha1nexte deriving
+ * the next E from the previous A. The message schedule is computed four
+ * words at a time with sha1msg1/sha1msg2 and overlaps with the rounds
+ * which consume earlier words. The input is never written to.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+/* Load four big-endian message words, most significant lane first */
+#define LOAD_MSG(w, i) \
+	(w) = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * (i))), bswap)
+
+/* Four rounds using message words w and round function f */
+#define ROUNDS(e, e_next, w, f) do { \
+	(e) = _mm_sha1nexte_epu32((e), (w)); \
+	(e_next) = abcd; \
+	abcd = _mm_sha1rnds4_epu32(abcd, (e), (f)); \
+} while (0)
+
+/* Begin the schedule for the words three groups on from cur, in prev */
+#define MSG_BEGIN(prev, cur) \
+	(prev) = _mm_sha1msg1_epu32((prev), (cur))
+
+/* Mix cur into the schedule for the words two groups on, in w */
+#define MSG_MIX(w, cur) \
+	(w) = _mm_xor_si128((w), (cur))
+
+/* Finish the schedule for the words following cur, in next */
+#define MSG_END(next, cur) \
+	(next) = _mm_sha1msg2_epu32((next), (cur))
+
+void sha1_blocks_shani(uint32_t state[5], const uint8_t* data, size_t n_blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i abcd, abcd_saved, e0, e1, e_saved;
+	__m128i w0, w1, w2, w3;
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1b);
+	e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+	for (; n_blocks > 0; n_blocks--, data += 64) {
+		abcd_saved = abcd;
+		e_saved = e0;
+
+		LOAD_MSG(w0, 0);
+		e0 = _mm_add_epi32(e0, w0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		LOAD_MSG(w1, 1);
+		ROUNDS(e1, e0, w1, 0);
+		MSG_BEGIN(w0, w1);
+		LOAD_MSG(w2, 2);
+		ROUNDS(e0, e1, w2, 0);
+		MSG_BEGIN(w1, w2);
+		MSG_MIX(w0, w2);
+		LOAD_MSG(w3, 3);
+		ROUNDS(e1, e0, w3, 0);
+		MSG_END(w0, w3);
+		MSG_BEGIN(w2, w3);
+		MSG_MIX(w1, w3);
+		ROUNDS(e0, e1, w0, 0);
+		MSG_END(w1, w0);
+		MSG_BEGIN(w3, w0);
+		MSG_MIX(w2, w0);
+
+		ROUNDS(e1, e0, w1, 1);
+		MSG_END(w2, w1);
+		MSG_BEGIN(w0, w1);
+		MSG_MIX(w3, w1);
+		ROUNDS(e0, e1, w2, 1);
+		MSG_END(w3, w2);
+		MSG_BEGIN(w1, w2);
+		MSG_MIX(w0, w2);
+		ROUNDS(e1, e0, w3, 1);
+		MSG_END(w0, w3);
+		MSG_BEGIN(w2, w3);
+		MSG_MIX(w1, w3);
+		ROUNDS(e0, e1, w0, 1);
+		MSG_END(w1, w0);
+		MSG_BEGIN(w3, w0);
+		MSG_MIX(w2, w0);
+		ROUNDS(e1, e0, w1, 1);
+		MSG_END(w2, w1);
+		MSG_BEGIN(w0, w1);
+		MSG_MIX(w3, w1);
+
+		ROUNDS(e0, e1, w2, 2);
+		MSG_END(w3, w2);
+		MSG_BEGIN(w1, w2);
+		MSG_MIX(w0, w2);
+		ROUNDS(e1, e0, w3, 2);
+		MSG_END(w0, w3);
+		MSG_BEGIN(w2, w3);
+		MSG_MIX(w1, w3);
+		ROUNDS(e0, e1, w0, 2);
+		MSG_END(w1, w0);
+		MSG_BEGIN(w3, w0);
+		MSG_MIX(w2, w0);
+		ROUNDS(e1, e0, w1, 2);
+		MSG_END(w2, w1);
+		MSG_BEGIN(w0, w1);
+		MSG_MIX(w3, w1);
+		ROUNDS(e0, e1, w2, 2);
+		MSG_END(w3, w2);
+		MSG_BEGIN(w1, w2);
+		MSG_MIX(w0, w2);
+
+		ROUNDS(e1, e0, w3, 3);
+		MSG_END(w0, w3);
+		MSG_BEGIN(w2, w3);
+		MSG_MIX(w1, w3);
+		ROUNDS(e0, e1, w0, 3);
+		MSG_END(w1, w0);
+		MSG_BEGIN(w3, w0);
+		MSG_MIX(w2, w0);
+		ROUNDS(e1, e0, w1, 3);
+		MSG_END(w2, w1);
+		MSG_MIX(w3, w1);
+		ROUNDS(e0, e1, w2, 3);
+		MSG_END(w3, w2);
+		ROUNDS(e1, e0, w3, 3);
+
+		e0 = _mm_sha1nexte_epu32(e0, e_saved);
+		abcd = _mm_add_epi32(abcd, abcd_saved);
+	}
+
+	_mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
@@ -0,0 +1,131 @@
+/*
+ * Eight-lane SHA-1 using AVX2, see multibuf.h.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * Each 256-bit register holds the same variable for eight independent
+ * messages, so the rounds are exactly those of SHA1_Transform() in
+ * sha1.c, with the same round functions, constants and rotation of the
+ * working variables, performed on eight 32-bit lanes at once. AVX2 has
+ * no vector rotate, so rotations are a pair of shifts.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+#define ADD(x, y)	_mm256_add_epi32((x), (y))
+#define XOR(x, y)	_mm256_xor_si256((x), (y))
+#define rol(x, n)	_mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+/* blk() extends the message schedule in W[] to word i */
+#define blk(i) (W[(i) & 15] = rol(XOR(XOR(W[((i) + 13) & 15], W[((i) + 8) & 15]), \
+	XOR(W[((i) + 2) & 15], W[(i) & 15])), 1))
+
+/* The round functions of the four groups of twenty rounds */
+#define f1(w, x, y)	XOR(_mm256_and_si256((w), XOR((x), (y))), (y))
+#define f2(w, x, y)	XOR(XOR((w), (x)), (y))
+#define f3(w, x, y)	_mm256_or_si256(_mm256_and_si256(_mm256_or_si256((w), (x)), (y)), _mm256_and_si256((w), (x)))
+
+#define ROUND(f, k, v, w, x, y, z, m) do { \
+	(z) = ADD((z), ADD(ADD(f((w), (x), (y)), (m)), ADD(_mm256_set1_epi32((int)(k)), rol((v), 5)))); \
+	(w) = rol((w), 30); \
+} while (0)
+
+/* (R0+R1), R2, R3, R4 are the different operations used in SHA1 */
+#define R0(v, w, x, y, z, i)	ROUND(f1, 0x5A827999, v, w, x, y, z, W[i])
+#define R1(v, w, x, y, z, i)	ROUND(f1, 0x5A827999, v, w, x, y, z, blk(i))
+#define R2(v, w, x, y, z, i)	ROUND(f2, 0x6ED9EBA1, v, w, x, y, z, blk(i))
+#define R3(v, w, x, y, z, i)	ROUND(f3, 0x8F1BBCDC, v, w, x, y, z, blk(i))
+#define R4(v, w, x, y, z, i)	ROUND(f2, 0xCA62C1D6, v, w, x, y, z, blk(i))
+
+/* Load eight words at offset from each lane's block and transpose them into W[0..7] */
+static void load_words(__m256i* W, const uint8_t* const* blocks, size_t offset)
+{
+	const __m256i bswap = _mm256_set_epi8(
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	__m256i r0, r1, r2, r3, r4, r5, r6, r7;
+	__m256i t0, t1, t2, t3, t4, t5, t6, t7;
+
+	r0 = _mm256_loadu_si256((const __m256i*)(blocks[0] + offset));
+	r1 = _mm256_loadu_si256((const __m256i*)(blocks[1] + offset));
+	r2 = _mm256_loadu_si256((const __m256i*)(blocks[2] + offset));
+	r3 = _mm256_loadu_si256((const __m256i*)(blocks[3] + offset));
+	r4 = _mm256_loadu_si256((const __m256i*)(blocks[4] + offset));
+	r5 = _mm256_loadu_si256((const __m256i*)(blocks[5] + offset));
+	r6 = _mm256_loadu_si256((const __m256i*)(blocks[6] + offset));
+	r7 = _mm256_loadu_si256((const __m256i*)(blocks[7] + offset));
+
+	t0 = _mm256_unpacklo_epi32(r0, r1);
+	t1 = _mm256_unpackhi_epi32(r0, r1);
+	t2 = _mm256_unpacklo_epi32(r2, r3);
+	t3 = _mm256_unpackhi_epi32(r2, r3);
+	t4 = _mm256_unpacklo_epi32(r4, r5);
+	t5 = _mm256_unpackhi_epi32(r4, r5);
+	t6 = _mm256_unpacklo_epi32(r6, r7);
+	t7 = _mm256_unpackhi_epi32(r6, r7);
+
+	r0 = _mm256_unpacklo_epi64(t0, t2);
+	r1 = _mm256_unpackhi_epi64(t0, t2);
+	r2 = _mm256_unpacklo_epi64(t1, t3);
+	r3 = _mm256_unpackhi_epi64(t1, t3);
+	r4 = _mm256_unpacklo_epi64(t4, t6);
+	r5 = _mm256_unpackhi_epi64(t4, t6);
+	r6 = _mm256_unpacklo_epi64(t5, t7);
+	r7 = _mm256_unpackhi_epi64(t5, t7);
+
+	W[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x20), bswap);
+	W[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x20), bswap);
+	W[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x20), bswap);
+	W[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x20), bswap);
+	W[4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x31), bswap);
+	W[5] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x31), bswap);
+	W[6] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x31), bswap);
+	W[7] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x31), bswap);
+}
+
+void sha1_x8_avx2(uint32_t* state, const uint8_t* const* blocks)
+{
+	__m256i a, b, c, d, e;
+	__m256i W[16];
+
+	load_words(W, blocks, 0);
+	load_words(W + 8, blocks, 32);
+
+	a = _mm256_loadu_si256((const __m256i*)(state + 0 * 8));
+	b = _mm256_loadu_si256((const __m256i*)(state + 1 * 8));
+	c = _mm256_loadu_si256((const __m256i*)(state + 2 * 8));
+	d = _mm256_loadu_si256((const __m256i*)(state + 3 * 8));
+	e = _mm256_loadu_si256((const __m256i*)(state + 4 * 8));
+
+	/* 4 rounds of 20 operations each. Loop unrolled. */
+	R0(a,b,c,d,e, 0); R0(e,a,b,c,d, 1); R0(d,e,a,b,c, 2); R0(c,d,e,a,b, 3);
+	R0(b,c,d,e,a, 4); R0(a,b,c,d,e, 5); R0(e,a,b,c,d, 6); R0(d,e,a,b,c, 7);
+	R0(c,d,e,a,b, 8); R0(b,c,d,e,a, 9); R0(a,b,c,d,e,10); R0(e,a,b,c,d,11);
+	R0(d,e,a,b,c,12); R0(c,d,e,a,b,13); R0(b,c,d,e,a,14); R0(a,b,c,d,e,15);
+	R1(e,a,b,c,d,16); R1(d,e,a,b,c,17); R1(c,d,e,a,b,18); R1(b,c,d,e,a,19);
+	R2(a,b,c,d,e,20); R2(e,a,b,c,d,21); R2(d,e,a,b,c,22); R2(c,d,e,a,b,23);
+	R2(b,c,d,e,a,24); R2(a,b,c,d,e,25); R2(e,a,b,c,d,26); R2(d,e,a,b,c,27);
+	R2(c,d,e,a,b,28); R2(b,c,d,e,a,29); R2(a,b,c,d,e,30); R2(e,a,b,c,d,31);
+	R2(d,e,a,b,c,32); R2(c,d,e,a,b,33); R2(b,c,d,e,a,34); R2(a,b,c,d,e,35);
+	R2(e,a,b,c,d,36); R2(d,e,a,b,c,37); R2(c,d,e,a,b,38); R2(b,c,d,e,a,39);
+	R3(a,b,c,d,e,40); R3(e,a,b,c,d,41); R3(d,e,a,b,c,42); R3(c,d,e,a,b,43);
+	R3(b,c,d,e,a,44); R3(a,b,c,d,e,45); R3(e,a,b,c,d,46); R3(d,e,a,b,c,47);
+	R3(c,d,e,a,b,48); R3(b,c,d,e,a,49); R3(a,b,c,d,e,50); R3(e,a,b,c,d,51);
+	R3(d,e,a,b,c,52); R3(c,d,e,a,b,53); R3(b,c,d,e,a,54); R3(a,b,c,d,e,55);
+	R3(e,a,b,c,d,56); R3(d,e,a,b,c,57); R3(c,d,e,a,b,58); R3(b,c,d,e,a,59);
+	R4(a,b,c,d,e,60); R4(e,a,b,c,d,61); R4(d,e,a,b,c,62); R4(c,d,e,a,b,63);
+	R4(b,c,d,e,a,64); R4(a,b,c,d,e,65); R4(e,a,b,c,d,66); R4(d,e,a,b,c,67);
+	R4(c,d,e,a,b,68); R4(b,c,d,e,a,69); R4(a,b,c,d,e,70); R4(e,a,b,c,d,71);
+	R4(d,e,a,b,c,72); R4(c,d,e,a,b,73); R4(b,c,d,e,a,74); R4(a,b,c,d,e,75);
+	R4(e,a,b,c,d,76); R4(d,e,a,b,c,77); R4(c,d,e,a,b,78); R4(b,c,d,e,a,79);
+
+	_mm256_storeu_si256((__m256i*)(state + 0 * 8), ADD(a, _mm256_loadu_si256((const __m256i*)(state + 0 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 1 * 8), ADD(b, _mm256_loadu_si256((const __m256i*)(state + 1 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 2 * 8), ADD(c, _mm256_loadu_si256((const __m256i*)(state + 2 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 3 * 8), ADD(d, _mm256_loadu_si256((const __m256i*)(state + 3 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 4 * 8), ADD(e, _mm256_loadu_si256((const __m256i*)(state + 4 * 8))));
+}
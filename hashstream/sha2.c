@@ -35,6 +35,8 @@
 #include <string.h>	/* memcpy()/memset() or bcopy()/bzero() */
 #include <assert.h>	/* assert() */
 #include "sha2.h"
+#include "dispatch.h"
+#include "multibuf.h"
 
 /*
  * ASSERT NOTE:
@@ -220,8 +222,18 @@ typedef u_int64_t sha2_word64;	/* Exactly 8 bytes */
  * only.
  */
 void SHA512_Last(SHA512_CTX*);
-void SHA256_Transform(SHA256_CTX*, const sha2_word32*);
-void SHA512_Transform(SHA512_CTX*, const sha2_word64*);
+static void SHA256_Transform(sha2_word32*, const sha2_word32*);
+static void SHA512_Transform(sha2_word64*, const sha2_word64*);
+
+/*
+ * Whole blocks are processed by the kernels selected at runtime (see
+ * dispatch.h), SHA256_Transform() and SHA512_Transform() being the
+ * portable fallbacks:
+ */
+#define SHA256_BLOCKS(ctx, data, n) \
+	(hashstream_get_kernels()->sha256_blocks((ctx)->state, (data), (n)))
+#define SHA512_BLOCKS(ctx, data, n) \
+	(hashstream_get_kernels()->sha512_blocks((ctx)->state, (data), (n)))
 
 
 /*** SHA-XYZ INITIAL HASH VALUES AND CONSTANTS ************************/
@@ -379,22 +391,20 @@ void SHA256_Init(SHA256_CTX* context) {
 	(h) = T1 + Sigma0_256(a) + Maj((a), (b), (c)); \
 	j++
 
-void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
+static void SHA256_Transform(sha2_word32* state, const sha2_word32* data) {
 	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
-	sha2_word32	T1, *W256;
+	sha2_word32	T1, W256[16];
 	int		j;
 
-	W256 = (sha2_word32*)context->buffer;
-
 	/* Initialize registers with the prev. intermediate value */
-	a = context->state[0];
-	b = context->state[1];
-	c = context->state[2];
-	d = context->state[3];
-	e = context->state[4];
-	f = context->state[5];
-	g = context->state[6];
-	h = context->state[7];
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
 
 	j = 0;
 	do {
@@ -422,14 +432,14 @@ void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 	} while (j < 64);
 
 	/* Compute the current intermediate hash value */
-	context->state[0] += a;
-	context->state[1] += b;
-	context->state[2] += c;
-	context->state[3] += d;
-	context->state[4] += e;
-	context->state[5] += f;
-	context->state[6] += g;
-	context->state[7] += h;
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = 0;
@@ -437,22 +447,20 @@ void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 
 #else /* SHA2_UNROLL_TRANSFORM */
 
-void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
+static void SHA256_Transform(sha2_word32* state, const sha2_word32* data) {
 	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
-	sha2_word32	T1, T2, *W256;
+	sha2_word32	T1, T2, W256[16];
 	int		j;
 
-	W256 = (sha2_word32*)context->buffer;
-
 	/* Initialize registers with the prev. intermediate value */
-	a = context->state[0];
-	b = context->state[1];
-	c = context->state[2];
-	d = context->state[3];
-	e = context->state[4];
-	f = context->state[5];
-	g = context->state[6];
-	h = context->state[7];
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
 
 	j = 0;
 	do {
@@ -502,14 +510,14 @@ void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 	} while (j < 64);
 
 	/* Compute the current intermediate hash value */
-	context->state[0] += a;
-	context->state[1] += b;
-	context->state[2] += c;
-	context->state[3] += d;
-	context->state[4] += e;
-	context->state[5] += f;
-	context->state[6] += g;
-	context->state[7] += h;
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = T2 = 0;
@@ -517,6 +525,26 @@ void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+void sha256_blocks_generic(uint32_t state[8], const uint8_t* data, size_t n_blocks) {
+	for (; n_blocks > 0; n_blocks--, data += SHA256_BLOCK_LENGTH) {
+		SHA256_Transform(state, (const sha2_word32*)data);
+	}
+}
+
+/*
+ * Process n_blocks whole blocks from data with a single call to the
+ * block function. The context must be on a block boundary, as it is
+ * after SHA256_Init() or after any sequence of SHA256_Update() calls
+ * totalling a multiple of SHA256_BLOCK_LENGTH bytes:
+ */
+void SHA256_Transform_blocks(SHA256_CTX* context, const sha2_byte* data, size_t n_blocks) {
+	/* Sanity check: */
+	assert(context != (SHA256_CTX*)0 && (context->bitcount >> 3) % SHA256_BLOCK_LENGTH == 0);
+
+	SHA256_BLOCKS(context, data, n_blocks);
+	context->bitcount += (sha2_word64)n_blocks * SHA256_BLOCK_LENGTH << 3;
+}
+
 void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -539,7 +567,7 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Transform(context, (sha2_word32*)context->buffer);
+			SHA256_BLOCKS(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -549,12 +577,12 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= SHA256_BLOCK_LENGTH) {
+	if (len >= SHA256_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
-		SHA256_Transform(context, (sha2_word32*)data);
-		context->bitcount += SHA256_BLOCK_LENGTH << 3;
-		len -= SHA256_BLOCK_LENGTH;
-		data += SHA256_BLOCK_LENGTH;
+		size_t	blocks = len / SHA256_BLOCK_LENGTH;
+		SHA256_Transform_blocks(context, data, blocks);
+		len -= blocks * SHA256_BLOCK_LENGTH;
+		data += blocks * SHA256_BLOCK_LENGTH;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -591,7 +619,7 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 					MEMSET_BZERO(&context->buffer[usedspace], SHA256_BLOCK_LENGTH - usedspace);
 				}
 				/* Do second-to-last transform: */
-				SHA256_Transform(context, (sha2_word32*)context->buffer);
+				SHA256_BLOCKS(context, context->buffer, 1);
 
 				/* And set-up for the last transform: */
 				MEMSET_BZERO(context->buffer, SHA256_SHORT_BLOCK_LENGTH);
@@ -607,7 +635,7 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 		*(sha2_word64*)&context->buffer[SHA256_SHORT_BLOCK_LENGTH] = context->bitcount;
 
 		/* Final transform: */
-		SHA256_Transform(context, (sha2_word32*)context->buffer);
+		SHA256_BLOCKS(context, context->buffer, 1);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
 		{
@@ -659,6 +687,39 @@ char* SHA256_Data(const sha2_byte* data, size_t len, char digest[SHA256_DIGEST_S
 	return SHA256_End(&context, digest);
 }
 
+/*
+ * Hash n independent messages, several at a time where a multi-buffer
+ * kernel is available (see multibuf.h) and one after another otherwise:
+ */
+void SHA256_Many(const sha2_byte* const* data, const size_t* len, size_t n, sha2_byte (*digest)[SHA256_DIGEST_LENGTH]) {
+	const hashstream_kernels	*kernels = hashstream_get_kernels();
+	hashstream_multibuf_algorithm	alg;
+	SHA256_CTX			context;
+	size_t				i;
+
+	if (kernels->sha256_lanes == NULL) {
+		for (i = 0; i < n; i++) {
+			SHA256_Init(&context);
+			SHA256_Update(&context, data[i], len[i]);
+			SHA256_Final(digest[i], &context);
+		}
+		return;
+	}
+
+	MEMSET_BZERO(&alg, sizeof(alg));
+	alg.lanes = kernels->sha256_lane_count;
+	alg.block_length = SHA256_BLOCK_LENGTH;
+	alg.word_bytes = sizeof(sha2_word32);
+	alg.state_words = 8;
+	alg.length_bytes = SHA256_BLOCK_LENGTH - SHA256_SHORT_BLOCK_LENGTH;
+	alg.big_endian = 1;
+	alg.initial_state = sha256_initial_hash_value;
+	alg.digest_length = SHA256_DIGEST_LENGTH;
+	alg.lane_blocks32 = kernels->sha256_lanes;
+	alg.blocks32 = kernels->sha256_blocks;
+	hashstream_multibuf(&alg, data, len, n, (sha2_byte*)digest);
+}
+
 
 /*** SHA-512: *********************************************************/
 void SHA512_Init(SHA512_CTX* context) {
@@ -706,20 +767,20 @@ void SHA512_Init(SHA512_CTX* context) {
 	(h) = T1 + Sigma0_512(a) + Maj((a), (b), (c)); \
 	j++
 
-void SHA512_Transform(SHA512_CTX* context, const sha2_word64* data) {
+static void SHA512_Transform(sha2_word64* state, const sha2_word64* data) {
 	sha2_word64	a, b, c, d, e, f, g, h, s0, s1;
-	sha2_word64	T1, *W512 = (sha2_word64*)context->buffer;
+	sha2_word64	T1, W512[16];
 	int		j;
 
 	/* Initialize registers with the prev. intermediate value */
-	a = context->state[0];
-	b = context->state[1];
-	c = context->state[2];
-	d = context->state[3];
-	e = context->state[4];
-	f = context->state[5];
-	g = context->state[6];
-	h = context->state[7];
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
 
 	j = 0;
 	do {
@@ -746,14 +807,14 @@ void SHA512_Transform(SHA512_CTX* context, const sha2_word64* data) {
 	} while (j < 80);
 
 	/* Compute the current intermediate hash value */
-	context->state[0] += a;
-	context->state[1] += b;
-	context->state[2] += c;
-	context->state[3] += d;
-	context->state[4] += e;
-	context->state[5] += f;
-	context->state[6] += g;
-	context->state[7] += h;
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = 0;
@@ -761,20 +822,20 @@ void SHA512_Transform(SHA512_CTX* context, const sha2_word64* data) {
 
 #else /* SHA2_UNROLL_TRANSFORM */
 
-void SHA512_Transform(SHA512_CTX* context, const sha2_word64* data) {
+static void SHA512_Transform(sha2_word64* state, const sha2_word64* data) {
 	sha2_word64	a, b, c, d, e, f, g, h, s0, s1;
-	sha2_word64	T1, T2, *W512 = (sha2_word64*)context->buffer;
+	sha2_word64	T1, T2, W512[16];
 	int		j;
 
 	/* Initialize registers with the prev. intermediate value */
-	a = context->state[0];
-	b = context->state[1];
-	c = context->state[2];
-	d = context->state[3];
-	e = context->state[4];
-	f = context->state[5];
-	g = context->state[6];
-	h = context->state[7];
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
 
 	j = 0;
 	do {
@@ -824,14 +885,14 @@ void SHA512_Transform(SHA512_CTX* context, const sha2_word64* data) {
 	} while (j < 80);
 
 	/* Compute the current intermediate hash value */
-	context->state[0] += a;
-	context->state[1] += b;
-	context->state[2] += c;
-	context->state[3] += d;
-	context->state[4] += e;
-	context->state[5] += f;
-	context->state[6] += g;
-	context->state[7] += h;
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = T2 = 0;
@@ -839,6 +900,24 @@ void SHA512_Transform(SHA512_CTX* context, const sha2_word64* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+void sha512_blocks_generic(uint64_t state[8], const uint8_t* data, size_t n_blocks) {
+	for (; n_blocks > 0; n_blocks--, data += SHA512_BLOCK_LENGTH) {
+		SHA512_Transform(state, (const sha2_word64*)data);
+	}
+}
+
+/*
+ * Process n_blocks whole blocks from data, as SHA256_Transform_blocks()
+ * but on a SHA512_BLOCK_LENGTH boundary:
+ */
+void SHA512_Transform_blocks(SHA512_CTX* context, const sha2_byte* data, size_t n_blocks) {
+	/* Sanity check: */
+	assert(context != (SHA512_CTX*)0 && (context->bitcount[0] >> 3) % SHA512_BLOCK_LENGTH == 0);
+
+	SHA512_BLOCKS(context, data, n_blocks);
+	ADDINC128(context->bitcount, (sha2_word64)n_blocks * SHA512_BLOCK_LENGTH << 3);
+}
+
 void SHA512_Update(SHA512_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -861,7 +940,7 @@ void SHA512_Update(SHA512_CTX* context, const sha2_byte *data, size_t len) {
 			ADDINC128(context->bitcount, freespace << 3);
 			len -= freespace;
 			data += freespace;
-			SHA512_Transform(context, (sha2_word64*)context->buffer);
+			SHA512_BLOCKS(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -871,12 +950,12 @@ void SHA512_Update(SHA512_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= SHA512_BLOCK_LENGTH) {
+	if (len >= SHA512_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
-		SHA512_Transform(context, (sha2_word64*)data);
-		ADDINC128(context->bitcount, SHA512_BLOCK_LENGTH << 3);
-		len -= SHA512_BLOCK_LENGTH;
-		data += SHA512_BLOCK_LENGTH;
+		size_t	blocks = len / SHA512_BLOCK_LENGTH;
+		SHA512_Transform_blocks(context, data, blocks);
+		len -= blocks * SHA512_BLOCK_LENGTH;
+		data += blocks * SHA512_BLOCK_LENGTH;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -908,7 +987,7 @@ void SHA512_Last(SHA512_CTX* context) {
 				MEMSET_BZERO(&context->buffer[usedspace], SHA512_BLOCK_LENGTH - usedspace);
 			}
 			/* Do second-to-last transform: */
-			SHA512_Transform(context, (sha2_word64*)context->buffer);
+			SHA512_BLOCKS(context, context->buffer, 1);
 
 			/* And set-up for the last transform: */
 			MEMSET_BZERO(context->buffer, SHA512_BLOCK_LENGTH - 2);
@@ -925,7 +1004,7 @@ void SHA512_Last(SHA512_CTX* context) {
 	*(sha2_word64*)&context->buffer[SHA512_SHORT_BLOCK_LENGTH+8] = context->bitcount[0];
 
 	/* Final transform: */
-	SHA512_Transform(context, (sha2_word64*)context->buffer);
+	SHA512_BLOCKS(context, context->buffer, 1);
 }
 
 void SHA512_Final(sha2_byte digest[], SHA512_CTX* context) {
@@ -988,6 +1067,50 @@ char* SHA512_Data(const sha2_byte* data, size_t len, char digest[SHA512_DIGEST_S
 	return SHA512_End(&context, digest);
 }
 
+/*
+ * Hash n independent messages with the SHA-512 multi-buffer kernel,
+ * starting from the given initial hash value and keeping the leading
+ * digest_length bytes of each result. Shared by SHA-384 and SHA-512:
+ */
+static void SHA512_Multibuf(const sha2_word64* initial, size_t digest_length,
+			    const sha2_byte* const* data, const size_t* len, size_t n, sha2_byte* digests) {
+	const hashstream_kernels	*kernels = hashstream_get_kernels();
+	hashstream_multibuf_algorithm	alg;
+
+	MEMSET_BZERO(&alg, sizeof(alg));
+	alg.lanes = kernels->sha512_lane_count;
+	alg.block_length = SHA512_BLOCK_LENGTH;
+	alg.word_bytes = sizeof(sha2_word64);
+	alg.state_words = 8;
+	alg.length_bytes = SHA512_BLOCK_LENGTH - SHA512_SHORT_BLOCK_LENGTH;
+	alg.big_endian = 1;
+	alg.initial_state = initial;
+	alg.digest_length = digest_length;
+	alg.lane_blocks64 = kernels->sha512_lanes;
+	alg.blocks64 = kernels->sha512_blocks;
+	hashstream_multibuf(&alg, data, len, n, digests);
+}
+
+/*
+ * Hash n independent messages, several at a time where a multi-buffer
+ * kernel is available (see multibuf.h) and one after another otherwise:
+ */
+void SHA512_Many(const sha2_byte* const* data, const size_t* len, size_t n, sha2_byte (*digest)[SHA512_DIGEST_LENGTH]) {
+	SHA512_CTX	context;
+	size_t		i;
+
+	if (hashstream_get_kernels()->sha512_lanes == NULL) {
+		for (i = 0; i < n; i++) {
+			SHA512_Init(&context);
+			SHA512_Update(&context, data[i], len[i]);
+			SHA512_Final(digest[i], &context);
+		}
+		return;
+	}
+
+	SHA512_Multibuf(sha512_initial_hash_value, SHA512_DIGEST_LENGTH, data, len, n, (sha2_byte*)digest);
+}
+
 
 /*** SHA-384: *********************************************************/
 void SHA384_Init(SHA384_CTX* context) {
@@ -999,6 +1122,10 @@ void SHA384_Init(SHA384_CTX* context) {
 	context->bitcount[0] = context->bitcount[1] = 0;
 }
 
+void SHA384_Transform_blocks(SHA384_CTX* context, const sha2_byte* data, size_t n_blocks) {
+	SHA512_Transform_blocks((SHA512_CTX*)context, data, n_blocks);
+}
+
 void SHA384_Update(SHA384_CTX* context, const sha2_byte* data, size_t len) {
 	SHA512_Update((SHA512_CTX*)context, data, len);
 }
@@ -1063,3 +1190,19 @@ char* SHA384_Data(const sha2_byte* data, size_t len, char digest[SHA384_DIGEST_S
 	return SHA384_End(&context, digest);
 }
 
+void SHA384_Many(const sha2_byte* const* data, const size_t* len, size_t n, sha2_byte (*digest)[SHA384_DIGEST_LENGTH]) {
+	SHA384_CTX	context;
+	size_t		i;
+
+	if (hashstream_get_kernels()->sha512_lanes == NULL) {
+		for (i = 0; i < n; i++) {
+			SHA384_Init(&context);
+			SHA384_Update(&context, data[i], len[i]);
+			SHA384_Final(digest[i], &context);
+		}
+		return;
+	}
+
+	SHA512_Multibuf(sha384_initial_hash_value, SHA384_DIGEST_LENGTH, data, len, n, (sha2_byte*)digest);
+}
+
@@ -129,41 +129,53 @@ typedef SHA512_CTX SHA384_CTX;
 
 void SHA256_Init(SHA256_CTX *);
 void SHA256_Update(SHA256_CTX*, const uint8_t*, size_t);
+void SHA256_Transform_blocks(SHA256_CTX*, const uint8_t*, size_t);
 void SHA256_Final(uint8_t[SHA256_DIGEST_LENGTH], SHA256_CTX*);
 char* SHA256_End(SHA256_CTX*, char[SHA256_DIGEST_STRING_LENGTH]);
 char* SHA256_Data(const uint8_t*, size_t, char[SHA256_DIGEST_STRING_LENGTH]);
+void SHA256_Many(const uint8_t* const*, const size_t*, size_t, uint8_t (*)[SHA256_DIGEST_LENGTH]);
 
 void SHA384_Init(SHA384_CTX*);
 void SHA384_Update(SHA384_CTX*, const uint8_t*, size_t);
+void SHA384_Transform_blocks(SHA384_CTX*, const uint8_t*, size_t);
 void SHA384_Final(uint8_t[SHA384_DIGEST_LENGTH], SHA384_CTX*);
 char* SHA384_End(SHA384_CTX*, char[SHA384_DIGEST_STRING_LENGTH]);
 char* SHA384_Data(const uint8_t*, size_t, char[SHA384_DIGEST_STRING_LENGTH]);
+void SHA384_Many(const uint8_t* const*, const size_t*, size_t, uint8_t (*)[SHA384_DIGEST_LENGTH]);
 
 void SHA512_Init(SHA512_CTX*);
 void SHA512_Update(SHA512_CTX*, const uint8_t*, size_t);
+void SHA512_Transform_blocks(SHA512_CTX*, const uint8_t*, size_t);
 void SHA512_Final(uint8_t[SHA512_DIGEST_LENGTH], SHA512_CTX*);
 char* SHA512_End(SHA512_CTX*, char[SHA512_DIGEST_STRING_LENGTH]);
 char* SHA512_Data(const uint8_t*, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
+void SHA512_Many(const uint8_t* const*, const size_t*, size_t, uint8_t (*)[SHA512_DIGEST_LENGTH]);
 
 #else /* SHA2_USE_INTTYPES_H */
 
 void SHA256_Init(SHA256_CTX *);
 void SHA256_Update(SHA256_CTX*, const u_int8_t*, size_t);
+void SHA256_Transform_blocks(SHA256_CTX*, const u_int8_t*, size_t);
 void SHA256_Final(u_int8_t[SHA256_DIGEST_LENGTH], SHA256_CTX*);
 char* SHA256_End(SHA256_CTX*, char[SHA256_DIGEST_STRING_LENGTH]);
 char* SHA256_Data(const u_int8_t*, size_t, char[SHA256_DIGEST_STRING_LENGTH]);
+void SHA256_Many(const u_int8_t* const*, const size_t*, size_t, u_int8_t (*)[SHA256_DIGEST_LENGTH]);
 
 void SHA384_Init(SHA384_CTX*);
 void SHA384_Update(SHA384_CTX*, const u_int8_t*, size_t);
+void SHA384_Transform_blocks(SHA384_CTX*, const u_int8_t*, size_t);
 void SHA384_Final(u_int8_t[SHA384_DIGEST_LENGTH], SHA384_CTX*);
 char* SHA384_End(SHA384_CTX*, char[SHA384_DIGEST_STRING_LENGTH]);
 char* SHA384_Data(const u_int8_t*, size_t, char[SHA384_DIGEST_STRING_LENGTH]);
+void SHA384_Many(const u_int8_t* const*, const size_t*, size_t, u_int8_t (*)[SHA384_DIGEST_LENGTH]);
 
 void SHA512_Init(SHA512_CTX*);
 void SHA512_Update(SHA512_CTX*, const u_int8_t*, size_t);
+void SHA512_Transform_blocks(SHA512_CTX*, const u_int8_t*, size_t);
 void SHA512_Final(u_int8_t[SHA512_DIGEST_LENGTH], SHA512_CTX*);
 char* SHA512_End(SHA512_CTX*, char[SHA512_DIGEST_STRING_LENGTH]);
 char* SHA512_Data(const u_int8_t*, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
+void SHA512_Many(const u_int8_t* const*, const size_t*, size_t, u_int8_t (*)[SHA512_DIGEST_LENGTH]);
 
 #endif /* SHA2_USE_INTTYPES_H */
 
@@ -171,21 +183,27 @@ char* SHA512_Data(const u_int8_t*, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
 
 void SHA256_Init();
 void SHA256_Update();
+void SHA256_Transform_blocks();
 void SHA256_Final();
 char* SHA256_End();
 char* SHA256_Data();
+void SHA256_Many();
 
 void SHA384_Init();
 void SHA384_Update();
+void SHA384_Transform_blocks();
 void SHA384_Final();
 char* SHA384_End();
 char* SHA384_Data();
+void SHA384_Many();
 
 void SHA512_Init();
 void SHA512_Update();
+void SHA512_Transform_blocks();
 void SHA512_Final();
 char* SHA512_End();
 char* SHA512_Data();
+void SHA512_Many();
 
 #endif /* NOPROTO */
 
@@ -0,0 +1,156 @@
+/*
+ * SHA-256 block function using AVX2 for the message schedule.
+ *
+ * This file is compiled with -mavx2 -mbmi2 and must only be called
+ * through the kernel table, which selects it when the CPU reports both
+ * extensions but not SHA-NI, see dispatch.c.
+ *
+ * Blocks are taken in pairs, as for sha512_avx2.c. The message schedules
+ * of both blocks are expanded together, four words of each per 256-bit
+ * register with the first block in the low 128 bits and the second in
+ * the high 128 bits, and stored with the round constants already added.
+ * Each group of four new words depends on the first two of its own
+ * group through sigma1, so it is completed in two halves. The rounds
+ * run in scalar code, where the rotations compile to rorx, first over
+ * one block and then the other. An odd final block is expanded
+ * alongside a copy of itself.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint32_t K256[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
+	0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
+	0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
+	0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
+	0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
+	0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
+	0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
+	0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
+	0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+/* Vector operations on eight 32-bit words */
+#define VROTR(x, n)	_mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define VSHR(x, n)	_mm256_srli_epi32((x), (n))
+#define VXOR3(x, y, z)	_mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
+#define vsigma0(x)	VXOR3(VROTR((x), 7), VROTR((x), 18), VSHR((x), 3))
+#define vsigma1(x)	VXOR3(VROTR((x), 17), VROTR((x), 19), VSHR((x), 10))
+
+/* Scalar operations for the rounds */
+#define ROTR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define Ch(x, y, z)	((((y) ^ (z)) & (x)) ^ (z))
+#define Maj(x, y, z)	((((x) | (y)) & (z)) | ((x) & (y)))
+#define Sigma0(x)	(ROTR((x), 2) ^ ROTR((x), 13) ^ ROTR((x), 22))
+#define Sigma1(x)	(ROTR((x), 6) ^ ROTR((x), 11) ^ ROTR((x), 25))
+
+/* Round j of the block whose words plus constants are at wk[8 * (j / 4) + (j & 3)] */
+#define ROUND(a, b, c, d, e, f, g, h, j) do { \
+	T1 = (h) + Sigma1(e) + Ch((e), (f), (g)) + wk[8 * ((j) / 4) + ((j) & 3)]; \
+	(d) += T1; \
+	(h) = T1 + Sigma0(a) + Maj((a), (b), (c)); \
+} while (0)
+
+/*
+ * Expand the schedules of blocks b0 and b1 and add the round constants.
+ * Afterwards wk[8 * k + i] is word 4k + i of b0 plus constant and
+ * wk[8 * k + 4 + i] the same for b1.
+ */
+static void expand(uint32_t* wk, const uint8_t* b0, const uint8_t* b1)
+{
+	const __m256i bswap = _mm256_set_epi8(
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	const __m256i lo = _mm256_set_epi32(0, 0, -1, -1, 0, 0, -1, -1);
+	const __m256i hi = _mm256_set_epi32(-1, -1, 0, 0, -1, -1, 0, 0);
+	__m256i X[16], k, t;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		X[i] = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(b0 + 16 * i))),
+			_mm_loadu_si128((const __m128i*)(b1 + 16 * i)), 1);
+		X[i] = _mm256_shuffle_epi8(X[i], bswap);
+	}
+
+	/* W[t] = sigma1(W[t-2]) + W[t-7] + sigma0(W[t-15]) + W[t-16], four words at a time */
+	for (i = 4; i < 16; i++) {
+		t = _mm256_add_epi32(
+			_mm256_add_epi32(X[i - 4], vsigma0(_mm256_alignr_epi8(X[i - 3], X[i - 4], 4))),
+			_mm256_alignr_epi8(X[i - 1], X[i - 2], 4));
+
+		/* The first two words take W[t-2] from the previous group... */
+		t = _mm256_add_epi32(t, _mm256_and_si256(
+			vsigma1(_mm256_shuffle_epi32(X[i - 1], _MM_SHUFFLE(3, 2, 3, 2))), lo));
+		/* ...and the last two from the first two of this one */
+		t = _mm256_add_epi32(t, _mm256_and_si256(
+			vsigma1(_mm256_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 1, 0))), hi));
+
+		X[i] = t;
+	}
+
+	for (i = 0; i < 16; i++) {
+		k = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&K256[4 * i]));
+		_mm256_storeu_si256((__m256i*)(wk + 8 * i), _mm256_add_epi32(X[i], k));
+	}
+}
+
+static void rounds(uint32_t state[8], const uint32_t* wk)
+{
+	uint32_t a, b, c, d, e, f, g, h, T1;
+	int j;
+
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
+
+	for (j = 0; j < 64; j += 8) {
+		ROUND(a, b, c, d, e, f, g, h, j + 0);
+		ROUND(h, a, b, c, d, e, f, g, j + 1);
+		ROUND(g, h, a, b, c, d, e, f, j + 2);
+		ROUND(f, g, h, a, b, c, d, e, j + 3);
+		ROUND(e, f, g, h, a, b, c, d, j + 4);
+		ROUND(d, e, f, g, h, a, b, c, j + 5);
+		ROUND(c, d, e, f, g, h, a, b, j + 6);
+		ROUND(b, c, d, e, f, g, h, a, j + 7);
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+void sha256_blocks_avx2(uint32_t state[8], const uint8_t* data, size_t n_blocks)
+{
+	uint32_t wk[8 * 16];
+
+	for (; n_blocks >= 2; n_blocks -= 2, data += 128) {
+		expand(wk, data, data + 64);
+		rounds(state, wk);
+		rounds(state, wk + 4);
+	}
+
+	if (n_blocks > 0) {
+		expand(wk, data, data);
+		rounds(state, wk);
+	}
+}
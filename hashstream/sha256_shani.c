@@ -0,0 +1,133 @@
+/*
+ * SHA-256 block function using the Intel SHA extensions.
+ *
+ * This file is compiled with -msse4.1 -msha and must only be called
+ * through the kernel table, which selects it when the CPU reports both
+ * the SHA and SSE4.1 extensions, see dispatch.c.
+ *
+ * The eight chaining variables are held in two registers in the
+ * ABEF/CDGH layout expected by sha256rnds2. Each sha256rnds2 performs
+ * two rounds and the message schedule is computed four words at a time
+ * with sha256msg1/sha256msg2, overlapping with the rounds which consume
+ * earlier words.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint32_t K256[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
+	0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
+	0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
+	0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
+	0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
+	0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
+	0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
+	0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
+	0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+/* Load four big-endian message words */
+#define LOAD_MSG(w, i) \
+	(w) = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * (i))), bswap)
+
+/* Rounds 4i to 4i+3 using message words w */
+#define ROUNDS(w, i) do { \
+	msg = _mm_add_epi32((w), _mm_loadu_si128((const __m128i*)&K256[4 * (i)])); \
+	state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+	msg = _mm_shuffle_epi32(msg, 0x0e); \
+	state0 = _mm_sha256rnds2_epu32(state0, state1, msg); \
+} while (0)
+
+/* Begin the schedule for the words three groups on from cur, in prev */
+#define MSG_BEGIN(prev, cur) \
+	(prev) = _mm_sha256msg1_epu32((prev), (cur))
+
+/* Finish the schedule for the words following cur, in next */
+#define MSG_END(next, cur, prev) \
+	(next) = _mm_sha256msg2_epu32(_mm_add_epi32((next), _mm_alignr_epi8((cur), (prev), 4)), (cur))
+
+void sha256_blocks_shani(uint32_t state[8], const uint8_t* data, size_t n_blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, abef, cdgh, msg, tmp;
+	__m128i w0, w1, w2, w3;
+
+	/* Rearrange ABCD EFGH into ABEF CDGH */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+	for (; n_blocks > 0; n_blocks--, data += 64) {
+		abef = state0;
+		cdgh = state1;
+
+		LOAD_MSG(w0, 0);
+		ROUNDS(w0, 0);
+		LOAD_MSG(w1, 1);
+		ROUNDS(w1, 1);
+		MSG_BEGIN(w0, w1);
+		LOAD_MSG(w2, 2);
+		ROUNDS(w2, 2);
+		MSG_BEGIN(w1, w2);
+		LOAD_MSG(w3, 3);
+		ROUNDS(w3, 3);
+		MSG_END(w0, w3, w2);
+		MSG_BEGIN(w2, w3);
+
+		ROUNDS(w0, 4);
+		MSG_END(w1, w0, w3);
+		MSG_BEGIN(w3, w0);
+		ROUNDS(w1, 5);
+		MSG_END(w2, w1, w0);
+		MSG_BEGIN(w0, w1);
+		ROUNDS(w2, 6);
+		MSG_END(w3, w2, w1);
+		MSG_BEGIN(w1, w2);
+		ROUNDS(w3, 7);
+		MSG_END(w0, w3, w2);
+		MSG_BEGIN(w2, w3);
+
+		ROUNDS(w0, 8);
+		MSG_END(w1, w0, w3);
+		MSG_BEGIN(w3, w0);
+		ROUNDS(w1, 9);
+		MSG_END(w2, w1, w0);
+		MSG_BEGIN(w0, w1);
+		ROUNDS(w2, 10);
+		MSG_END(w3, w2, w1);
+		MSG_BEGIN(w1, w2);
+		ROUNDS(w3, 11);
+		MSG_END(w0, w3, w2);
+		MSG_BEGIN(w2, w3);
+
+		ROUNDS(w0, 12);
+		MSG_END(w1, w0, w3);
+		MSG_BEGIN(w3, w0);
+		ROUNDS(w1, 13);
+		MSG_END(w2, w1, w0);
+		ROUNDS(w2, 14);
+		MSG_END(w3, w2, w1);
+		ROUNDS(w3, 15);
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+	}
+
+	/* Rearrange ABEF CDGH back into ABCD EFGH */
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+	_mm_storeu_si128((__m128i*)&state[0], state0);
+	_mm_storeu_si128((__m128i*)&state[4], state1);
+}
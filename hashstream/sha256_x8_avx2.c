@@ -0,0 +1,148 @@
+/*
+ * Eight-lane SHA-256 using AVX2, see multibuf.h.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * Each 256-bit register holds the same variable for eight independent
+ * messages, so the rounds are exactly those of SHA256_Transform() in
+ * sha2.c performed on eight 32-bit lanes at once. AVX2 has no vector
+ * rotate, so rotations are a pair of shifts.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint32_t K256[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
+	0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
+	0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
+	0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
+	0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
+	0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
+	0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
+	0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
+	0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+#define ADD(x, y)	_mm256_add_epi32((x), (y))
+#define XOR(x, y)	_mm256_xor_si256((x), (y))
+#define ROTR(x, n)	_mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define SHR(x, n)	_mm256_srli_epi32((x), (n))
+
+#define Ch(x, y, z)	XOR(_mm256_and_si256((x), (y)), _mm256_andnot_si256((x), (z)))
+#define Maj(x, y, z)	_mm256_or_si256(_mm256_and_si256((x), (y)), _mm256_and_si256((z), _mm256_or_si256((x), (y))))
+
+#define Sigma0(x)	XOR(XOR(ROTR((x), 2), ROTR((x), 13)), ROTR((x), 22))
+#define Sigma1(x)	XOR(XOR(ROTR((x), 6), ROTR((x), 11)), ROTR((x), 25))
+#define sigma0(x)	XOR(XOR(ROTR((x), 7), ROTR((x), 18)), SHR((x), 3))
+#define sigma1(x)	XOR(XOR(ROTR((x), 17), ROTR((x), 19)), SHR((x), 10))
+
+/* Round j, where W[j & 15] already holds the message schedule word */
+#define ROUND(a, b, c, d, e, f, g, h, j) do { \
+	T1 = ADD(ADD(ADD((h), Sigma1(e)), ADD(Ch((e), (f), (g)), _mm256_set1_epi32((int)K256[j]))), W[(j) & 15]); \
+	(d) = ADD((d), T1); \
+	(h) = ADD(ADD(T1, Sigma0(a)), Maj((a), (b), (c))); \
+} while (0)
+
+/* Extend the message schedule to word j */
+#define SCHEDULE(j) \
+	W[(j) & 15] = ADD(ADD(W[(j) & 15], sigma0(W[((j) + 1) & 15])), ADD(W[((j) + 9) & 15], sigma1(W[((j) + 14) & 15])))
+
+/* Load eight words at offset from each lane's block and transpose them into W[0..7] */
+static void load_words(__m256i* W, const uint8_t* const* blocks, size_t offset)
+{
+	const __m256i bswap = _mm256_set_epi8(
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	__m256i r0, r1, r2, r3, r4, r5, r6, r7;
+	__m256i t0, t1, t2, t3, t4, t5, t6, t7;
+
+	r0 = _mm256_loadu_si256((const __m256i*)(blocks[0] + offset));
+	r1 = _mm256_loadu_si256((const __m256i*)(blocks[1] + offset));
+	r2 = _mm256_loadu_si256((const __m256i*)(blocks[2] + offset));
+	r3 = _mm256_loadu_si256((const __m256i*)(blocks[3] + offset));
+	r4 = _mm256_loadu_si256((const __m256i*)(blocks[4] + offset));
+	r5 = _mm256_loadu_si256((const __m256i*)(blocks[5] + offset));
+	r6 = _mm256_loadu_si256((const __m256i*)(blocks[6] + offset));
+	r7 = _mm256_loadu_si256((const __m256i*)(blocks[7] + offset));
+
+	t0 = _mm256_unpacklo_epi32(r0, r1);
+	t1 = _mm256_unpackhi_epi32(r0, r1);
+	t2 = _mm256_unpacklo_epi32(r2, r3);
+	t3 = _mm256_unpackhi_epi32(r2, r3);
+	t4 = _mm256_unpacklo_epi32(r4, r5);
+	t5 = _mm256_unpackhi_epi32(r4, r5);
+	t6 = _mm256_unpacklo_epi32(r6, r7);
+	t7 = _mm256_unpackhi_epi32(r6, r7);
+
+	r0 = _mm256_unpacklo_epi64(t0, t2);
+	r1 = _mm256_unpackhi_epi64(t0, t2);
+	r2 = _mm256_unpacklo_epi64(t1, t3);
+	r3 = _mm256_unpackhi_epi64(t1, t3);
+	r4 = _mm256_unpacklo_epi64(t4, t6);
+	r5 = _mm256_unpackhi_epi64(t4, t6);
+	r6 = _mm256_unpacklo_epi64(t5, t7);
+	r7 = _mm256_unpackhi_epi64(t5, t7);
+
+	W[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x20), bswap);
+	W[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x20), bswap);
+	W[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x20), bswap);
+	W[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x20), bswap);
+	W[4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x31), bswap);
+	W[5] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x31), bswap);
+	W[6] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x31), bswap);
+	W[7] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x31), bswap);
+}
+
+void sha256_x8_avx2(uint32_t* state, const uint8_t* const* blocks)
+{
+	__m256i a, b, c, d, e, f, g, h, T1;
+	__m256i W[16];
+	int j;
+
+	load_words(W, blocks, 0);
+	load_words(W + 8, blocks, 32);
+
+	a = _mm256_loadu_si256((const __m256i*)(state + 0 * 8));
+	b = _mm256_loadu_si256((const __m256i*)(state + 1 * 8));
+	c = _mm256_loadu_si256((const __m256i*)(state + 2 * 8));
+	d = _mm256_loadu_si256((const __m256i*)(state + 3 * 8));
+	e = _mm256_loadu_si256((const __m256i*)(state + 4 * 8));
+	f = _mm256_loadu_si256((const __m256i*)(state + 5 * 8));
+	g = _mm256_loadu_si256((const __m256i*)(state + 6 * 8));
+	h = _mm256_loadu_si256((const __m256i*)(state + 7 * 8));
+
+	for (j = 0; j < 64; j += 8) {
+		if (j >= 16) {
+			SCHEDULE(j + 0); SCHEDULE(j + 1); SCHEDULE(j + 2); SCHEDULE(j + 3);
+			SCHEDULE(j + 4); SCHEDULE(j + 5); SCHEDULE(j + 6); SCHEDULE(j + 7);
+		}
+		ROUND(a, b, c, d, e, f, g, h, j + 0);
+		ROUND(h, a, b, c, d, e, f, g, j + 1);
+		ROUND(g, h, a, b, c, d, e, f, j + 2);
+		ROUND(f, g, h, a, b, c, d, e, j + 3);
+		ROUND(e, f, g, h, a, b, c, d, j + 4);
+		ROUND(d, e, f, g, h, a, b, c, j + 5);
+		ROUND(c, d, e, f, g, h, a, b, j + 6);
+		ROUND(b, c, d, e, f, g, h, a, j + 7);
+	}
+
+	_mm256_storeu_si256((__m256i*)(state + 0 * 8), ADD(a, _mm256_loadu_si256((const __m256i*)(state + 0 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 1 * 8), ADD(b, _mm256_loadu_si256((const __m256i*)(state + 1 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 2 * 8), ADD(c, _mm256_loadu_si256((const __m256i*)(state + 2 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 3 * 8), ADD(d, _mm256_loadu_si256((const __m256i*)(state + 3 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 4 * 8), ADD(e, _mm256_loadu_si256((const __m256i*)(state + 4 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 5 * 8), ADD(f, _mm256_loadu_si256((const __m256i*)(state + 5 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 6 * 8), ADD(g, _mm256_loadu_si256((const __m256i*)(state + 6 * 8))));
+	_mm256_storeu_si256((__m256i*)(state + 7 * 8), ADD(h, _mm256_loadu_si256((const __m256i*)(state + 7 * 8))));
+}
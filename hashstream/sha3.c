@@ -0,0 +1,389 @@
+/*
+ * SHA-3 and SHAKE, see sha3.h.
+ *
+ * The permutation is fully unrolled within each round, with the lanes
+ * held in local variables, and uses the lane complementing transform
+ * from the Keccak team's optimised implementations: six of the 25 lanes
+ * are kept complemented, which leaves a single NOT in each row of chi
+ * rather than five, the rest becoming ORs of the operands as held.
+ * Complementing commutes with absorbing, so only the initial state and
+ * the output need to account for it.
+ *
+ * sha3_many() hashes several messages at once through the keccak_lanes
+ * kernel in dispatch.h where the CPU allows. It keeps the lanes busy as
+ * hashstream_multibuf() does for the Merkle-Damgard functions.
+ */
+
+#include <string.h>
+
+#include "dispatch.h"
+#include "sha3.h"
+
+/* The most messages any keccak_lanes kernel takes at once */
+#define MAX_LANES	4
+
+static const uint64_t keccak_round_constants[24] = {
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+	0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+/* XORed with the plain lanes to give those held, and back again */
+static const uint64_t complemented[25] = {
+	0, ~0ULL, ~0ULL, 0, 0,
+	0, 0, 0, ~0ULL, 0,
+	0, 0, ~0ULL, 0, 0,
+	0, 0, ~0ULL, 0, 0,
+	~0ULL, 0, 0, 0, 0
+};
+
+#define ROL64(x, n)	(((x) << (n)) | ((x) >> (64 - (n))))
+
+/*
+ * One round from the lanes X##ba ... X##su to Y##ba ... Y##su, named by
+ * row (b, g, k, m, s) and column (a, e, i, o, u). Each row of the output
+ * is chi of five lanes gathered by rho and pi.
+ */
+#define KECCAK_ROUND(X, Y, rc) do { \
+	Ca = X##ba ^ X##ga ^ X##ka ^ X##ma ^ X##sa; \
+	Ce = X##be ^ X##ge ^ X##ke ^ X##me ^ X##se; \
+	Ci = X##bi ^ X##gi ^ X##ki ^ X##mi ^ X##si; \
+	Co = X##bo ^ X##go ^ X##ko ^ X##mo ^ X##so; \
+	Cu = X##bu ^ X##gu ^ X##ku ^ X##mu ^ X##su; \
+	Da = Cu ^ ROL64(Ce, 1); \
+	De = Ca ^ ROL64(Ci, 1); \
+	Di = Ce ^ ROL64(Co, 1); \
+	Do = Ci ^ ROL64(Cu, 1); \
+	Du = Co ^ ROL64(Ca, 1); \
+	\
+	B0 = X##ba ^ Da; \
+	B1 = ROL64(X##ge ^ De, 44); \
+	B2 = ROL64(X##ki ^ Di, 43); \
+	B3 = ROL64(X##mo ^ Do, 21); \
+	B4 = ROL64(X##su ^ Du, 14); \
+	Y##ba = B0 ^ (B1 | B2) ^ (rc); \
+	Y##be = B1 ^ (~B2 | B3); \
+	Y##bi = B2 ^ (B3 & B4); \
+	Y##bo = B3 ^ (B4 | B0); \
+	Y##bu = B4 ^ (B0 & B1); \
+	\
+	B0 = ROL64(X##bo ^ Do, 28); \
+	B1 = ROL64(X##gu ^ Du, 20); \
+	B2 = ROL64(X##ka ^ Da, 3); \
+	B3 = ROL64(X##me ^ De, 45); \
+	B4 = ROL64(X##si ^ Di, 61); \
+	Y##ga = B0 ^ (B1 | B2); \
+	Y##ge = B1 ^ (B2 & B3); \
+	Y##gi = B2 ^ (B3 | ~B4); \
+	Y##go = B3 ^ (B4 | B0); \
+	Y##gu = B4 ^ (B0 & B1); \
+	\
+	B0 = ROL64(X##be ^ De, 1); \
+	B1 = ROL64(X##gi ^ Di, 6); \
+	B2 = ROL64(X##ko ^ Do, 25); \
+	B3 = ROL64(X##mu ^ Du, 8); \
+	B4 = ROL64(X##sa ^ Da, 18); \
+	Y##ka = B0 ^ (B1 | B2); \
+	Y##ke = B1 ^ (B2 & B3); \
+	Y##ki = B2 ^ (~B3 & B4); \
+	Y##ko = ~B3 ^ (B4 | B0); \
+	Y##ku = B4 ^ (B0 & B1); \
+	\
+	B0 = ROL64(X##bu ^ Du, 27); \
+	B1 = ROL64(X##ga ^ Da, 36); \
+	B2 = ROL64(X##ke ^ De, 10); \
+	B3 = ROL64(X##mi ^ Di, 15); \
+	B4 = ROL64(X##so ^ Do, 56); \
+	Y##ma = B0 ^ (B1 & B2); \
+	Y##me = B1 ^ (B2 | B3); \
+	Y##mi = B2 ^ (~B3 | B4); \
+	Y##mo = ~B3 ^ (B4 & B0); \
+	Y##mu = B4 ^ (B0 | B1); \
+	\
+	B0 = ROL64(X##bi ^ Di, 62); \
+	B1 = ROL64(X##go ^ Do, 55); \
+	B2 = ROL64(X##ku ^ Du, 39); \
+	B3 = ROL64(X##ma ^ Da, 41); \
+	B4 = ROL64(X##se ^ De, 2); \
+	Y##sa = B0 ^ (~B1 & B2); \
+	Y##se = ~B1 ^ (B2 | B3); \
+	Y##si = B2 ^ (B3 & B4); \
+	Y##so = B3 ^ (B4 | B0); \
+	Y##su = B4 ^ (B0 & B1); \
+} while (0)
+
+void keccak_f1600(uint64_t A[25])
+{
+	uint64_t Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako, Aku;
+	uint64_t Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+	uint64_t Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko, Eku;
+	uint64_t Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+	uint64_t Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du, B0, B1, B2, B3, B4;
+	size_t round;
+
+	Aba = A[0];  Abe = A[1];  Abi = A[2];  Abo = A[3];  Abu = A[4];
+	Aga = A[5];  Age = A[6];  Agi = A[7];  Ago = A[8];  Agu = A[9];
+	Aka = A[10]; Ake = A[11]; Aki = A[12]; Ako = A[13]; Aku = A[14];
+	Ama = A[15]; Ame = A[16]; Ami = A[17]; Amo = A[18]; Amu = A[19];
+	Asa = A[20]; Ase = A[21]; Asi = A[22]; Aso = A[23]; Asu = A[24];
+
+	/* Two rounds at a time so that the lanes swap between A and E without copying */
+	for (round = 0; round < 24; round += 2) {
+		KECCAK_ROUND(A, E, keccak_round_constants[round]);
+		KECCAK_ROUND(E, A, keccak_round_constants[round + 1]);
+	}
+
+	A[0] = Aba;  A[1] = Abe;  A[2] = Abi;  A[3] = Abo;  A[4] = Abu;
+	A[5] = Aga;  A[6] = Age;  A[7] = Agi;  A[8] = Ago;  A[9] = Agu;
+	A[10] = Aka; A[11] = Ake; A[12] = Aki; A[13] = Ako; A[14] = Aku;
+	A[15] = Ama; A[16] = Ame; A[17] = Ami; A[18] = Amo; A[19] = Amu;
+	A[20] = Asa; A[21] = Ase; A[22] = Asi; A[23] = Aso; A[24] = Asu;
+}
+
+static uint64_t load64(const uint8_t* p)
+{
+	return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+	       ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static void store64(uint8_t* p, uint64_t v)
+{
+	size_t i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void absorb_block(uint64_t A[25], const uint8_t* block, size_t rate)
+{
+	size_t i;
+
+	for (i = 0; i < rate / 8; i++)
+		A[i] ^= load64(block + 8 * i);
+	keccak_f1600(A);
+}
+
+/* Write the first out_len bytes of the plain lanes, lane i being lanes[i * stride] */
+static void store_output(const uint64_t* lanes, size_t stride, uint8_t* out, size_t out_len)
+{
+	uint8_t lane[8];
+	size_t i;
+
+	for (i = 0; 8 * i < out_len; i++) {
+		store64(lane, lanes[i * stride]);
+		memcpy(out + 8 * i, lane, (out_len - 8 * i < 8) ? out_len - 8 * i : 8);
+	}
+}
+
+/* Write the first rate bytes of the lanes held in A to buf */
+static void extract_block(const uint64_t A[25], uint8_t* buf, size_t rate)
+{
+	size_t i;
+
+	for (i = 0; i < rate / 8; i++)
+		store64(buf + 8 * i, A[i] ^ complemented[i]);
+}
+
+void sha3_init(sha3_state* self, size_t rate, uint8_t domain)
+{
+	memset(self, 0, sizeof(*self));
+	memcpy(self->A, complemented, sizeof(self->A));
+	self->rate = rate;
+	self->domain = domain;
+}
+
+void sha3_update(sha3_state* self, const void* input, size_t input_len)
+{
+	const uint8_t* in = (const uint8_t*)input;
+	size_t take;
+
+	self->n_bytes += input_len;
+
+	if (self->buflen > 0) {
+		take = self->rate - self->buflen;
+		if (take > input_len)
+			take = input_len;
+		memcpy(self->buf + self->buflen, in, take);
+		self->buflen += take;
+		in += take;
+		input_len -= take;
+		if (self->buflen < self->rate)
+			return;
+		absorb_block(self->A, self->buf, self->rate);
+		self->buflen = 0;
+	}
+
+	for (; input_len >= self->rate; in += self->rate, input_len -= self->rate)
+		absorb_block(self->A, in, self->rate);
+
+	memcpy(self->buf, in, input_len);
+	self->buflen = input_len;
+}
+
+void sha3_squeeze(sha3_state* self, uint8_t* out, size_t out_len)
+{
+	size_t take;
+
+	if (!self->squeezing) {
+		memset(self->buf + self->buflen, 0, self->rate - self->buflen);
+		self->buf[self->buflen] ^= self->domain;
+		self->buf[self->rate - 1] ^= 0x80;
+		absorb_block(self->A, self->buf, self->rate);
+		extract_block(self->A, self->buf, self->rate);
+		self->buflen = 0;
+		self->squeezing = 1;
+	}
+
+	while (out_len > 0) {
+		if (self->buflen == self->rate) {
+			keccak_f1600(self->A);
+			extract_block(self->A, self->buf, self->rate);
+			self->buflen = 0;
+		}
+		take = self->rate - self->buflen;
+		if (take > out_len)
+			take = out_len;
+		memcpy(out, self->buf + self->buflen, take);
+		self->buflen += take;
+		out += take;
+		out_len -= take;
+	}
+}
+
+void sha3_get_lanes(const sha3_state* self, uint64_t lanes[25])
+{
+	size_t i;
+
+	for (i = 0; i < 25; i++)
+		lanes[i] = self->A[i] ^ complemented[i];
+}
+
+void sha3_set_lanes(sha3_state* self, const uint64_t lanes[25])
+{
+	size_t i;
+
+	for (i = 0; i < 25; i++)
+		self->A[i] = lanes[i] ^ complemented[i];
+}
+
+typedef struct {
+	int		active;
+	size_t		index;		/* of the message in the batch */
+	const uint8_t*	data;
+	size_t		full_blocks;	/* whole blocks read directly from data */
+	size_t		next;		/* next block to be absorbed, the padded tail being the last */
+	uint8_t		tail[SHA3_MAX_RATE];
+} lane_t;
+
+/* Fed to lanes with no message left to hash, whose results are discarded */
+static const uint8_t idle_block[SHA3_MAX_RATE];
+
+static void start_lane(lane_t* lane, uint64_t* state, unsigned int lanes, unsigned int l, size_t rate,
+		       uint8_t domain, size_t index, const uint8_t* data, size_t len)
+{
+	size_t i, remainder = len % rate;
+
+	lane->active = 1;
+	lane->index = index;
+	lane->data = data;
+	lane->full_blocks = len / rate;
+	lane->next = 0;
+
+	/* The padding always fits in the block holding the end of the message */
+	memset(lane->tail, 0, rate);
+	if (remainder > 0)
+		memcpy(lane->tail, data + len - remainder, remainder);
+	lane->tail[remainder] ^= domain;
+	lane->tail[rate - 1] ^= 0x80;
+
+	for (i = 0; i < 25; i++)
+		state[i * lanes + l] = 0;
+}
+
+static const uint8_t* lane_block(const lane_t* lane, size_t rate)
+{
+	if (lane->next < lane->full_blocks)
+		return lane->data + lane->next * rate;
+	return lane->tail;
+}
+
+/* Finish the message in lane l with the single-stream permutation */
+static void finish_lane(const lane_t* lane, const uint64_t* state, unsigned int lanes, unsigned int l,
+			size_t rate, uint8_t* out, size_t out_len)
+{
+	uint64_t A[25];
+	size_t i;
+
+	for (i = 0; i < 25; i++)
+		A[i] = state[i * lanes + l] ^ complemented[i];
+	for (i = lane->next; i < lane->full_blocks; i++)
+		absorb_block(A, lane->data + i * rate, rate);
+	absorb_block(A, lane->tail, rate);
+
+	for (i = 0; i < 25; i++)
+		A[i] ^= complemented[i];
+	store_output(A, 1, out + lane->index * out_len, out_len);
+}
+
+void sha3_many(size_t rate, uint8_t domain, const uint8_t* const* data, const size_t* len, size_t n,
+	       uint8_t* out, size_t out_len)
+{
+	const hashstream_kernels* kernels = hashstream_get_kernels();
+	unsigned int l, lanes = kernels->keccak_lane_count;
+	lane_t lane[MAX_LANES];
+	uint64_t state[25 * MAX_LANES];
+	const uint8_t* blocks[MAX_LANES];
+	size_t i, next_message = 0, n_active = 0;
+	sha3_state ctx;
+
+	if (kernels->keccak_lanes == NULL) {
+		for (i = 0; i < n; i++) {
+			sha3_init(&ctx, rate, domain);
+			sha3_update(&ctx, data[i], len[i]);
+			sha3_squeeze(&ctx, out + i * out_len, out_len);
+		}
+		return;
+	}
+
+	for (l = 0; l < lanes; l++) {
+		lane[l].active = 0;
+		if (next_message < n) {
+			start_lane(&lane[l], state, lanes, l, rate, domain, next_message, data[next_message],
+				   len[next_message]);
+			next_message++;
+			n_active++;
+		}
+	}
+
+	/* Lanes are refilled as they finish, so only the tail of the batch runs partly idle */
+	while (n_active > 1) {
+		for (l = 0; l < lanes; l++)
+			blocks[l] = lane[l].active ? lane_block(&lane[l], rate) : idle_block;
+
+		kernels->keccak_lanes(state, blocks, rate);
+
+		for (l = 0; l < lanes; l++) {
+			if (!lane[l].active || lane[l].next++ < lane[l].full_blocks)
+				continue;
+
+			store_output(state + l, lanes, out + lane[l].index * out_len, out_len);
+
+			if (next_message < n) {
+				start_lane(&lane[l], state, lanes, l, rate, domain, next_message, data[next_message],
+					   len[next_message]);
+				next_message++;
+			} else {
+				lane[l].active = 0;
+				n_active--;
+			}
+		}
+	}
+
+	for (l = 0; l < lanes; l++) {
+		if (lane[l].active)
+			finish_lane(&lane[l], state, lanes, l, rate, out, out_len);
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * SHA-3 and SHAKE, the sponge constructions on Keccak-f[1600].
+ *
+ * Every member of the family is the same sponge with a different rate,
+ * the number of bytes of each block absorbed into or squeezed out of the
+ * 200-byte state, and domain separation byte, which begins the padding.
+ * The SHAKE extendable output functions may be squeezed for any amount
+ * of output.
+ */
+
+#ifndef __SHA3_H
+#define __SHA3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Rates, in bytes */
+#define SHA3_224_RATE		144
+#define SHA3_256_RATE		136
+#define SHA3_384_RATE		104
+#define SHA3_512_RATE		72
+#define SHAKE128_RATE		168
+#define SHAKE256_RATE		136
+#define SHA3_MAX_RATE		SHAKE128_RATE
+
+/* Domain separation bytes */
+#define SHA3_DOMAIN		0x06
+#define SHAKE_DOMAIN		0x1f
+
+typedef struct {
+	uint64_t	A[25];		/* the lanes, some held complemented, see sha3.c */
+	uint8_t		buf[SHA3_MAX_RATE];
+	size_t		rate;
+	size_t		buflen;		/* absorbing: bytes held in buf; squeezing: bytes of buf output */
+	uint64_t	n_bytes;	/* absorbed */
+	uint8_t		domain;
+	int		squeezing;
+} sha3_state;
+
+void sha3_init(sha3_state* self, size_t rate, uint8_t domain);
+void sha3_update(sha3_state* self, const void* input, size_t input_len);
+
+/*
+ * Write the next out_len bytes of output. The first call pads the
+ * message, after which no more may be absorbed.
+ */
+void sha3_squeeze(sha3_state* self, uint8_t* out, size_t out_len);
+
+/* Copy the lanes of an absorbing state to and from their plain form */
+void sha3_get_lanes(const sha3_state* self, uint64_t lanes[25]);
+void sha3_set_lanes(sha3_state* self, const uint64_t lanes[25]);
+
+/*
+ * Hash the n messages data[i] of len[i] bytes, writing out_len bytes of
+ * output for each to out + i * out_len. out_len may not exceed rate.
+ */
+void sha3_many(size_t rate, uint8_t domain, const uint8_t* const* data, const size_t* len, size_t n,
+	       uint8_t* out, size_t out_len);
+
+/* The Keccak-f[1600] permutation of lanes complemented as in sha3_state */
+void keccak_f1600(uint64_t A[25]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHA3_H */
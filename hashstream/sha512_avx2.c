@@ -0,0 +1,147 @@
+/*
+ * SHA-512 block function using AVX2 for the message schedule.
+ *
+ * This file is compiled with -mavx2 -mbmi2 and must only be called
+ * through the kernel table, which selects it when the CPU reports both
+ * extensions, see dispatch.c.
+ *
+ * Blocks are taken in pairs. The message schedules of both blocks are
+ * expanded together, two words of each per 256-bit register with the
+ * first block in the low 128 bits and the second in the high 128 bits,
+ * and stored with the round constants already added. The rounds
+ * themselves are inherently serial and run in scalar code, where the
+ * rotations compile to rorx, first over one block and then the other.
+ * An odd final block is expanded alongside a copy of itself.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint64_t K512[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+/* Vector operations on four 64-bit words */
+#define VROTR(x, n)	_mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+#define VSHR(x, n)	_mm256_srli_epi64((x), (n))
+#define VXOR3(x, y, z)	_mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
+#define vsigma0(x)	VXOR3(VROTR((x), 1), VROTR((x), 8), VSHR((x), 7))
+#define vsigma1(x)	VXOR3(VROTR((x), 19), VROTR((x), 61), VSHR((x), 6))
+
+/* Scalar operations for the rounds */
+#define ROTR(x, n)	(((x) >> (n)) | ((x) << (64 - (n))))
+#define Ch(x, y, z)	((((y) ^ (z)) & (x)) ^ (z))
+#define Maj(x, y, z)	((((x) | (y)) & (z)) | ((x) & (y)))
+#define Sigma0(x)	(ROTR((x), 28) ^ ROTR((x), 34) ^ ROTR((x), 39))
+#define Sigma1(x)	(ROTR((x), 14) ^ ROTR((x), 18) ^ ROTR((x), 41))
+
+/* Round j of the block whose words plus constants are at wk[4 * (j / 2) + (j & 1)] */
+#define ROUND(a, b, c, d, e, f, g, h, j) do { \
+	T1 = (h) + Sigma1(e) + Ch((e), (f), (g)) + wk[4 * ((j) / 2) + ((j) & 1)]; \
+	(d) += T1; \
+	(h) = T1 + Sigma0(a) + Maj((a), (b), (c)); \
+} while (0)
+
+/*
+ * Expand the schedules of blocks b0 and b1 and add the round constants.
+ * Afterwards wk[4 * k + i] is word 2k + i of b0 plus constant and
+ * wk[4 * k + 2 + i] the same for b1.
+ */
+static void expand(uint64_t* wk, const uint8_t* b0, const uint8_t* b1)
+{
+	const __m256i bswap = _mm256_set_epi8(
+		8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+		8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i X[40], k;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		X[i] = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(b0 + 16 * i))),
+			_mm_loadu_si128((const __m128i*)(b1 + 16 * i)), 1);
+		X[i] = _mm256_shuffle_epi8(X[i], bswap);
+	}
+
+	/* W[t] = sigma1(W[t-2]) + W[t-7] + sigma0(W[t-15]) + W[t-16], two words at a time */
+	for (i = 8; i < 40; i++) {
+		X[i] = _mm256_add_epi64(
+			_mm256_add_epi64(X[i - 8], vsigma0(_mm256_alignr_epi8(X[i - 7], X[i - 8], 8))),
+			_mm256_add_epi64(_mm256_alignr_epi8(X[i - 3], X[i - 4], 8), vsigma1(X[i - 1])));
+	}
+
+	for (i = 0; i < 40; i++) {
+		k = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&K512[2 * i]));
+		_mm256_storeu_si256((__m256i*)(wk + 4 * i), _mm256_add_epi64(X[i], k));
+	}
+}
+
+static void rounds(uint64_t state[8], const uint64_t* wk)
+{
+	uint64_t a, b, c, d, e, f, g, h, T1;
+	int j;
+
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
+
+	for (j = 0; j < 80; j += 8) {
+		ROUND(a, b, c, d, e, f, g, h, j + 0);
+		ROUND(h, a, b, c, d, e, f, g, j + 1);
+		ROUND(g, h, a, b, c, d, e, f, j + 2);
+		ROUND(f, g, h, a, b, c, d, e, j + 3);
+		ROUND(e, f, g, h, a, b, c, d, j + 4);
+		ROUND(d, e, f, g, h, a, b, c, j + 5);
+		ROUND(c, d, e, f, g, h, a, b, j + 6);
+		ROUND(b, c, d, e, f, g, h, a, j + 7);
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+void sha512_blocks_avx2(uint64_t state[8], const uint8_t* data, size_t n_blocks)
+{
+	uint64_t wk[4 * 40];
+
+	for (; n_blocks >= 2; n_blocks -= 2, data += 256) {
+		expand(wk, data, data + 128);
+		rounds(state, wk);
+		rounds(state, wk + 2);
+	}
+
+	if (n_blocks > 0) {
+		expand(wk, data, data);
+		rounds(state, wk);
+	}
+}
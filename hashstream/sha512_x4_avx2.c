@@ -0,0 +1,133 @@
+/*
+ * Four-lane SHA-512 using AVX2, see multibuf.h.
+ *
+ * This file is compiled with -mavx2 and must only be called through the
+ * kernel table, which selects it when the CPU reports AVX2, see
+ * dispatch.c.
+ *
+ * Each 256-bit register holds the same 64-bit variable for four
+ * independent messages, so the rounds are exactly those of
+ * SHA512_Transform() in sha2.c performed on four lanes at once. SHA-384
+ * differs only in its initial state and digest length, so shares this
+ * kernel. AVX2 has no vector rotate, so rotations are a pair of shifts.
+ */
+
+#include <immintrin.h>
+
+#include "dispatch.h"
+
+static const uint64_t K512[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+#define ADD(x, y)	_mm256_add_epi64((x), (y))
+#define XOR(x, y)	_mm256_xor_si256((x), (y))
+#define ROTR(x, n)	_mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+#define SHR(x, n)	_mm256_srli_epi64((x), (n))
+
+#define Ch(x, y, z)	XOR(_mm256_and_si256((x), (y)), _mm256_andnot_si256((x), (z)))
+#define Maj(x, y, z)	_mm256_or_si256(_mm256_and_si256((x), (y)), _mm256_and_si256((z), _mm256_or_si256((x), (y))))
+
+#define Sigma0(x)	XOR(XOR(ROTR((x), 28), ROTR((x), 34)), ROTR((x), 39))
+#define Sigma1(x)	XOR(XOR(ROTR((x), 14), ROTR((x), 18)), ROTR((x), 41))
+#define sigma0(x)	XOR(XOR(ROTR((x), 1), ROTR((x), 8)), SHR((x), 7))
+#define sigma1(x)	XOR(XOR(ROTR((x), 19), ROTR((x), 61)), SHR((x), 6))
+
+/* Round j, where W[j & 15] already holds the message schedule word */
+#define ROUND(a, b, c, d, e, f, g, h, j) do { \
+	T1 = ADD(ADD(ADD((h), Sigma1(e)), ADD(Ch((e), (f), (g)), _mm256_set1_epi64x((long long)K512[j]))), W[(j) & 15]); \
+	(d) = ADD((d), T1); \
+	(h) = ADD(ADD(T1, Sigma0(a)), Maj((a), (b), (c))); \
+} while (0)
+
+/* Extend the message schedule to word j */
+#define SCHEDULE(j) \
+	W[(j) & 15] = ADD(ADD(W[(j) & 15], sigma0(W[((j) + 1) & 15])), ADD(W[((j) + 9) & 15], sigma1(W[((j) + 14) & 15])))
+
+/* Load four words at offset from each lane's block and transpose them into W[0..3] */
+static void load_words(__m256i* W, const uint8_t* const* blocks, size_t offset)
+{
+	const __m256i bswap = _mm256_set_epi8(
+		8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+		8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i r0, r1, r2, r3, t0, t1, t2, t3;
+
+	r0 = _mm256_loadu_si256((const __m256i*)(blocks[0] + offset));
+	r1 = _mm256_loadu_si256((const __m256i*)(blocks[1] + offset));
+	r2 = _mm256_loadu_si256((const __m256i*)(blocks[2] + offset));
+	r3 = _mm256_loadu_si256((const __m256i*)(blocks[3] + offset));
+
+	t0 = _mm256_unpacklo_epi64(r0, r1);
+	t1 = _mm256_unpackhi_epi64(r0, r1);
+	t2 = _mm256_unpacklo_epi64(r2, r3);
+	t3 = _mm256_unpackhi_epi64(r2, r3);
+
+	W[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t0, t2, 0x20), bswap);
+	W[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t1, t3, 0x20), bswap);
+	W[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t0, t2, 0x31), bswap);
+	W[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t1, t3, 0x31), bswap);
+}
+
+void sha512_x4_avx2(uint64_t* state, const uint8_t* const* blocks)
+{
+	__m256i a, b, c, d, e, f, g, h, T1;
+	__m256i W[16];
+	int j;
+
+	load_words(W, blocks, 0);
+	load_words(W + 4, blocks, 32);
+	load_words(W + 8, blocks, 64);
+	load_words(W + 12, blocks, 96);
+
+	a = _mm256_loadu_si256((const __m256i*)(state + 0 * 4));
+	b = _mm256_loadu_si256((const __m256i*)(state + 1 * 4));
+	c = _mm256_loadu_si256((const __m256i*)(state + 2 * 4));
+	d = _mm256_loadu_si256((const __m256i*)(state + 3 * 4));
+	e = _mm256_loadu_si256((const __m256i*)(state + 4 * 4));
+	f = _mm256_loadu_si256((const __m256i*)(state + 5 * 4));
+	g = _mm256_loadu_si256((const __m256i*)(state + 6 * 4));
+	h = _mm256_loadu_si256((const __m256i*)(state + 7 * 4));
+
+	for (j = 0; j < 80; j += 8) {
+		if (j >= 16) {
+			SCHEDULE(j + 0); SCHEDULE(j + 1); SCHEDULE(j + 2); SCHEDULE(j + 3);
+			SCHEDULE(j + 4); SCHEDULE(j + 5); SCHEDULE(j + 6); SCHEDULE(j + 7);
+		}
+		ROUND(a, b, c, d, e, f, g, h, j + 0);
+		ROUND(h, a, b, c, d, e, f, g, j + 1);
+		ROUND(g, h, a, b, c, d, e, f, j + 2);
+		ROUND(f, g, h, a, b, c, d, e, j + 3);
+		ROUND(e, f, g, h, a, b, c, d, j + 4);
+		ROUND(d, e, f, g, h, a, b, c, j + 5);
+		ROUND(c, d, e, f, g, h, a, b, j + 6);
+		ROUND(b, c, d, e, f, g, h, a, j + 7);
+	}
+
+	_mm256_storeu_si256((__m256i*)(state + 0 * 4), ADD(a, _mm256_loadu_si256((const __m256i*)(state + 0 * 4))));
+	_mm256_storeu_si256((__m256i*)(state + 1 * 4), ADD(b, _mm256_loadu_si256((const __m256i*)(state + 1 * 4))));
+	_mm256_storeu_si256((__m256i*)(state + 2 * 4), ADD(c, _mm256_loadu_si256((const __m256i*)(state + 2 * 4))));
+	_mm256_storeu_si256((__m256i*)(state + 3 * 4), ADD(d, _mm256_loadu_si256((const __m256i*)(state + 3 * 4))));
+	_mm256_storeu_si256((__m256i*)(state + 4 * 4), ADD(e, _mm256_loadu_si256((const __m256i*)(state + 4 * 4))));
+	_mm256_storeu_si256((__m256i*)(state + 5 * 4), ADD(f, _mm256_loadu_si256((const __m256i*)(state + 5 * 4))));
+	_mm256_storeu_si256((__m256i*)(state + 6 * 4), ADD(g, _mm256_loadu_si256((const __m256i*)(state + 6 * 4))));
+	_mm256_storeu_si256((__m256i*)(state + 7 * 4), ADD(h, _mm256_loadu_si256((const __m256i*)(state + 7 * 4))));
+}
@@ -23,18 +23,19 @@
 //  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 //  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <cstring>
 #include <istream>
 
-#include "hashstream.hpp"
-
-// Aladdin licensed MD5 implementation, see md5.c
-#include "md5.h"
-
-// Steve Reid's public domain implementation, see sha1.c
-#include "sha1.h"
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
-// Aaron D. Gifford's sha2 implementation, BSD licensed, see sha2.c
-#include "sha2.h"
+#include "hashstream.hpp"
+#include "hasher.hpp"
 
 namespace hashstream
 {
@@ -45,159 +46,709 @@ namespace hashstream
         /// @addtogroup hash
         /// @{
 
-        /// @brief Implementation of MD5 hash function.
-        class md5_hashbuf : public hashbuf
+        /// @brief A hashbuf adapting a basic_hasher to the std::streambuf interface.
+        template<typename Algorithm>
+        class basic_hashbuf : public hashbuf
         {
             public:
-                md5_hashbuf()
-                    : hashbuf()
-                {
-                    md5_init(&state_);
-                }
+                basic_hashbuf()
+                    : hashbuf(Algorithm::block_length)
+                { }
 
-                ~md5_hashbuf()
+                ~basic_hashbuf()
                 { }
 
             protected:
-                virtual std::streamsize xsputn(const char* s, std::streamsize n)
+                virtual void xupdate(const uint8_t* bytes, size_t n_bytes)
                 {
-                    md5_append(&state_, reinterpret_cast<const md5_byte_t*>(s), n);
-                    return n;
+                    hasher_.update(bytes, n_bytes);
                 }
 
                 virtual void xfinal()
                 {
-                    uint8_t digest[16];
-                    md5_finish(&state_, digest);
-                    set_digest(digest, 16);
+                    uint8_t digest[Algorithm::digest_length];
+                    hasher_.finalise(digest);
+                    set_digest(digest, Algorithm::digest_length);
+                }
+
+                virtual void xreset()
+                {
+                    hasher_.reset();
+                }
+
+                virtual boost::shared_ptr<hashbuf> xclone() const
+                {
+                    return boost::shared_ptr<hashbuf>(new basic_hashbuf(*this));
+                }
+
+                virtual std::vector<uint8_t> xsave_state() const
+                {
+                    return hasher_.save_state();
                 }
 
-                md5_state_t  state_;
+                virtual void xrestore_state(const std::vector<uint8_t>& state)
+                {
+                    hasher_.restore_state(state);
+                }
+
+                basic_hasher<Algorithm>  hasher_;
         };
 
-        /// @brief Implementation of SHA-1 hash function.
-        class sha1_hashbuf : public hashbuf
+        /// @brief A hashbuf for the SHAKE extendable output functions.
+        ///
+        /// Finalising squeezes the digest from a copy of the sponge, so that xsqueeze() starts again from the
+        /// beginning of the output.
+        template<typename Algorithm>
+        class shake_hashbuf : public basic_hashbuf<Algorithm>
         {
             public:
-                sha1_hashbuf()
-                    : hashbuf()
+                shake_hashbuf()
+                    : squeezer_(this->hasher_.context())
+                { }
+
+                ~shake_hashbuf()
+                { }
+
+            protected:
+                virtual void xfinal()
+                {
+                    squeezer_ = this->hasher_.context();
+                    basic_hashbuf<Algorithm>::xfinal();
+                }
+
+                virtual void xsqueeze(uint8_t* out, size_t n_bytes)
                 {
-                    SHA1_Init(&ctx_);
+                    Algorithm::squeeze(&squeezer_, out, n_bytes);
                 }
 
-                ~sha1_hashbuf()
+                virtual boost::shared_ptr<hashbuf> xclone() const
+                {
+                    return boost::shared_ptr<hashbuf>(new shake_hashbuf(*this));
+                }
+
+                typename Algorithm::context_type    squeezer_;  ///< The sponge as finalised, once it has been.
+        };
+
+        /// @brief A hashbuf for the BLAKE2 hash functions, which take a digest length and optional key.
+        template<typename Algorithm>
+        class blake2_hashbuf : public hashbuf
+        {
+            public:
+                blake2_hashbuf(size_t digest_length, const void* key, size_t key_length)
+                    : hashbuf(Algorithm::block_length)
+                    , hasher_(keyed_context(digest_length, key, key_length))
+                { }
+
+                ~blake2_hashbuf()
                 { }
 
             protected:
-                virtual std::streamsize xsputn(const char* s, std::streamsize n)
+                virtual void xupdate(const uint8_t* bytes, size_t n_bytes)
                 {
-                    SHA1_Update(&ctx_, reinterpret_cast<const uint8_t*>(s), n);
-                    return n;
+                    hasher_.update(bytes, n_bytes);
                 }
 
                 virtual void xfinal()
                 {
-                    uint8_t digest[SHA1_DIGEST_SIZE];
-                    SHA1_Final(&ctx_, digest);
-                    set_digest(digest, SHA1_DIGEST_SIZE);
+                    uint8_t digest[Algorithm::digest_length];
+                    hasher_.finalise(digest);
+                    set_digest(digest, hasher_.context().outlen);
+                }
+
+                virtual void xreset()
+                {
+                    hasher_.reset();
+                }
+
+                virtual boost::shared_ptr<hashbuf> xclone() const
+                {
+                    return boost::shared_ptr<hashbuf>(new blake2_hashbuf(*this));
                 }
 
-                SHA1_CTX  ctx_;
+                virtual std::vector<uint8_t> xsave_state() const
+                {
+                    return hasher_.save_state();
+                }
+
+                virtual void xrestore_state(const std::vector<uint8_t>& state)
+                {
+                    hasher_.restore_state(state);
+                }
+
+                static typename Algorithm::context_type keyed_context(size_t digest_length, const void* key,
+                                                                      size_t key_length)
+                {
+                    typename Algorithm::context_type ctx;
+                    Algorithm::init_key(&ctx, digest_length, key, key_length);
+                    return ctx;
+                }
+
+                basic_hasher<Algorithm>  hasher_;   ///< Constructed with any key, which reset() returns to.
         };
 
-        /// @brief Implementation of SHA-256 hash function.
-        class sha256_hashbuf : public hashbuf
+        /// @brief A fixed set of threads which run batches of tasks on behalf of one caller at a time.
+        ///
+        /// The threads are started on construction and wait between batches, so that a batch costs no
+        /// more than waking them. The calling thread runs tasks from its batch too.
+        class worker_pool : boost::noncopyable
         {
             public:
-                sha256_hashbuf()
-                    : hashbuf()
+                typedef void (*task_fn)(void* arg, size_t i);
+
+                /// @brief Start \p n_workers threads in addition to the calling thread.
+                ///
+                /// @throw boost::thread_resource_error if a thread cannot be started, once any which were have
+                /// been stopped.
+                explicit worker_pool(unsigned int n_workers)
+                    : fn_(NULL), arg_(NULL), n_tasks_(0), next_task_(0), n_finished_(0), stopping_(false)
                 {
-                    SHA256_Init(&ctx_);
+                    try
+                    {
+                        for(unsigned int i=0; i<n_workers; ++i)
+                            threads_.create_thread(boost::bind(&worker_pool::work, this));
+                    }
+                    catch(...)
+                    {
+                        stop();
+                        throw;
+                    }
                 }
 
-                ~sha256_hashbuf()
-                { }
+                ~worker_pool()
+                {
+                    stop();
+                }
+
+                /// @brief The number of threads which run each batch, including the caller.
+                unsigned int size() const
+                {
+                    return static_cast<unsigned int>(threads_.size()) + 1;
+                }
+
+                /// @brief Call fn(arg, i) for each i less than n_tasks and return once all have returned.
+                void run(task_fn fn, void* arg, size_t n_tasks)
+                {
+                    boost::unique_lock<boost::mutex> lock(mutex_);
+                    fn_ = fn;
+                    arg_ = arg;
+                    n_tasks_ = n_tasks;
+                    next_task_ = 0;
+                    n_finished_ = 0;
+                    work_ready_.notify_all();
+
+                    while(next_task_ < n_tasks_)
+                        run_next(lock);
+                    while(n_finished_ < n_tasks_)
+                        work_done_.wait(lock);
+                }
 
             protected:
-                virtual std::streamsize xsputn(const char* s, std::streamsize n)
+                /// @brief Wake the threads to exit and wait for them to do so.
+                void stop()
                 {
-                    SHA256_Update(&ctx_, reinterpret_cast<const uint8_t*>(s), n);
-                    return n;
+                    {
+                        boost::lock_guard<boost::mutex> lock(mutex_);
+                        stopping_ = true;
+                    }
+                    work_ready_.notify_all();
+                    threads_.join_all();
                 }
 
-                virtual void xfinal()
+                /// @brief Run the next task of the batch with the mutex released.
+                void run_next(boost::unique_lock<boost::mutex>& lock)
+                {
+                    const size_t i(next_task_++);
+                    lock.unlock();
+                    fn_(arg_, i);
+                    lock.lock();
+                    if(++n_finished_ == n_tasks_)
+                        work_done_.notify_all();
+                }
+
+                void work()
                 {
-                    uint8_t digest[SHA256_DIGEST_LENGTH];
-                    SHA256_Final(digest, &ctx_);
-                    set_digest(digest, SHA256_DIGEST_LENGTH);
+                    boost::unique_lock<boost::mutex> lock(mutex_);
+                    for(;;)
+                    {
+                        while(!stopping_ && (next_task_ >= n_tasks_))
+                            work_ready_.wait(lock);
+                        if(stopping_)
+                            return;
+                        run_next(lock);
+                    }
                 }
 
-                SHA256_CTX  ctx_;
+                boost::mutex                mutex_;         ///< Guards all of the members below.
+                boost::condition_variable   work_ready_;    ///< Signalled when a batch starts or on stopping.
+                boost::condition_variable   work_done_;     ///< Signalled when the last task of a batch returns.
+                task_fn                     fn_;
+                void*                       arg_;
+                size_t                      n_tasks_, next_task_, n_finished_;
+                bool                        stopping_;
+                boost::thread_group         threads_;
         };
 
-        /// @brief Implementation of SHA-384 hash function.
-        class sha384_hashbuf : public hashbuf
+        /// @brief The number of threads to use given a requested number, zero meaning one per core.
+        unsigned int thread_count(unsigned int threads)
+        {
+            if(threads == 0)
+                threads = boost::thread::hardware_concurrency();
+            return (threads == 0) ? 1 : threads;
+        }
+
+        /// @brief Start \p pool for \p threads threads, the calling thread among them, unless it already is.
+        ///
+        /// Should no thread start, \p threads is set to one so that the caller carries on alone.
+        void start_worker_pool(boost::scoped_ptr<worker_pool>& pool, unsigned int& threads)
+        {
+            if(pool)
+                return;
+
+            try
+            {
+                pool.reset(new worker_pool(threads - 1));
+            }
+            catch(boost::thread_resource_error&)
+            {
+                threads = 1;
+            }
+        }
+
+        /// @brief A hashbuf for the BLAKE2 parallel modes, which may share the leaves between threads.
+        ///
+        /// An update of at least parallel_threshold bytes has its whole stripes dealt out to up to
+        /// leaf_count threads of a worker_pool, the calling thread among them, each compressing its leaves in
+        /// turn. With one thread the leaves are instead compressed together in the lanes of a SIMD kernel
+        /// where there is one. Either way the digest is the same. The worker_pool is only started by the
+        /// first such update. Clones start their own.
+        template<typename Algorithm>
+        class blake2p_hashbuf : public hashbuf
         {
             public:
-                sha384_hashbuf()
-                    : hashbuf()
+                /// @brief The smallest update which is shared between threads.
+                static const size_t parallel_threshold = 256 * 1024;
+
+                blake2p_hashbuf(size_t digest_length, const void* key, size_t key_length, unsigned int threads)
+                    : hashbuf(Algorithm::block_length)
+                    , threads_(std::min(thread_count(threads), static_cast<unsigned int>(Algorithm::leaf_count)))
                 {
-                    SHA384_Init(&ctx_);
+                    Algorithm::init_key(&initial_, digest_length, key, key_length);
+                    ctx_ = initial_;
                 }
 
-                ~sha384_hashbuf()
+                blake2p_hashbuf(const blake2p_hashbuf& other)
+                    : hashbuf(other)
+                    , initial_(other.initial_)
+                    , ctx_(other.ctx_)
+                    , threads_(other.threads_)
+                { }
+
+                ~blake2p_hashbuf()
                 { }
 
             protected:
-                virtual std::streamsize xsputn(const char* s, std::streamsize n)
+                typedef typename Algorithm::context_type context_type;
+
+                /// @brief Whole stripes to be dealt to the leaves, a share of them to each of n_threads tasks.
+                struct leaves_job
+                {
+                    context_type*   ctx;
+                    unsigned int    n_threads;
+                    const uint8_t*  bytes;
+                    size_t          n_stripes;
+                };
+
+                /// @brief Deal the stripes of a leaves_job to the i-th share of leaves, see Algorithm::update_leaves().
+                static void update_leaves(void* arg, size_t i)
                 {
-                    SHA384_Update(&ctx_, reinterpret_cast<const uint8_t*>(s), n);
-                    return n;
+                    const leaves_job* job(static_cast<const leaves_job*>(arg));
+                    const size_t first(i * Algorithm::leaf_count / job->n_threads);
+                    const size_t count((i + 1) * Algorithm::leaf_count / job->n_threads - first);
+                    Algorithm::update_leaves(job->ctx, first, count, job->bytes, job->n_stripes);
+                }
+
+                virtual void xupdate(const uint8_t* bytes, size_t n_bytes)
+                {
+                    if((threads_ > 1) && (n_bytes >= parallel_threshold))
+                        start_worker_pool(pool_, threads_);
+
+                    if(!pool_ || (n_bytes < parallel_threshold))
+                    {
+                        Algorithm::update(&ctx_, bytes, n_bytes);
+                        return;
+                    }
+
+                    // complete any partial stripe so that the leaves may be updated independently
+                    const size_t head((Algorithm::block_length - ctx_.buflen) % Algorithm::block_length);
+                    Algorithm::update(&ctx_, bytes, head);
+                    bytes += head;
+                    n_bytes -= head;
+
+                    leaves_job job = { &ctx_, pool_->size(), bytes, n_bytes / Algorithm::block_length };
+                    pool_->run(update_leaves, &job, job.n_threads);
+
+                    bytes += job.n_stripes * Algorithm::block_length;
+                    Algorithm::update(&ctx_, bytes, n_bytes % Algorithm::block_length);
                 }
 
                 virtual void xfinal()
                 {
-                    uint8_t digest[SHA384_DIGEST_LENGTH];
-                    SHA384_Final(digest, &ctx_);
-                    set_digest(digest, SHA384_DIGEST_LENGTH);
+                    uint8_t digest[Algorithm::digest_length];
+                    Algorithm::final(&ctx_, digest);
+                    set_digest(digest, ctx_.outlen);
+                }
+
+                virtual void xreset()
+                {
+                    ctx_ = initial_;
                 }
 
-                SHA384_CTX  ctx_;
+                virtual boost::shared_ptr<hashbuf> xclone() const
+                {
+                    return boost::shared_ptr<hashbuf>(new blake2p_hashbuf(*this));
+                }
+
+                context_type                    initial_;   ///< The hash as initialised, including any key.
+                context_type                    ctx_;
+                unsigned int                    threads_;   ///< The number of threads sharing an update.
+                boost::scoped_ptr<worker_pool>  pool_;      ///< The threads, once first needed.
         };
 
-        /// @brief Implementation of SHA-512 hash function.
-        class sha512_hashbuf : public hashbuf
+        /// @brief Sharing the subtrees of a BLAKE3 message between the threads of a worker_pool.
+        ///
+        /// A complete subtree passed to split_subtree() by blake3_update_split() is divided into a power of
+        /// two equal parts, themselves complete subtrees, at least min_part_length bytes long and a few for
+        /// each thread. The pool computes the chaining value of each part and these are then merged in
+        /// pairs to the two children of the subtree.
+        namespace blake3_threads
         {
-            public:
-                sha512_hashbuf()
-                    : hashbuf()
+            /// @brief The smallest subtree shared between threads.
+            const size_t parallel_threshold = 512 * 1024;
+
+            /// @brief The smallest part of a subtree given to one thread.
+            const size_t min_part_length = 64 * 1024;
+
+            struct subtree_parts
+            {
+                const uint32_t* key;
+                uint8_t         flags;
+                const uint8_t*  input;
+                size_t          part_length;
+                uint64_t        chunk_counter;
+                uint8_t*        cvs;
+            };
+
+            void compress_part(void* arg, size_t i)
+            {
+                const subtree_parts* parts(static_cast<const subtree_parts*>(arg));
+                const size_t part_chunks(parts->part_length / BLAKE3_CHUNK_LEN);
+                uint8_t children[2 * BLAKE3_OUT_LEN];
+
+                blake3_compress_subtree(NULL, parts->key, parts->flags, parts->input + i * parts->part_length,
+                                        parts->part_length, parts->chunk_counter + i * part_chunks, children);
+                blake3_parent_cv(parts->key, parts->flags, children, parts->cvs + i * BLAKE3_OUT_LEN);
+            }
+
+            void split_subtree(void* arg, const uint32_t key[8], uint8_t flags, const uint8_t* input,
+                               size_t input_len, uint64_t chunk_counter, uint8_t out[2 * BLAKE3_OUT_LEN])
+            {
+                worker_pool* pool(static_cast<worker_pool*>(arg));
+
+                size_t n_parts(2);
+                while((n_parts < 4 * pool->size()) && (input_len / (2 * n_parts) >= min_part_length))
+                    n_parts *= 2;
+
+                std::vector<uint8_t> cvs(n_parts * BLAKE3_OUT_LEN);
+                subtree_parts parts = { key, flags, input, input_len / n_parts, chunk_counter, &cvs[0] };
+                pool->run(compress_part, &parts, n_parts);
+
+                for(; n_parts > 2; n_parts /= 2)
                 {
-                    SHA512_Init(&ctx_);
+                    for(size_t i=0; i<n_parts/2; ++i)
+                        blake3_parent_cv(key, flags, &cvs[2 * i * BLAKE3_OUT_LEN], &cvs[i * BLAKE3_OUT_LEN]);
                 }
+                memcpy(out, &cvs[0], 2 * BLAKE3_OUT_LEN);
+            }
+
+            /// @brief Update a BLAKE3 context, sharing large subtrees between the threads of \p pool.
+            void update(algorithm::blake3::context_type* ctx, const uint8_t* bytes, size_t n_bytes,
+                        worker_pool* pool)
+            {
+                algorithm::blake3::update_split(ctx, bytes, n_bytes, parallel_threshold, split_subtree, pool);
+            }
+
+            /// @brief Initialise a BLAKE3 context with an optional key.
+            algorithm::blake3::context_type keyed_context(const void* key, size_t key_length)
+            {
+                algorithm::blake3::context_type ctx;
+                if(key_length == 0)
+                    algorithm::blake3::init(&ctx);
+                else
+                    algorithm::blake3::init_key(&ctx, key, key_length);
+                return ctx;
+            }
+        }
+
+        /// @brief A hashbuf for BLAKE3, which may share large updates between threads.
+        ///
+        /// The worker_pool is only started by the first update of at least blake3_threads::parallel_threshold
+        /// bytes. Clones start their own. Once finalised, the output may be extended by xsqueeze().
+        class blake3_hashbuf : public hashbuf
+        {
+            public:
+                blake3_hashbuf(const void* key, size_t key_length, unsigned int threads)
+                    : hashbuf(algorithm::blake3::block_length)
+                    , initial_(blake3_threads::keyed_context(key, key_length))
+                    , ctx_(initial_)
+                    , threads_(thread_count(threads))
+                    , n_squeezed_(0)
+                { }
 
-                ~sha512_hashbuf()
+                blake3_hashbuf(const blake3_hashbuf& other)
+                    : hashbuf(other)
+                    , initial_(other.initial_)
+                    , ctx_(other.ctx_)
+                    , threads_(other.threads_)
+                    , n_squeezed_(other.n_squeezed_)
+                { }
+
+                ~blake3_hashbuf()
                 { }
 
             protected:
-                virtual std::streamsize xsputn(const char* s, std::streamsize n)
+                virtual void xupdate(const uint8_t* bytes, size_t n_bytes)
                 {
-                    SHA512_Update(&ctx_, reinterpret_cast<const uint8_t*>(s), n);
-                    return n;
+                    if((threads_ > 1) && (n_bytes >= blake3_threads::parallel_threshold))
+                        start_worker_pool(pool_, threads_);
+
+                    if(!pool_ || (n_bytes < blake3_threads::parallel_threshold))
+                    {
+                        algorithm::blake3::update(&ctx_, bytes, n_bytes);
+                        return;
+                    }
+
+                    blake3_threads::update(&ctx_, bytes, n_bytes, pool_.get());
                 }
 
                 virtual void xfinal()
                 {
-                    uint8_t digest[SHA512_DIGEST_LENGTH];
-                    SHA512_Final(digest, &ctx_);
-                    set_digest(digest, SHA512_DIGEST_LENGTH);
+                    uint8_t digest[algorithm::blake3::digest_length];
+                    algorithm::blake3::final(&ctx_, digest);
+                    set_digest(digest, algorithm::blake3::digest_length);
+                }
+
+                virtual void xsqueeze(uint8_t* out, size_t n_bytes)
+                {
+                    algorithm::blake3::final_seek(&ctx_, n_squeezed_, out, n_bytes);
+                    n_squeezed_ += n_bytes;
+                }
+
+                virtual void xreset()
+                {
+                    ctx_ = initial_;
+                    n_squeezed_ = 0;
                 }
 
-                SHA512_CTX  ctx_;
+                virtual boost::shared_ptr<hashbuf> xclone() const
+                {
+                    return boost::shared_ptr<hashbuf>(new blake3_hashbuf(*this));
+                }
+
+                algorithm::blake3::context_type     initial_;       ///< The hash as initialised, including any key.
+                algorithm::blake3::context_type     ctx_;
+                unsigned int                        threads_;       ///< The number of threads sharing an update.
+                boost::scoped_ptr<worker_pool>      pool_;          ///< The threads, once first needed.
+                uint64_t                            n_squeezed_;    ///< The number of bytes output by xsqueeze().
         };
 
+        typedef basic_hashbuf<algorithm::md5>    md5_hashbuf;    ///< Implementation of MD5 hash function.
+        typedef basic_hashbuf<algorithm::sha1>   sha1_hashbuf;   ///< Implementation of SHA-1 hash function.
+        typedef basic_hashbuf<algorithm::sha256> sha256_hashbuf; ///< Implementation of SHA-256 hash function.
+        typedef basic_hashbuf<algorithm::sha384> sha384_hashbuf; ///< Implementation of SHA-384 hash function.
+        typedef basic_hashbuf<algorithm::sha512> sha512_hashbuf; ///< Implementation of SHA-512 hash function.
+        typedef blake2_hashbuf<algorithm::blake2b> blake2b_hashbuf; ///< Implementation of BLAKE2b hash function.
+        typedef blake2_hashbuf<algorithm::blake2s> blake2s_hashbuf; ///< Implementation of BLAKE2s hash function.
+        typedef blake2p_hashbuf<algorithm::blake2bp> blake2bp_hashbuf; ///< Implementation of BLAKE2bp hash function.
+        typedef blake2p_hashbuf<algorithm::blake2sp> blake2sp_hashbuf; ///< Implementation of BLAKE2sp hash function.
+        typedef basic_hashbuf<algorithm::sha3_224> sha3_224_hashbuf; ///< Implementation of SHA3-224 hash function.
+        typedef basic_hashbuf<algorithm::sha3_256> sha3_256_hashbuf; ///< Implementation of SHA3-256 hash function.
+        typedef basic_hashbuf<algorithm::sha3_384> sha3_384_hashbuf; ///< Implementation of SHA3-384 hash function.
+        typedef basic_hashbuf<algorithm::sha3_512> sha3_512_hashbuf; ///< Implementation of SHA3-512 hash function.
+        typedef shake_hashbuf<algorithm::shake128> shake128_hashbuf; ///< Implementation of SHAKE128 function.
+        typedef shake_hashbuf<algorithm::shake256> shake256_hashbuf; ///< Implementation of SHAKE256 function.
+
         ///@}
     }
 
+    size_t digest_size(standard_hash hf)
+    {
+        switch(hf)
+        {
+            case MD5:
+                return algorithm::md5::digest_length;
+            case SHA1:
+                return algorithm::sha1::digest_length;
+            case SHA256:
+                return algorithm::sha256::digest_length;
+            case SHA384:
+                return algorithm::sha384::digest_length;
+            case SHA512:
+                return algorithm::sha512::digest_length;
+            case BLAKE2B:
+                return algorithm::blake2b::digest_length;
+            case BLAKE2S:
+                return algorithm::blake2s::digest_length;
+            case BLAKE2BP:
+                return algorithm::blake2bp::digest_length;
+            case BLAKE2SP:
+                return algorithm::blake2sp::digest_length;
+            case BLAKE3:
+                return algorithm::blake3::digest_length;
+            case SHA3_224:
+                return algorithm::sha3_224::digest_length;
+            case SHA3_256:
+                return algorithm::sha3_256::digest_length;
+            case SHA3_384:
+                return algorithm::sha3_384::digest_length;
+            case SHA3_512:
+                return algorithm::sha3_512::digest_length;
+            case SHAKE128:
+                return algorithm::shake128::digest_length;
+            case SHAKE256:
+                return algorithm::shake256::digest_length;
+            default:
+                throw std::invalid_argument("unknown hash type passed to digest_size().");
+        }
+
+        /* unreachable */
+    }
+
+    size_t digest(standard_hash hf, const void* data, size_t n_bytes, uint8_t* out)
+    {
+        switch(hf)
+        {
+            case MD5:
+                digest<algorithm::md5>(data, n_bytes, out);
+                return algorithm::md5::digest_length;
+            case SHA1:
+                digest<algorithm::sha1>(data, n_bytes, out);
+                return algorithm::sha1::digest_length;
+            case SHA256:
+                digest<algorithm::sha256>(data, n_bytes, out);
+                return algorithm::sha256::digest_length;
+            case SHA384:
+                digest<algorithm::sha384>(data, n_bytes, out);
+                return algorithm::sha384::digest_length;
+            case SHA512:
+                digest<algorithm::sha512>(data, n_bytes, out);
+                return algorithm::sha512::digest_length;
+            case BLAKE2B:
+                digest<algorithm::blake2b>(data, n_bytes, out);
+                return algorithm::blake2b::digest_length;
+            case BLAKE2S:
+                digest<algorithm::blake2s>(data, n_bytes, out);
+                return algorithm::blake2s::digest_length;
+            case BLAKE2BP:
+                digest<algorithm::blake2bp>(data, n_bytes, out);
+                return algorithm::blake2bp::digest_length;
+            case BLAKE2SP:
+                digest<algorithm::blake2sp>(data, n_bytes, out);
+                return algorithm::blake2sp::digest_length;
+            case BLAKE3:
+                digest<algorithm::blake3>(data, n_bytes, out);
+                return algorithm::blake3::digest_length;
+            case SHA3_224:
+                digest<algorithm::sha3_224>(data, n_bytes, out);
+                return algorithm::sha3_224::digest_length;
+            case SHA3_256:
+                digest<algorithm::sha3_256>(data, n_bytes, out);
+                return algorithm::sha3_256::digest_length;
+            case SHA3_384:
+                digest<algorithm::sha3_384>(data, n_bytes, out);
+                return algorithm::sha3_384::digest_length;
+            case SHA3_512:
+                digest<algorithm::sha3_512>(data, n_bytes, out);
+                return algorithm::sha3_512::digest_length;
+            case SHAKE128:
+                digest<algorithm::shake128>(data, n_bytes, out);
+                return algorithm::shake128::digest_length;
+            case SHAKE256:
+                digest<algorithm::shake256>(data, n_bytes, out);
+                return algorithm::shake256::digest_length;
+            default:
+                throw std::invalid_argument("unknown hash type passed to digest().");
+        }
+
+        /* unreachable */
+    }
+
+    hash_digest digest(standard_hash hf, const void* data, size_t n_bytes)
+    {
+        uint8_t out[hash_digest::max_size];
+        size_t n_out(digest(hf, data, n_bytes, out));
+        return hash_digest(out, n_out);
+    }
+
+    size_t digest_many(standard_hash hf, const void* const* data, const size_t* n_bytes, size_t n, uint8_t* out)
+    {
+        const size_t length(digest_size(hf));
+
+        switch(hf)
+        {
+            case MD5:
+                md5_many(reinterpret_cast<const md5_byte_t* const*>(data), n_bytes, n,
+                         reinterpret_cast<md5_byte_t(*)[16]>(out));
+                break;
+            case SHA1:
+                SHA1_Many(reinterpret_cast<const uint8_t* const*>(data), n_bytes, n,
+                          reinterpret_cast<uint8_t(*)[SHA1_DIGEST_SIZE]>(out));
+                break;
+            case SHA256:
+                SHA256_Many(reinterpret_cast<const uint8_t* const*>(data), n_bytes, n,
+                            reinterpret_cast<uint8_t(*)[SHA256_DIGEST_LENGTH]>(out));
+                break;
+            case SHA384:
+                SHA384_Many(reinterpret_cast<const uint8_t* const*>(data), n_bytes, n,
+                            reinterpret_cast<uint8_t(*)[SHA384_DIGEST_LENGTH]>(out));
+                break;
+            case SHA512:
+                SHA512_Many(reinterpret_cast<const uint8_t* const*>(data), n_bytes, n,
+                            reinterpret_cast<uint8_t(*)[SHA512_DIGEST_LENGTH]>(out));
+                break;
+            case SHA3_224:
+                sha3_many(algorithm::sha3_224::block_length, algorithm::sha3_224::domain,
+                          reinterpret_cast<const uint8_t* const*>(data), n_bytes, n, out, length);
+                break;
+            case SHA3_256:
+                sha3_many(algorithm::sha3_256::block_length, algorithm::sha3_256::domain,
+                          reinterpret_cast<const uint8_t* const*>(data), n_bytes, n, out, length);
+                break;
+            case SHA3_384:
+                sha3_many(algorithm::sha3_384::block_length, algorithm::sha3_384::domain,
+                          reinterpret_cast<const uint8_t* const*>(data), n_bytes, n, out, length);
+                break;
+            case SHA3_512:
+                sha3_many(algorithm::sha3_512::block_length, algorithm::sha3_512::domain,
+                          reinterpret_cast<const uint8_t* const*>(data), n_bytes, n, out, length);
+                break;
+            case SHAKE128:
+                sha3_many(algorithm::shake128::block_length, algorithm::shake128::domain,
+                          reinterpret_cast<const uint8_t* const*>(data), n_bytes, n, out, length);
+                break;
+            case SHAKE256:
+                sha3_many(algorithm::shake256::block_length, algorithm::shake256::domain,
+                          reinterpret_cast<const uint8_t* const*>(data), n_bytes, n, out, length);
+                break;
+            default:
+                // no multi-buffer implementation so hash each message in turn
+                for(size_t i=0; i<n; ++i)
+                    digest(hf, data[i], n_bytes[i], out + i * length);
+                break;
+        }
+
+        return n * length;
+    }
+
     boost::shared_ptr<hashbuf> make_standard_hashbuf(standard_hash hf)
     {
         switch(hf)
@@ -212,10 +763,78 @@ namespace hashstream
                 return boost::shared_ptr<hashbuf>(new standard::sha384_hashbuf());
             case SHA512:
                 return boost::shared_ptr<hashbuf>(new standard::sha512_hashbuf());
+            case BLAKE2B:
+                return make_blake2b_hashbuf();
+            case BLAKE2S:
+                return make_blake2s_hashbuf();
+            case BLAKE2BP:
+                return make_blake2bp_hashbuf();
+            case BLAKE2SP:
+                return make_blake2sp_hashbuf();
+            case BLAKE3:
+                return make_blake3_hashbuf();
+            case SHA3_224:
+                return boost::shared_ptr<hashbuf>(new standard::sha3_224_hashbuf());
+            case SHA3_256:
+                return boost::shared_ptr<hashbuf>(new standard::sha3_256_hashbuf());
+            case SHA3_384:
+                return boost::shared_ptr<hashbuf>(new standard::sha3_384_hashbuf());
+            case SHA3_512:
+                return boost::shared_ptr<hashbuf>(new standard::sha3_512_hashbuf());
+            case SHAKE128:
+                return boost::shared_ptr<hashbuf>(new standard::shake128_hashbuf());
+            case SHAKE256:
+                return boost::shared_ptr<hashbuf>(new standard::shake256_hashbuf());
             default:
                 throw std::invalid_argument("unknown hash type passed to make_standard_hashbuf().");
         }
 
         /* unreachable */
     }
+
+    boost::shared_ptr<hashbuf> make_blake2b_hashbuf(size_t digest_length, const void* key, size_t key_length)
+    {
+        return boost::shared_ptr<hashbuf>(new standard::blake2b_hashbuf(digest_length, key, key_length));
+    }
+
+    boost::shared_ptr<hashbuf> make_blake2s_hashbuf(size_t digest_length, const void* key, size_t key_length)
+    {
+        return boost::shared_ptr<hashbuf>(new standard::blake2s_hashbuf(digest_length, key, key_length));
+    }
+
+    boost::shared_ptr<hashbuf> make_blake2bp_hashbuf(size_t digest_length, const void* key, size_t key_length,
+                                                     unsigned int threads)
+    {
+        return boost::shared_ptr<hashbuf>(new standard::blake2bp_hashbuf(digest_length, key, key_length, threads));
+    }
+
+    boost::shared_ptr<hashbuf> make_blake2sp_hashbuf(size_t digest_length, const void* key, size_t key_length,
+                                                     unsigned int threads)
+    {
+        return boost::shared_ptr<hashbuf>(new standard::blake2sp_hashbuf(digest_length, key, key_length, threads));
+    }
+
+    boost::shared_ptr<hashbuf> make_blake3_hashbuf(const void* key, size_t key_length, unsigned int threads)
+    {
+        return boost::shared_ptr<hashbuf>(new standard::blake3_hashbuf(key, key_length, threads));
+    }
+
+    void blake3_digest(const void* data, size_t n_bytes, uint8_t* out, size_t n_out, const void* key,
+                       size_t key_length, unsigned int threads)
+    {
+        algorithm::blake3::context_type ctx(standard::blake3_threads::keyed_context(key, key_length));
+        const uint8_t* bytes(static_cast<const uint8_t*>(data));
+
+        threads = standard::thread_count(threads);
+        boost::scoped_ptr<standard::worker_pool> pool;
+        if((threads > 1) && (n_bytes >= standard::blake3_threads::parallel_threshold))
+            standard::start_worker_pool(pool, threads);
+
+        if(!pool)
+            algorithm::blake3::update(&ctx, bytes, n_bytes);
+        else
+            standard::blake3_threads::update(&ctx, bytes, n_bytes, pool.get());
+
+        algorithm::blake3::final_seek(&ctx, 0, out, n_out);
+    }
 }
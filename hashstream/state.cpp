@@ -0,0 +1,113 @@
+//  Copyright (c) 2011, Rich Wareham <rjw57@cam.ac.uk>
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//      * Redistributions of source code must retain the above copyright
+//	notice, this list of conditions and the following disclaimer.
+//      * Redistributions in binary form must reproduce the above copyright
+//	notice, this list of conditions and the following disclaimer in the
+//	documentation and/or other materials provided with the distribution.
+//      * Neither the name of the hashstream library nor the
+//	names of its contributors may be used to endorse or promote products
+//	derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+//  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL RICH WAREHAM BE LIABLE FOR ANY
+//  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+//  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+//  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+//  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "hasher.hpp"
+
+namespace hashstream
+{
+    namespace
+    {
+        // Layout of a serialised hash state, all values big-endian:
+        //
+        //   offset  size  contents
+        //        0     4  magic "HSST"
+        //        4     1  format version
+        //        5     1  algorithm tag
+        //        6     1  bytes per chaining variable (4 or 8)
+        //        7     1  number of chaining variables
+        //        8     8  total message bytes absorbed
+        //       16     2  number of pending message bytes
+        //       18     -  chaining variables followed by pending message bytes
+        const uint8_t state_magic[4] = { 'H', 'S', 'S', 'T' };
+        const uint8_t state_version = 1;
+        const size_t state_header_size = 18;
+
+        void put_be(std::vector<uint8_t>& out, uint64_t v, size_t n_bytes)
+        {
+            for(size_t i=n_bytes; i>0; --i)
+                out.push_back(static_cast<uint8_t>(v >> (8 * (i-1))));
+        }
+
+        uint64_t get_be(const uint8_t* p, size_t n_bytes)
+        {
+            uint64_t v(0);
+            for(size_t i=0; i<n_bytes; ++i)
+                v = (v << 8) | p[i];
+            return v;
+        }
+    }
+
+    std::vector<uint8_t> encode_hash_state(uint8_t algorithm_tag, size_t word_bytes,
+                                           const uint64_t* words, size_t n_words,
+                                           uint64_t n_bytes, const uint8_t* pending, size_t n_pending)
+    {
+        std::vector<uint8_t> out;
+        out.reserve(state_header_size + word_bytes * n_words + n_pending);
+
+        out.insert(out.end(), state_magic, state_magic + 4);
+        out.push_back(state_version);
+        out.push_back(algorithm_tag);
+        out.push_back(static_cast<uint8_t>(word_bytes));
+        out.push_back(static_cast<uint8_t>(n_words));
+        put_be(out, n_bytes, 8);
+        put_be(out, n_pending, 2);
+
+        for(size_t i=0; i<n_words; ++i)
+            put_be(out, words[i], word_bytes);
+        out.insert(out.end(), pending, pending + n_pending);
+
+        return out;
+    }
+
+    const uint8_t* decode_hash_state(const std::vector<uint8_t>& state, uint8_t algorithm_tag,
+                                     size_t word_bytes, uint64_t* words, size_t n_words,
+                                     uint64_t* n_bytes, size_t* n_pending)
+    {
+        if((state.size() < state_header_size) || !std::equal(state_magic, state_magic + 4, state.begin()))
+            throw std::invalid_argument("not a saved hash state");
+
+        const uint8_t* p(&state[0]);
+        if(p[4] != state_version)
+            throw std::invalid_argument("unsupported saved hash state version");
+        if(p[5] != algorithm_tag)
+            throw std::invalid_argument("saved hash state is for a different hash function");
+        if((p[6] != word_bytes) || (p[7] != n_words))
+            throw std::invalid_argument("saved hash state has an unexpected number of chaining variables");
+
+        *n_bytes = get_be(p + 8, 8);
+        *n_pending = static_cast<size_t>(get_be(p + 16, 2));
+        if(state.size() != state_header_size + word_bytes * n_words + *n_pending)
+            throw std::invalid_argument("saved hash state has an unexpected length");
+
+        p += state_header_size;
+        for(size_t i=0; i<n_words; ++i, p += word_bytes)
+            words[i] = get_be(p, word_bytes);
+
+        return p;
+    }
+}
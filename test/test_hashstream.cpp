@@ -23,10 +23,14 @@
 //  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 //  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 #include <hashstream.hpp>
+#include <hasher.hpp>
 
 void report_fail(const std::string f_name,
                  const std::string& input, const std::string& expected_hex_digest,
@@ -53,6 +57,16 @@ bool test_standard_hash(hashstream::standard_hash f, const std::string f_name,
         passed = false;
     }
 
+    // test raw update
+    hashstream::hashstream hs_raw(f);
+    hs_raw.update(input.data(), input.size());
+    if(hs_raw.hex_digest() != expected_hex_digest)
+    {
+        std::cerr << "using hashstream::update(const void*, size_t):" << std::endl;
+        report_fail(f_name, input, expected_hex_digest, hs_raw.hex_digest());
+        passed = false;
+    }
+
     // test ostream operators
     std::stringstream oss;
     oss << hs;
@@ -63,6 +77,28 @@ bool test_standard_hash(hashstream::standard_hash f, const std::string f_name,
         passed = false;
     }
 
+    // test non-allocating hex output
+    char hex[2 * hashstream::hash_digest::max_size + 1];
+    size_t n_hex(hs.hex_digest_into(hex));
+    if((n_hex != expected_hex_digest.size()) || (std::string(hex) != expected_hex_digest))
+    {
+        std::cerr << "using hashstream::hex_digest_into(char*):" << std::endl;
+        report_fail(f_name, input, expected_hex_digest, hex);
+        passed = false;
+    }
+
+    // test one-shot digest
+    hashstream::hash_digest one_shot(hashstream::digest(f, input.data(), input.size()));
+    char one_shot_hex[2 * hashstream::hash_digest::max_size];
+    hashstream::hex_encode(one_shot.data(), one_shot.size(), one_shot_hex);
+    if((one_shot.size() != hashstream::digest_size(f)) ||
+       (std::string(one_shot_hex, 2 * one_shot.size()) != expected_hex_digest))
+    {
+        std::cerr << "using hashstream::digest(standard_hash, const void*, size_t):" << std::endl;
+        report_fail(f_name, input, expected_hex_digest, std::string(one_shot_hex, 2 * one_shot.size()));
+        passed = false;
+    }
+
     // test convenience istream wrappers
     std::stringstream ss(input);
     if((temp_digest = hashstream::hex_digest(f, ss)) != expected_hex_digest)
@@ -138,6 +174,616 @@ bool test_sha512(const std::string& input, const std::string& expected_hex_diges
     return passed;
 }
 
+bool test_blake2b(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::BLAKE2B, "BLAKE2B", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_blake2s(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::BLAKE2S, "BLAKE2S", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_blake2bp(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::BLAKE2BP, "BLAKE2BP", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_blake2sp(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::BLAKE2SP, "BLAKE2SP", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_blake3(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::BLAKE3, "BLAKE3", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_sha3_224(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::SHA3_224, "SHA3_224", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_sha3_256(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::SHA3_256, "SHA3_256", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_sha3_384(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::SHA3_384, "SHA3_384", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_sha3_512(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::SHA3_512, "SHA3_512", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_shake128(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::SHAKE128, "SHAKE128", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_shake256(const std::string& input, const std::string& expected_hex_digest)
+{
+    bool passed(true);
+
+    passed = passed && test_standard_hash(hashstream::SHAKE256, "SHAKE256", input, expected_hex_digest);
+
+    return passed;
+}
+
+bool test_blake2_keyed()
+{
+    bool passed = true;
+
+    std::string key, input;
+    for(int i=0; i<64; ++i)
+        key.push_back(static_cast<char>(i));
+    for(int i=0; i<256; ++i)
+        input.push_back(static_cast<char>(i));
+
+    struct
+    {
+        bool            is_blake2b;
+        size_t          digest_length;
+        size_t          key_length;
+        const char*     input;
+        const char*     expect;
+    } cases[] = {
+        { true, 64, 64, NULL,
+          "b72071e096277edebb8ee5134dd3714996307ba3a55aa4733d412abbe28e909e"
+          "10e57e6fbfb4ef53b3b960518294ff889a90829254412e2a60b85add07a3674f" },
+        { true, 32, 0, "abc", "bddd813c634239723171ef3fee98579b94964e3bb1cb3e427262c8c068d52319" },
+        { false, 32, 32, NULL, "5211d1aefc0025be7f85c06b3e14e0fc645ae12bd41746485ea6d8a364a2eaee" },
+        { false, 16, 3, "abc", "94fdf6f35b9999920dcdcaee361ad435" },
+    };
+
+    for(size_t i=0; i<sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        // the three byte keys are "key", the others taken from the start of the key above
+        const char* key_bytes(cases[i].key_length == 3 ? "key" : key.data());
+        std::string message(cases[i].input ? std::string(cases[i].input) : input);
+        const char* f_name(cases[i].is_blake2b ? "BLAKE2B" : "BLAKE2S");
+
+        hashstream::hashstream hs(cases[i].is_blake2b
+            ? hashstream::make_blake2b_hashbuf(cases[i].digest_length, key_bytes, cases[i].key_length)
+            : hashstream::make_blake2s_hashbuf(cases[i].digest_length, key_bytes, cases[i].key_length));
+
+        // the key must survive a reset
+        hs << "discarded";
+        hs.reset();
+        hs << message;
+
+        if(hs.hex_digest() != cases[i].expect)
+        {
+            std::cerr << "using keyed " << f_name << " of length " << cases[i].digest_length << ":" << std::endl;
+            report_fail(f_name, "<input>", cases[i].expect, hs.hex_digest());
+            passed = false;
+        }
+
+        // likewise for a basic_hasher constructed from a keyed context, whose digest is zero-padded
+        char hex[2 * hashstream::blake2b_hasher::digest_length];
+        std::string got;
+        if(cases[i].is_blake2b)
+        {
+            hashstream::blake2b_hasher::context_type ctx;
+            hashstream::algorithm::blake2b::init_key(&ctx, cases[i].digest_length, key_bytes, cases[i].key_length);
+            hashstream::blake2b_hasher h(ctx);
+            h.update("discarded");
+            h.reset();
+            h.update(message);
+            hashstream::blake2b_hasher::digest_type d(h.finalise());
+            hashstream::hex_encode(d.data(), d.size(), hex);
+            got.assign(hex, 2 * d.size());
+        }
+        else
+        {
+            hashstream::blake2s_hasher::context_type ctx;
+            hashstream::algorithm::blake2s::init_key(&ctx, cases[i].digest_length, key_bytes, cases[i].key_length);
+            hashstream::blake2s_hasher h(ctx);
+            h.update("discarded");
+            h.reset();
+            h.update(message);
+            hashstream::blake2s_hasher::digest_type d(h.finalise());
+            hashstream::hex_encode(d.data(), d.size(), hex);
+            got.assign(hex, 2 * d.size());
+        }
+
+        std::string expect_padded(cases[i].expect);
+        expect_padded.resize(got.size(), '0');
+        if(got != expect_padded)
+        {
+            std::cerr << "using keyed basic_hasher<" << f_name << "> of length " << cases[i].digest_length
+                      << ":" << std::endl;
+            report_fail(f_name, "<input>", expect_padded, got);
+            passed = false;
+        }
+    }
+
+    // the state of a keyed hash may only be saved once the key block has been compressed
+    const std::string mac_key(64, '\xa5');
+    hashstream::hashstream expect_mac(hashstream::make_blake2b_hashbuf(64, mac_key.data(), mac_key.size()));
+    expect_mac << input;
+
+    boost::shared_ptr<hashstream::hashbuf> keyed(hashstream::make_blake2b_hashbuf(64, mac_key.data(), mac_key.size()));
+    keyed->update(input.data(), 100);
+    try
+    {
+        keyed->save_state();
+        std::cerr << "using hashbuf::save_state(): keyed BLAKE2B state saved with its key pending" << std::endl;
+        passed = false;
+    }
+    catch(std::runtime_error&)
+    { }
+
+    keyed->update(input.data() + 100, 100);
+    std::vector<uint8_t> state(keyed->save_state());
+    if(std::search(state.begin(), state.end(), mac_key.begin(), mac_key.end()) != state.end())
+    {
+        std::cerr << "using hashbuf::save_state(): keyed BLAKE2B state contains its key" << std::endl;
+        passed = false;
+    }
+
+    hashstream::hashstream resumed(hashstream::make_blake2b_hashbuf(64, mac_key.data(), mac_key.size()));
+    resumed.rdbuf()->restore_state(state);
+    resumed.write(input.data() + 200, input.size() - 200);
+    if(resumed.hex_digest() != expect_mac.hex_digest())
+    {
+        std::cerr << "using hashbuf::restore_state() on keyed BLAKE2B:" << std::endl;
+        report_fail("BLAKE2B", "<input>", expect_mac.hex_digest(), resumed.hex_digest());
+        passed = false;
+    }
+
+    // out of range digest and key lengths are rejected
+    // as digest length and key length for BLAKE2b, then the same for BLAKE2s
+    const size_t bad[][4] = { { 0, 0, 0, 0 }, { 65, 0, 33, 0 }, { 64, 65, 32, 33 } };
+    for(size_t i=0; i<3; ++i)
+    {
+        try
+        {
+            hashstream::make_blake2b_hashbuf(bad[i][0], key.data(), bad[i][1]);
+            std::cerr << "using make_blake2b_hashbuf(): invalid lengths were not rejected" << std::endl;
+            passed = false;
+        }
+        catch(std::invalid_argument&)
+        { }
+
+        try
+        {
+            hashstream::make_blake2s_hashbuf(bad[i][2], key.data(), bad[i][3]);
+            std::cerr << "using make_blake2s_hashbuf(): invalid lengths were not rejected" << std::endl;
+            passed = false;
+        }
+        catch(std::invalid_argument&)
+        { }
+    }
+
+    return passed;
+}
+
+bool test_blake2_parallel()
+{
+    bool passed = true;
+
+    std::string key, input;
+    for(int i=0; i<64; ++i)
+        key.push_back(static_cast<char>(i));
+    for(int i=0; i<255; ++i)
+        input.push_back(static_cast<char>(i));
+
+    struct
+    {
+        bool            is_blake2bp;
+        size_t          digest_length;
+        size_t          key_length;
+        const char*     input;
+        const char*     expect;
+    } cases[] = {
+        { true, 64, 64, "",
+          "9d9461073e4eb640a255357b839f394b838c6ff57c9b686a3f76107c1066728f"
+          "3c9956bd785cbc3bf79dc2ab578c5a0c063b9d9c405848de1dbe821cd05c940a" },
+        { true, 64, 64, NULL,
+          "96fbcbb60bd313b8845033e5bc058a38027438572d7e7957f3684f6268aadd3a"
+          "d08d21767ed6878685331ba98571487e12470aad669326716e46667f69f8d7e8" },
+        { true, 32, 0, "abc", "4792f00c05827a437fc55481e447eea1c9a39add28087733b3e53f1c04430dc7" },
+        { false, 32, 32, "", "715cb13895aeb678f6124160bff21465b30f4f6874193fc851b4621043f09cc6" },
+        { false, 32, 32, NULL, "0c8a36597d7461c63a94732821c941856c668376606c86a52de0ee4104c615db" },
+        { false, 16, 3, "abc", "62f780058d38901b9f4bfa0c3d3b6354" },
+    };
+
+    for(size_t i=0; i<sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        // as test_blake2_keyed(), the input defaulting to the 255 byte message of the reference tests
+        const char* key_bytes(cases[i].key_length == 3 ? "key" : key.data());
+        std::string message(cases[i].input ? std::string(cases[i].input) : input);
+        const char* f_name(cases[i].is_blake2bp ? "BLAKE2BP" : "BLAKE2SP");
+
+        hashstream::hashstream hs(cases[i].is_blake2bp
+            ? hashstream::make_blake2bp_hashbuf(cases[i].digest_length, key_bytes, cases[i].key_length)
+            : hashstream::make_blake2sp_hashbuf(cases[i].digest_length, key_bytes, cases[i].key_length));
+
+        hs << "discarded";
+        hs.reset();
+        hs << message;
+
+        if(hs.hex_digest() != cases[i].expect)
+        {
+            std::cerr << "using keyed " << f_name << " of length " << cases[i].digest_length << ":" << std::endl;
+            report_fail(f_name, "<input>", cases[i].expect, hs.hex_digest());
+            passed = false;
+        }
+    }
+
+    // the digest is independent of the number of threads, which may exceed the number of leaves, and
+    // one update() large enough to be shared between them follows one which leaves a partial stripe
+    std::string big;
+    for(int i=0; i<(1 << 20) + 777; ++i)
+        big.push_back(static_cast<char>((i * 7 + (i >> 9)) & 0xff));
+    const char* expect_big[] = {
+        "2f25146c5d860e4a89bbdfe2139e871bd439ac550333eb243dc089d4c608f42e"
+        "494b92e246d0391b0c18e7ffc21f98e71229cfaf5dab631f24bbf64f5b4c3ca9",
+        "4ac05e94a319ec01edd4f8feff521380d02cd73afccc33b21e5f78b3c6a0476e",
+    };
+    for(unsigned int threads=0; threads<=9; ++threads)
+    {
+        for(int j=0; j<2; ++j)
+        {
+            const char* f_name(j == 0 ? "BLAKE2BP" : "BLAKE2SP");
+            boost::shared_ptr<hashstream::hashbuf> hb(j == 0
+                ? hashstream::make_blake2bp_hashbuf(64, NULL, 0, threads)
+                : hashstream::make_blake2sp_hashbuf(32, NULL, 0, threads));
+            hb->update(big.data(), 100);
+            hb->update(big.data() + 100, big.size() - 100);
+            hb->finalise();
+
+            if(hb->hex_digest() != expect_big[j])
+            {
+                std::cerr << "using " << f_name << " with " << threads << " threads:" << std::endl;
+                report_fail(f_name, "<input>", expect_big[j], hb->hex_digest());
+                passed = false;
+            }
+        }
+    }
+
+    // keyed hashing is shared between threads in the same way, reusing the threads for each large update
+    // and starting new ones for a clone
+    boost::shared_ptr<hashstream::hashbuf> serial(hashstream::make_blake2bp_hashbuf(48, key.data(), 40, 1));
+    boost::shared_ptr<hashstream::hashbuf> threaded(hashstream::make_blake2bp_hashbuf(48, key.data(), 40, 3));
+    serial->update(big);
+    serial->finalise();
+    const size_t piece(300 * 1024);
+    threaded->update(big.data(), piece);
+    boost::shared_ptr<hashstream::hashbuf> cloned(threaded->clone());
+    for(size_t offset=piece; offset<big.size(); offset+=piece)
+    {
+        threaded->update(big.data() + offset, std::min(piece, big.size() - offset));
+        cloned->update(big.data() + offset, std::min(piece, big.size() - offset));
+    }
+    threaded->finalise();
+    cloned->finalise();
+    if((serial->hex_digest() != threaded->hex_digest()) || (serial->hex_digest() != cloned->hex_digest()))
+    {
+        std::cerr << "using keyed BLAKE2BP: threaded digest differs" << std::endl;
+        passed = false;
+    }
+
+    // out of range digest and key lengths are rejected
+    const size_t bad[][4] = { { 0, 0, 0, 0 }, { 65, 0, 33, 0 }, { 64, 65, 32, 33 } };
+    for(size_t i=0; i<3; ++i)
+    {
+        try
+        {
+            hashstream::make_blake2bp_hashbuf(bad[i][0], key.data(), bad[i][1]);
+            std::cerr << "using make_blake2bp_hashbuf(): invalid lengths were not rejected" << std::endl;
+            passed = false;
+        }
+        catch(std::invalid_argument&)
+        { }
+
+        try
+        {
+            hashstream::make_blake2sp_hashbuf(bad[i][2], key.data(), bad[i][3]);
+            std::cerr << "using make_blake2sp_hashbuf(): invalid lengths were not rejected" << std::endl;
+            passed = false;
+        }
+        catch(std::invalid_argument&)
+        { }
+    }
+
+    return passed;
+}
+
+bool test_blake3_modes()
+{
+    bool passed = true;
+
+    std::string key, input;
+    for(int i=0; i<32; ++i)
+        key.push_back(static_cast<char>(i));
+    for(int i=0; i<255; ++i)
+        input.push_back(static_cast<char>(i));
+
+    // keyed hashing, and output extended beyond the digest, read in pieces of differing lengths
+    struct
+    {
+        bool            keyed;
+        const char*     input;
+        const char*     expect;
+    } cases[] = {
+        { true, "", "73492b19995d71cdb1e9d74decc09809eb732f1b00bc95c27cb15f9dd4d6478f" },
+        { true, NULL,
+          "c6a6871e82a8770cc844b5f9f239a3a595e18ea91b784f51dc89fcb723b686f5b895ec623e2baaeb475288028fa22e9f"
+          "b269f39ea3fa9e247a377b07d6e23c95c7ff37b2fb0273d896425db2670e9bf43816fe33e2c6ffa3f740b6b260f5ff6e"
+          "12ac8e79" },
+        { false, "abc",
+          "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d851fb250ae7393f5d02813b65d521a0d49"
+          "2d9ba09cf7ce7f4cffd900f23374bf0bc08a1fb0b38ed276181ccbd9f7b7edbddf9f86404ad7929605f6ffa3fb1ac879"
+          "83105f013384f2f11d38879c985d47003804b905f0c38975e28d36804bb60d8c303653" },
+    };
+
+    for(size_t i=0; i<sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        std::string message(cases[i].input ? std::string(cases[i].input) : input);
+        const size_t n_out(strlen(cases[i].expect) / 2);
+
+        hashstream::hashstream hs(cases[i].keyed
+            ? hashstream::make_blake3_hashbuf(key.data(), key.size())
+            : hashstream::make_blake3_hashbuf());
+
+        hs << "discarded";
+        hs.reset();
+        hs << message;
+
+        // the digest is the start of the output
+        std::string expect(cases[i].expect);
+        if(hs.hex_digest() != expect.substr(0, 64))
+        {
+            report_fail("BLAKE3", "<input>", expect.substr(0, 64), hs.hex_digest());
+            passed = false;
+        }
+
+        std::vector<uint8_t> out(n_out);
+        for(size_t offset=0, n=1; offset<n_out; offset+=n, n=2*n+1)
+            hs.rdbuf()->squeeze(&out[offset], std::min(n, n_out - offset));
+
+        std::vector<char> hex(2 * n_out);
+        hashstream::hex_encode(&out[0], n_out, &hex[0]);
+        if(std::string(hex.begin(), hex.end()) != expect)
+        {
+            std::cerr << "using hashbuf::squeeze():" << std::endl;
+            report_fail("BLAKE3", "<input>", expect, std::string(hex.begin(), hex.end()));
+            passed = false;
+        }
+
+        // the whole-buffer entry point agrees
+        hashstream::blake3_digest(message.data(), message.size(), &out[0], n_out,
+                                  cases[i].keyed ? key.data() : NULL, cases[i].keyed ? key.size() : 0);
+        hashstream::hex_encode(&out[0], n_out, &hex[0]);
+        if(std::string(hex.begin(), hex.end()) != expect)
+        {
+            std::cerr << "using blake3_digest():" << std::endl;
+            report_fail("BLAKE3", "<input>", expect, std::string(hex.begin(), hex.end()));
+            passed = false;
+        }
+    }
+
+    // the output is independent of the number of threads, large updates being shared between them, and
+    // of whether the message arrives in one buffer or several
+    std::string big;
+    for(int i=0; i<(1 << 20) + 777; ++i)
+        big.push_back(static_cast<char>((i * 7 + (i >> 9)) & 0xff));
+    const std::string expect_big(
+        "65439824887b1349ecceb53f9969b8b0bc48d7fd82e97c0c8f5fe9d239e91bdb0d2cf186212a02c551c16d64fc3cbea1"
+        "4d75f8eea54f86d70584511d7de1231a6552c7ab19170061098635f9901ab2e3947036a41c1cc892d66d159a102711ad"
+        "65b0bb51");
+    for(unsigned int threads=0; threads<=9; ++threads)
+    {
+        boost::shared_ptr<hashstream::hashbuf> hb(hashstream::make_blake3_hashbuf(NULL, 0, threads));
+        hb->update(big.data(), 100);
+        hb->update(big.data() + 100, big.size() - 100);
+        hb->finalise();
+
+        if(hb->hex_digest() != expect_big.substr(0, 64))
+        {
+            std::cerr << "using BLAKE3 with " << threads << " threads:" << std::endl;
+            report_fail("BLAKE3", "<input>", expect_big.substr(0, 64), hb->hex_digest());
+            passed = false;
+        }
+
+        uint8_t out[100];
+        char hex[200];
+        hashstream::blake3_digest(big.data(), big.size(), out, sizeof(out), NULL, 0, threads);
+        hashstream::hex_encode(out, sizeof(out), hex);
+        if(std::string(hex, sizeof(hex)) != expect_big)
+        {
+            std::cerr << "using blake3_digest() with " << threads << " threads:" << std::endl;
+            report_fail("BLAKE3", "<input>", expect_big, std::string(hex, sizeof(hex)));
+            passed = false;
+        }
+    }
+
+    // keyed hashing is shared between threads in the same way
+    boost::shared_ptr<hashstream::hashbuf> threaded(hashstream::make_blake3_hashbuf(key.data(), key.size(), 3));
+    threaded->update(big);
+    threaded->finalise();
+    if(threaded->hex_digest() != "24818ebcf082fc9748b8d373c36b023c431c4f359446d83370e3809b6b1a68d0")
+    {
+        std::cerr << "using keyed BLAKE3 with 3 threads:" << std::endl;
+        report_fail("BLAKE3", "<input>", "24818ebcf082fc9748b8d373c36b023c431c4f359446d83370e3809b6b1a68d0",
+                    threaded->hex_digest());
+        passed = false;
+    }
+
+    // keys must be 32 bytes long
+    const size_t bad[] = { 16, 31, 33 };
+    for(size_t i=0; i<3; ++i)
+    {
+        try
+        {
+            hashstream::make_blake3_hashbuf(key.data(), bad[i]);
+            std::cerr << "using make_blake3_hashbuf(): an invalid key length was not rejected" << std::endl;
+            passed = false;
+        }
+        catch(std::invalid_argument&)
+        { }
+    }
+
+    // output may only be squeezed once finalised, and only from extendable-output functions
+    uint8_t out[8];
+    boost::shared_ptr<hashstream::hashbuf> unfinalised(hashstream::make_blake3_hashbuf());
+    boost::shared_ptr<hashstream::hashbuf> fixed(hashstream::make_standard_hashbuf(hashstream::SHA256));
+    fixed->finalise();
+    try
+    {
+        unfinalised->squeeze(out, sizeof(out));
+        std::cerr << "using BLAKE3: squeeze() before finalise() did not throw" << std::endl;
+        passed = false;
+    }
+    catch(std::runtime_error&)
+    { }
+    try
+    {
+        fixed->squeeze(out, sizeof(out));
+        std::cerr << "using SHA256: squeeze() did not throw" << std::endl;
+        passed = false;
+    }
+    catch(std::runtime_error&)
+    { }
+
+    return passed;
+}
+
+std::string hex_of(const uint8_t* bytes, size_t n_bytes)
+{
+    std::vector<char> hex(2 * n_bytes);
+    hashstream::hex_encode(bytes, n_bytes, &hex[0]);
+    return std::string(hex.begin(), hex.end());
+}
+
+bool test_shake()
+{
+    bool passed = true;
+
+    // SHAKE256("abc") to 200 bytes, which crosses a block boundary of the output
+    const std::string expect("483366601360a8771c6863080cc4114d8db44530f8f1e1ee4f94ea37e78b5739"
+                             "d5a15bef186a5386c75744c0527e1faa9f8726e462a12a4feb06bd8801e751e4"
+                             "1385141204f329979fd3047a13c5657724ada64d2470157b3cdc288620944d78"
+                             "dbcddbd912993f0913f164fb2ce95131a2d09a3e6d51cbfc622720d7a75c6334"
+                             "e8a2d7ec71a7cc29cf0ea610eeff1a588290a53000faa79932becec0bd3cd0b3"
+                             "3a7e5d397fed1ada9442b99903f4dcfd8559ed3950faf40fe6f3b5d710ed3b67"
+                             "7513771af6bfe119");
+
+    // the output does not depend on how it is split between calls to squeeze()
+    boost::shared_ptr<hashstream::hashbuf> hb(hashstream::make_standard_hashbuf(hashstream::SHAKE256));
+    hb->update("abc", 3);
+    hb->finalise();
+    boost::shared_ptr<hashstream::hashbuf> copy(hb->clone());
+    uint8_t out[200];
+    const size_t pieces[] = { 1, 63, 136 };
+    size_t offset(0);
+    for(size_t i=0; offset<sizeof(out); ++i)
+    {
+        const size_t n(std::min(pieces[i % 3], sizeof(out) - offset));
+        hb->squeeze(out + offset, n);
+        offset += n;
+    }
+    if(hb->hex_digest() != expect.substr(0, 128) || hex_of(out, sizeof(out)) != expect)
+    {
+        std::cerr << "using SHAKE256 with hashbuf::squeeze():" << std::endl;
+        report_fail("SHAKE256", "abc", expect, hex_of(out, sizeof(out)));
+        passed = false;
+    }
+
+    // a clone of a finalised hash squeezes from the beginning, as does one which has been reset
+    copy->squeeze(out, sizeof(out));
+    hb->reset();
+    hb->update("abc", 3);
+    hb->finalise();
+    uint8_t again[sizeof(out)];
+    hb->squeeze(again, sizeof(again));
+    if(hex_of(out, sizeof(out)) != expect || hex_of(again, sizeof(again)) != expect)
+    {
+        std::cerr << "using SHAKE256 with hashbuf::clone() and hashbuf::reset():" << std::endl;
+        report_fail("SHAKE256", "abc", expect, hex_of(again, sizeof(again)));
+        passed = false;
+    }
+
+    // SHA-3 itself is not an extendable output function
+    boost::shared_ptr<hashstream::hashbuf> fixed(hashstream::make_standard_hashbuf(hashstream::SHA3_256));
+    fixed->finalise();
+    try
+    {
+        fixed->squeeze(out, sizeof(out));
+        std::cerr << "using SHA3_256: squeeze() did not throw" << std::endl;
+        passed = false;
+    }
+    catch(std::runtime_error&)
+    { }
+
+    return passed;
+}
+
 bool test_endl()
 {
     bool passed = true;
@@ -157,6 +803,523 @@ bool test_endl()
     return passed;
 }
 
+bool test_put_area(hashstream::standard_hash f, const std::string f_name)
+{
+    bool passed = true;
+
+    // a few kilobytes covering every byte value
+    std::string input;
+    for(int i=0; i<5000; ++i)
+        input.push_back(static_cast<char>((i * 7) & 0xff));
+
+    std::string expect(hashstream::hex_digest(f, input));
+
+    // one character at a time through the put area
+    hashstream::hashstream hs(f);
+    for(size_t i=0; i<input.size(); ++i)
+        hs.put(input[i]);
+
+    if(hs.hex_digest() != expect)
+    {
+        std::cerr << "using hashstream::put(char):" << std::endl;
+        report_fail(f_name, "<input>", expect, hs.hex_digest());
+        passed = false;
+    }
+
+    // mixed write sizes with flushes in between
+    hashstream::hashstream hs2(f);
+    size_t offset(0), n(1);
+    while(offset < input.size())
+    {
+        size_t n_write(std::min(n, input.size() - offset));
+        hs2.write(input.data() + offset, n_write);
+        hs2.flush();
+        offset += n_write;
+        n = (n * 3 + 1) % 1500;
+    }
+
+    if(hs2.hex_digest() != expect)
+    {
+        std::cerr << "using hashstream::write(const char*, size_t):" << std::endl;
+        report_fail(f_name, "<input>", expect, hs2.hex_digest());
+        passed = false;
+    }
+
+    // raw updates interleaved with stream insertion
+    hashstream::hashstream hs3(f);
+    hs3 << input.substr(0, 3);
+    hs3.update(input.data() + 3, 2000);
+    hs3.put(input[2003]);
+    hs3.update(std::vector<uint8_t>(input.begin() + 2004, input.end()));
+
+    if(hs3.hex_digest() != expect)
+    {
+        std::cerr << "using hashstream::update() interleaved with operator<<:" << std::endl;
+        report_fail(f_name, "<input>", expect, hs3.hex_digest());
+        passed = false;
+    }
+
+    return passed;
+}
+
+// A user-defined hash which records whether every non-final update was a whole number of blocks
+class block_checking_hashbuf : public hashstream::hashbuf
+{
+    public:
+        explicit block_checking_hashbuf(size_t block_length)
+            : hashstream::hashbuf(block_length), block_length_(block_length), n_bytes_(0), partial_(false)
+            , whole_blocks_(true)
+        { }
+
+        size_t n_bytes() const { return n_bytes_; }
+        bool whole_blocks() const { return whole_blocks_; }
+
+    protected:
+        virtual void xupdate(const uint8_t*, size_t n_bytes)
+        {
+            // only the update made while finalising may be a partial block
+            if(partial_)
+                whole_blocks_ = false;
+            partial_ = (n_bytes % block_length_ != 0);
+            n_bytes_ += n_bytes;
+        }
+
+        virtual void xfinal()
+        {
+            uint8_t digest(static_cast<uint8_t>(n_bytes_));
+            set_digest(&digest, 1);
+        }
+
+        virtual std::vector<uint8_t> xsave_state() const
+        {
+            std::vector<uint8_t> state;
+            for(size_t i=0; i<sizeof(n_bytes_); ++i)
+                state.push_back(static_cast<uint8_t>(n_bytes_ >> (8 * i)));
+            return state;
+        }
+
+        virtual void xrestore_state(const std::vector<uint8_t>& state)
+        {
+            if(state.size() != sizeof(n_bytes_))
+                throw std::invalid_argument("not a saved block_checking_hashbuf state");
+            n_bytes_ = 0;
+            for(size_t i=0; i<sizeof(n_bytes_); ++i)
+                n_bytes_ |= static_cast<size_t>(state[i]) << (8 * i);
+        }
+
+    private:
+        size_t  block_length_;
+        size_t  n_bytes_;
+        bool    partial_;
+        bool    whole_blocks_;
+};
+
+bool test_large_block_length()
+{
+    bool passed = true;
+
+    // a block length larger than the put area must be rejected
+    bool threw = false;
+    try
+    {
+        block_checking_hashbuf hb(4096);
+    }
+    catch(const std::invalid_argument&)
+    {
+        threw = true;
+    }
+
+    if(!threw)
+    {
+        std::cerr << "hashbuf with a block length of 4096 did not throw std::invalid_argument" << std::endl;
+        passed = false;
+    }
+
+    // block lengths up to the size of the put area, including ones which do not divide it, are drained
+    // one whole block at a time
+    const size_t block_lengths[] = { 1024, 1000, 100 };
+    for(size_t i=0; i<sizeof(block_lengths)/sizeof(block_lengths[0]); ++i)
+    {
+        block_checking_hashbuf hb(block_lengths[i]);
+        std::ostream os(&hb);
+
+        std::string input(5000, 'x');
+        size_t offset(0), n(1);
+        while(offset < input.size())
+        {
+            size_t n_write(std::min(n, input.size() - offset));
+            os.write(input.data() + offset, n_write);
+            os.flush();
+            offset += n_write;
+            n = (n * 3 + 1) % 1500;
+        }
+        hb.finalise();
+
+        if(!hb.whole_blocks() || (hb.n_bytes() != input.size()))
+        {
+            std::cerr << "hashbuf with a block length of " << block_lengths[i]
+                      << " passed a partial block or lost input" << std::endl;
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+bool test_digest_value()
+{
+    bool passed = true;
+
+    hashstream::hashstream hs(hashstream::SHA512), hs2(hashstream::SHA512);
+    hs << "abc";
+    hs2 << "abd";
+    hs.rdbuf()->finalise();
+    hs2.rdbuf()->finalise();
+
+    // digests are values which may be copied and compared
+    hashstream::hash_digest d(hs.rdbuf()->digest());
+    if((d.size() != 64) || (d != hs.rdbuf()->digest()) || (d == hs2.rdbuf()->digest()) ||
+       (d[0] != 0xdd) || (d[63] != 0x9f) || (d.data() == hs.rdbuf()->digest_bytes()))
+    {
+        std::cerr << "using hashstream::hash_digest: unexpected digest value" << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+bool test_reset(hashstream::standard_hash f, const std::string f_name)
+{
+    bool passed = true;
+
+    // the same hashstream reused for several messages, some left unfinalised
+    hashstream::hashstream hs(f);
+    const char* messages[] = { "", "abc", "The quick brown fox jumps over the lazy dog" };
+    for(int i=0; i<3; ++i)
+    {
+        hs << "some data which should be discarded";
+        hs.reset();
+        hs << messages[i];
+
+        std::string expect(hashstream::hex_digest(f, std::string(messages[i])));
+        if(hs.hex_digest() != expect)
+        {
+            std::cerr << "using hashstream::reset():" << std::endl;
+            report_fail(f_name, messages[i], expect, hs.hex_digest());
+            passed = false;
+        }
+        hs.reset();
+    }
+
+    return passed;
+}
+
+bool test_clone(hashstream::standard_hash f, const std::string f_name)
+{
+    bool passed = true;
+
+    // absorb a shared prefix, leaving some of it pending in the put area
+    std::string prefix(300, 'p');
+    hashstream::hashstream hs(f);
+    hs << prefix;
+
+    const char* suffixes[] = { "", "abc", "The quick brown fox jumps over the lazy dog" };
+    for(int i=0; i<3; ++i)
+    {
+        hashstream::hashstream forked(hs.rdbuf()->clone());
+        forked << suffixes[i];
+
+        std::string expect(hashstream::hex_digest(f, prefix + suffixes[i]));
+        if(forked.hex_digest() != expect)
+        {
+            std::cerr << "using hashbuf::clone():" << std::endl;
+            report_fail(f_name, prefix + suffixes[i], expect, forked.hex_digest());
+            passed = false;
+        }
+    }
+
+    // peeking must leave the original open
+    hashstream::hash_digest peeked(hs.rdbuf()->peek_digest());
+    hs << "more";
+    hashstream::hashstream expect_prefix(f), expect_more(f);
+    expect_prefix << prefix;
+    expect_more << prefix << "more";
+    expect_prefix.rdbuf()->finalise();
+    expect_more.rdbuf()->finalise();
+    hs.rdbuf()->finalise();
+    if((peeked != expect_prefix.rdbuf()->digest()) || (hs.rdbuf()->digest() != expect_more.rdbuf()->digest()))
+    {
+        std::cerr << "using hashbuf::peek_digest(): unexpected digest for " << f_name << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+bool test_save_state(hashstream::standard_hash f, const std::string f_name)
+{
+    bool passed = true;
+
+    std::string input;
+    for(int i=0; i<3000; ++i)
+        input.push_back(static_cast<char>((i * 11) & 0xff));
+    std::string expect(hashstream::hex_digest(f, input));
+
+    // save part way through a block, restore into a fresh hash and continue
+    hashstream::hashstream hs(f);
+    hs.write(input.data(), 1001);
+    std::vector<uint8_t> state(hs.rdbuf()->save_state());
+    hs << "discarded";
+
+    hashstream::hashstream resumed(f);
+    resumed << "also discarded";
+    resumed.rdbuf()->restore_state(state);
+    resumed.write(input.data() + 1001, input.size() - 1001);
+
+    if(resumed.hex_digest() != expect)
+    {
+        std::cerr << "using hashbuf::restore_state():" << std::endl;
+        report_fail(f_name, "<input>", expect, resumed.hex_digest());
+        passed = false;
+    }
+
+    // state from one hash function must be rejected by another
+    hashstream::hashstream other(f == hashstream::MD5 ? hashstream::SHA1 : hashstream::MD5);
+    try
+    {
+        other.rdbuf()->restore_state(state);
+        std::cerr << "using hashbuf::restore_state(): state for " << f_name << " was not rejected" << std::endl;
+        passed = false;
+    }
+    catch(std::invalid_argument&)
+    { }
+
+    return passed;
+}
+
+bool test_save_state_put_area()
+{
+    bool passed = true;
+
+    // saving part way through a block must only pass whole blocks to the hash function and carry the
+    // partial block over in the saved state
+    block_checking_hashbuf hb(100);
+    std::ostream os(&hb);
+    os << std::string(250, 'x');
+    std::vector<uint8_t> state(hb.save_state());
+
+    if(!hb.whole_blocks() || (hb.n_bytes() != 200))
+    {
+        std::cerr << "hashbuf::save_state() passed a partial block to the hash function" << std::endl;
+        passed = false;
+    }
+
+    block_checking_hashbuf resumed(100);
+    resumed.restore_state(state);
+    std::ostream resumed_os(&resumed);
+    resumed_os << std::string(160, 'x');
+    resumed.finalise();
+
+    if(!resumed.whole_blocks() || (resumed.n_bytes() != 410))
+    {
+        std::cerr << "hashbuf::restore_state() lost the partial block from the put area" << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+bool test_input_unmodified(hashstream::standard_hash f, const std::string f_name)
+{
+    bool passed = true;
+
+    // several blocks passed straight through to the block functions
+    std::string input;
+    for(int i=0; i<4096; ++i)
+        input.push_back(static_cast<char>((i * 11) & 0xff));
+    const std::string original(input);
+
+    hashstream::hashstream hs(f);
+    hs.update(input.data(), input.size());
+    hs.rdbuf()->finalise();
+    hashstream::digest(f, input.data(), input.size());
+
+    if(input != original)
+    {
+        std::cerr << "using hashstream::update(const void*, size_t): " << f_name
+                  << " modified its input" << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+bool test_transform_blocks()
+{
+    bool passed = true;
+
+    // one block through the update function, then whole blocks straight to the block function, then a
+    // partial block through the update function again, must hash as the concatenation
+    std::string input;
+    for(int i=0; i<1337; ++i)
+        input.push_back(static_cast<char>((i * 7 + 3) & 0xff));
+    const uint8_t* bytes(reinterpret_cast<const uint8_t*>(input.data()));
+    uint8_t out[hashstream::hash_digest::max_size];
+
+    md5_state_t md5;
+    md5_init(&md5);
+    md5_append(&md5, bytes, 64);
+    md5_transform_blocks(&md5, bytes + 64, 9);
+    md5_append(&md5, bytes + 640, static_cast<int>(input.size() - 640));
+    md5_finish(&md5, out);
+    if(hashstream::hash_digest(out, 16) != hashstream::digest(hashstream::MD5, bytes, input.size()))
+    {
+        std::cerr << "using md5_transform_blocks(): unexpected digest" << std::endl;
+        passed = false;
+    }
+
+    SHA1_CTX sha1;
+    SHA1_Init(&sha1);
+    SHA1_Update(&sha1, bytes, 64);
+    SHA1_Transform_blocks(&sha1, bytes + 64, 9);
+    SHA1_Update(&sha1, bytes + 640, input.size() - 640);
+    SHA1_Final(&sha1, out);
+    if(hashstream::hash_digest(out, 20) != hashstream::digest(hashstream::SHA1, bytes, input.size()))
+    {
+        std::cerr << "using SHA1_Transform_blocks(): unexpected digest" << std::endl;
+        passed = false;
+    }
+
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    SHA256_Update(&sha256, bytes, 64);
+    SHA256_Transform_blocks(&sha256, bytes + 64, 9);
+    SHA256_Update(&sha256, bytes + 640, input.size() - 640);
+    SHA256_Final(out, &sha256);
+    if(hashstream::hash_digest(out, 32) != hashstream::digest(hashstream::SHA256, bytes, input.size()))
+    {
+        std::cerr << "using SHA256_Transform_blocks(): unexpected digest" << std::endl;
+        passed = false;
+    }
+
+    SHA384_CTX sha384;
+    SHA384_Init(&sha384);
+    SHA384_Update(&sha384, bytes, 128);
+    SHA384_Transform_blocks(&sha384, bytes + 128, 4);
+    SHA384_Update(&sha384, bytes + 640, input.size() - 640);
+    SHA384_Final(out, &sha384);
+    if(hashstream::hash_digest(out, 48) != hashstream::digest(hashstream::SHA384, bytes, input.size()))
+    {
+        std::cerr << "using SHA384_Transform_blocks(): unexpected digest" << std::endl;
+        passed = false;
+    }
+
+    SHA512_CTX sha512;
+    SHA512_Init(&sha512);
+    SHA512_Update(&sha512, bytes, 128);
+    SHA512_Transform_blocks(&sha512, bytes + 128, 4);
+    SHA512_Update(&sha512, bytes + 640, input.size() - 640);
+    SHA512_Final(out, &sha512);
+    if(hashstream::hash_digest(out, 64) != hashstream::digest(hashstream::SHA512, bytes, input.size()))
+    {
+        std::cerr << "using SHA512_Transform_blocks(): unexpected digest" << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+bool test_digest_many(hashstream::standard_hash f, const std::string f_name)
+{
+    bool passed = true;
+
+    // lengths either side of the padding and block boundaries, with a few long messages mixed in so
+    // that lanes finish at different times and are refilled
+    std::string input;
+    for(int i=0; i<100000; ++i)
+        input.push_back(static_cast<char>((i * 17 + (i >> 8)) & 0xff));
+
+    std::vector<const void*> data;
+    std::vector<size_t> lengths;
+    for(size_t i=0; i<300; ++i)
+    {
+        size_t offset((i * 13) % 1000), length((i % 37 == 5) ? 1000 * i : i);
+        data.push_back(input.data() + offset);
+        lengths.push_back(std::min(length, input.size() - offset));
+    }
+
+    const size_t length(hashstream::digest_size(f));
+    for(size_t n=0; n<=data.size(); n += (n < 20) ? 1 : 140)
+    {
+        std::vector<uint8_t> out(n * length + 1, 0xa5);
+        if((hashstream::digest_many(f, &data[0], &lengths[0], n, &out[0]) != n * length) ||
+           (out[n * length] != 0xa5))
+        {
+            std::cerr << "using hashstream::digest_many(): wrote unexpected bytes for " << f_name << std::endl;
+            passed = false;
+        }
+
+        for(size_t i=0; i<n; ++i)
+        {
+            hashstream::hash_digest expect(hashstream::digest(f, data[i], lengths[i]));
+            if(expect != hashstream::hash_digest(&out[i * length], length))
+            {
+                std::cerr << "using hashstream::digest_many(): unexpected digest for " << f_name
+                          << " of message " << i << " of " << n << " (" << lengths[i] << " bytes)" << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    return passed;
+}
+
+template<typename Hasher>
+bool test_hasher(hashstream::standard_hash f, const std::string f_name)
+{
+    bool passed = true;
+
+    std::string input;
+    for(int i=0; i<1000; ++i)
+        input.push_back(static_cast<char>((i * 13) & 0xff));
+    std::string expect(hashstream::hex_digest(f, input));
+
+    Hasher h;
+    h.update(input.data(), 100);
+    h.update(input.substr(100));
+    h.finalise();
+    h.reset();
+    h.update(input.data(), 500);
+    Hasher forked(h);
+    h.update("discarded", 9);
+    forked.update(input.substr(500));
+    typename Hasher::digest_type digest(forked.peek_digest());
+    if(digest != forked.finalise())
+    {
+        std::cerr << "using basic_hasher::peek_digest(): unexpected digest for " << f_name << std::endl;
+        passed = false;
+    }
+
+    typename Hasher::digest_type one_shot;
+    hashstream::digest<typename Hasher::algorithm_type>(input.data(), input.size(), one_shot.data());
+    if(one_shot != digest)
+    {
+        std::cerr << "using hashstream::digest<Algorithm>(): unexpected digest for " << f_name << std::endl;
+        passed = false;
+    }
+
+    char hex[2 * Hasher::digest_length];
+    hashstream::hex_encode(digest.data(), digest.size(), hex);
+    if(std::string(hex, sizeof(hex)) != expect)
+    {
+        std::cerr << "using hashstream::basic_hasher:" << std::endl;
+        report_fail(f_name, "<input>", expect, std::string(hex, sizeof(hex)));
+        passed = false;
+    }
+
+    return passed;
+}
+
 int main(int argc, char** argv)
 {
     bool passed = true;
@@ -170,6 +1333,9 @@ int main(int argc, char** argv)
     passed = passed && test_md5("The quick brown fox jumps over the lazy dog.",
                                 "e4d909c290d0fb1ca068ffaddf22cbd0");
 
+    // a million repetitions of "a", long enough to exercise the multi-block kernels
+    passed = passed && test_md5(std::string(1000000, 'a'), "7707d6ae4e027c70eea2a935c2296f21");
+
     // ////// SHA1 //////
 
     // from wikipedia
@@ -179,6 +1345,9 @@ int main(int argc, char** argv)
     passed = passed && test_sha1("The quick brown fox jumps over the lazy cog",
                                  "de9f2c7fd25e1b3afad3e85a0bd17d9b100db4b3");
 
+    // from FIPS 180-2, long enough to exercise the multi-block kernels
+    passed = passed && test_sha1(std::string(1000000, 'a'), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
     // ////// SHA256 //////
 
     // from wikipedia
@@ -198,6 +1367,10 @@ int main(int argc, char** argv)
     passed = passed && test_sha256("secure hash algorithm",
                                    "f30ceb2bb2829e79e4ca9753d35a8ecc00262d164cc077080295381cbd643f0d");
 
+    // from FIPS 180-2, long enough to exercise the multi-block kernels
+    passed = passed && test_sha256(std::string(1000000, 'a'),
+                                   "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
     // ////// SHA384 //////
 
     // from wikipedia
@@ -211,6 +1384,11 @@ int main(int argc, char** argv)
                                    "ed892481d8272ca6df370bf706e4d7bc1b5739fa2177aae6"
                                    "c50e946678718fc67a7af2819a021c2fc34e91bdb63409d7");
 
+    // from FIPS 180-2, long enough to exercise the multi-block kernels
+    passed = passed && test_sha384(std::string(1000000, 'a'),
+                                   "9d0e1809716474cb086e834e310a4a1ced149e9c00f24852"
+                                   "7972cec5704c2a5b07b8b3dc38ecc4ebae97ddd87f3d8985");
+
 
     // ////// SHA512 //////
 
@@ -225,9 +1403,276 @@ int main(int argc, char** argv)
                                    "91ea1245f20d46ae9a037a989f54f1f790f0a47607eeb8a14d12890cea77a1bb"
                                    "c6c7ed9cf205e67b7f2b8fd4c7dfd3a7a8617e45f3c463d481c7e586c39ac1ed");
 
+    // from FIPS 180-2, long enough to exercise the multi-block kernels
+    passed = passed && test_sha512(std::string(1000000, 'a'),
+                                   "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"
+                                   "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b");
+
+    // ////// BLAKE2B //////
+
+    // from RFC 7693 and the reference implementation
+    passed = passed && test_blake2b("",
+                                    "786a02f742015903c6c6fd852552d272912f4740e15847618a86e217f71f5419"
+                                    "d25e1031afee585313896444934eb04b903a685b1448b755d56f701afe9be2ce");
+    passed = passed && test_blake2b("abc",
+                                    "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+                                    "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923");
+    passed = passed && test_blake2b("The quick brown fox jumps over the lazy dog",
+                                    "a8add4bdddfd93e4877d2746e62817b116364a1fa7bc148d95090bc7333b3673"
+                                    "f82401cf7aa2e4cb1ecd90296e3f14cb5413f8ed77be73045b13914cdcd6a918");
+    passed = passed && test_blake2b(std::string(1000000, 'a'),
+                                    "98fb3efb7206fd19ebf69b6f312cf7b64e3b94dbe1a17107913975a793f177e1"
+                                    "d077609d7fba363cbba00d05f7aa4e4fa8715d6428104c0a75643b0ff3fd3eaf");
+
+    // ////// BLAKE2S //////
+
+    // from RFC 7693 and the reference implementation
+    passed = passed && test_blake2s("", "69217a3079908094e11121d042354a7c1f55b6482ca1a51e1b250dfd1ed0eef9");
+    passed = passed && test_blake2s("abc", "508c5e8c327c14e2e1a72ba34eeb452f37458b209ed63a294d999b4c86675982");
+    passed = passed && test_blake2s("The quick brown fox jumps over the lazy dog",
+                                    "606beeec743ccbeff6cbcdf5d5302aa855c256c29b88c8ed331ea1a6bf3c8812");
+    passed = passed && test_blake2s(std::string(1000000, 'a'),
+                                    "bec0c0e6cde5b67acb73b81f79a67a4079ae1c60dac9d2661af18e9f8b50dfa5");
+
+    passed = passed && test_blake2_keyed();
+
+    // ////// BLAKE2BP //////
+
+    // checked against a tree of BLAKE2b nodes with the parameters of the specification
+    passed = passed && test_blake2bp("",
+                                     "b5ef811a8038f70b628fa8b294daae7492b1ebe343a80eaabbf1f6ae664dd67b"
+                                     "9d90b0120791eab81dc96985f28849f6a305186a85501b405114bfa678df9380");
+    passed = passed && test_blake2bp("abc",
+                                     "b91a6b66ae87526c400b0a8b53774dc65284ad8f6575f8148ff93dff943a6ecd"
+                                     "8362130f22d6dae633aa0f91df4ac89aaff31d0f1b923c898e82025dedbdad6e");
+    passed = passed && test_blake2bp("The quick brown fox jumps over the lazy dog",
+                                     "f10e0523631699102c63412c0701fa19f6550fbac0e9c035803c6033b5046522"
+                                     "2bb92ee0af0dad53edca32f0e08a72c077a6cafc6f4d24a7fb649079d47ce089");
+    passed = passed && test_blake2bp(std::string(1000000, 'a'),
+                                     "4fd1b8c1e05baa115dbf00df2eb2d217e935f5332b55a20d018109f6b5e08009"
+                                     "711b40ae8ff73cf94017796a5a9675dbd2b8341a13f010eb33563dd2ffbbea5e");
+
+    // ////// BLAKE2SP //////
+
+    passed = passed && test_blake2sp("", "dd0e891776933f43c7d032b08a917e25741f8aa9a12c12e1cac8801500f2ca4f");
+    passed = passed && test_blake2sp("abc", "70f75b58f1fecab821db43c88ad84edde5a52600616cd22517b7bb14d440a7d5");
+    passed = passed && test_blake2sp("The quick brown fox jumps over the lazy dog",
+                                     "cf192976714bb648e72b29fa90e6bf0fbc5bf2efe7d5c26ed8ff34e855368691");
+    passed = passed && test_blake2sp(std::string(1000000, 'a'),
+                                     "106cd96590d84eede13f09f3940b8e1a7c728988f9b771f811a2f21fd768cc92");
+
+    passed = passed && test_blake2_parallel();
+
+    // ////// BLAKE3 //////
+
+    passed = passed && test_blake3("", "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+    passed = passed && test_blake3("abc", "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+    passed = passed && test_blake3("The quick brown fox jumps over the lazy dog",
+                                   "2f1514181aadccd913abd94cfa592701a5686ab23f8df1dff1b74710febc6d4a");
+    passed = passed && test_blake3(std::string(1000000, 'a'),
+                                   "616f575a1b58d4c9797d4217b9730ae5e6eb319d76edef6549b46f4efe31ff8b");
+
+    passed = passed && test_blake3_modes();
+
+    // ////// SHA3_224 //////
+
+    passed = passed && test_sha3_224("", "6b4e03423667dbb73b6e15454f0eb1abd4597f9a1b078e3f5b5a6bc7");
+    passed = passed && test_sha3_224("abc", "e642824c3f8cf24ad09234ee7d3c766fc9a3a5168d0c94ad73b46fdf");
+    passed = passed && test_sha3_224("The quick brown fox jumps over the lazy dog",
+                                     "d15dadceaa4d5d7bb3b48f446421d542e08ad8887305e28d58335795");
+    passed = passed && test_sha3_224(std::string(1000000, 'a'),
+                                     "d69335b93325192e516a912e6d19a15cb51c6ed5c15243e7a7fd653c");
+
+    // ////// SHA3_256 //////
+
+    passed = passed && test_sha3_256("", "a7ffc6f8bf1ed76651c14756a061d662f580ff4de43b49fa82d80a4b80f8434a");
+    passed = passed && test_sha3_256("abc", "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532");
+    passed = passed && test_sha3_256("The quick brown fox jumps over the lazy dog",
+                                     "69070dda01975c8c120c3aada1b282394e7f032fa9cf32f4cb2259a0897dfc04");
+    passed = passed && test_sha3_256(std::string(1000000, 'a'),
+                                     "5c8875ae474a3634ba4fd55ec85bffd661f32aca75c6d699d0cdcb6c115891c1");
+
+    // ////// SHA3_384 //////
+
+    passed = passed && test_sha3_384("",
+                                     "0c63a75b845e4f7d01107d852e4c2485c51a50aaaa94fc61"
+                                     "995e71bbee983a2ac3713831264adb47fb6bd1e058d5f004");
+    passed = passed && test_sha3_384("abc",
+                                     "ec01498288516fc926459f58e2c6ad8df9b473cb0fc08c25"
+                                     "96da7cf0e49be4b298d88cea927ac7f539f1edf228376d25");
+    passed = passed && test_sha3_384("The quick brown fox jumps over the lazy dog",
+                                     "7063465e08a93bce31cd89d2e3ca8f602498696e253592ed"
+                                     "26f07bf7e703cf328581e1471a7ba7ab119b1a9ebdf8be41");
+    passed = passed && test_sha3_384(std::string(1000000, 'a'),
+                                     "eee9e24d78c1855337983451df97c8ad9eedf256c6334f8e"
+                                     "948d252d5e0e76847aa0774ddb90a842190d2c558b4b8340");
+
+    // ////// SHA3_512 //////
+
+    passed = passed && test_sha3_512("",
+                                     "a69f73cca23a9ac5c8b567dc185a756e97c982164fe25859e0d1dcc1475c80a6"
+                                     "15b2123af1f5f94c11e3e9402c3ac558f500199d95b6d3e301758586281dcd26");
+    passed = passed && test_sha3_512("abc",
+                                     "b751850b1a57168a5693cd924b6b096e08f621827444f70d884f5d0240d2712e"
+                                     "10e116e9192af3c91a7ec57647e3934057340b4cf408d5a56592f8274eec53f0");
+    passed = passed && test_sha3_512("The quick brown fox jumps over the lazy dog",
+                                     "01dedd5de4ef14642445ba5f5b97c15e47b9ad931326e4b0727cd94cefc44fff"
+                                     "23f07bf543139939b49128caf436dc1bdee54fcb24023a08d9403f9b4bf0d450");
+    passed = passed && test_sha3_512(std::string(1000000, 'a'),
+                                     "3c3a876da14034ab60627c077bb98f7e120a2a5370212dffb3385a18d4f38859"
+                                     "ed311d0a9d5141ce9cc5c66ee689b266a8aa18ace8282a0e0db596c90b0a7b87");
+
+    // ////// SHAKE128 //////
+
+    passed = passed && test_shake128("", "7f9c2ba4e88f827d616045507605853ed73b8093f6efbc88eb1a6eacfa66ef26");
+    passed = passed && test_shake128("abc", "5881092dd818bf5cf8a3ddb793fbcba74097d5c526a6d35f97b83351940f2cc8");
+    passed = passed && test_shake128("The quick brown fox jumps over the lazy dog",
+                                     "f4202e3c5852f9182a0430fd8144f0a74b95e7417ecae17db0f8cfeed0e3e66e");
+    passed = passed && test_shake128(std::string(1000000, 'a'),
+                                     "9d222c79c4ff9d092cf6ca86143aa411e369973808ef97093255826c5572ef58");
+
+    // ////// SHAKE256 //////
+
+    passed = passed && test_shake256("",
+                                     "46b9dd2b0ba88d13233b3feb743eeb243fcd52ea62b81b82b50c27646ed5762f"
+                                     "d75dc4ddd8c0f200cb05019d67b592f6fc821c49479ab48640292eacb3b7c4be");
+    passed = passed && test_shake256("abc",
+                                     "483366601360a8771c6863080cc4114d8db44530f8f1e1ee4f94ea37e78b5739"
+                                     "d5a15bef186a5386c75744c0527e1faa9f8726e462a12a4feb06bd8801e751e4");
+    passed = passed && test_shake256("The quick brown fox jumps over the lazy dog",
+                                     "2f671343d9b2e1604dc9dcf0753e5fe15c7c64a0d283cbbf722d411a0e36f6ca"
+                                     "1d01d1369a23539cd80f7c054b6e5daf9c962cad5b8ed5bd11998b40d5734442");
+    passed = passed && test_shake256(std::string(1000000, 'a'),
+                                     "3578a7a4ca9137569cdf76ed617d31bb994fca9c1bbf8b184013de8234dfd13a"
+                                     "3fd124d4df76c0a539ee7dd2f6e1ec346124c815d9410e145eb561bcd97b18ab");
+
+    passed = passed && test_shake();
+
     // ////// MISC TESTS //////
 
     passed = passed && test_endl();
 
+    passed = passed && test_digest_value();
+
+    passed = passed && test_put_area(hashstream::MD5, "MD5");
+    passed = passed && test_put_area(hashstream::SHA1, "SHA1");
+    passed = passed && test_put_area(hashstream::SHA256, "SHA256");
+    passed = passed && test_put_area(hashstream::SHA384, "SHA384");
+    passed = passed && test_put_area(hashstream::SHA512, "SHA512");
+    passed = passed && test_put_area(hashstream::BLAKE2B, "BLAKE2B");
+    passed = passed && test_put_area(hashstream::BLAKE2S, "BLAKE2S");
+    passed = passed && test_put_area(hashstream::BLAKE2BP, "BLAKE2BP");
+    passed = passed && test_put_area(hashstream::BLAKE2SP, "BLAKE2SP");
+    passed = passed && test_put_area(hashstream::BLAKE3, "BLAKE3");
+    passed = passed && test_put_area(hashstream::SHA3_224, "SHA3_224");
+    passed = passed && test_put_area(hashstream::SHA3_256, "SHA3_256");
+    passed = passed && test_put_area(hashstream::SHA3_384, "SHA3_384");
+    passed = passed && test_put_area(hashstream::SHA3_512, "SHA3_512");
+    passed = passed && test_put_area(hashstream::SHAKE128, "SHAKE128");
+    passed = passed && test_put_area(hashstream::SHAKE256, "SHAKE256");
+    passed = passed && test_large_block_length();
+
+    passed = passed && test_reset(hashstream::MD5, "MD5");
+    passed = passed && test_reset(hashstream::SHA1, "SHA1");
+    passed = passed && test_reset(hashstream::SHA256, "SHA256");
+    passed = passed && test_reset(hashstream::SHA384, "SHA384");
+    passed = passed && test_reset(hashstream::SHA512, "SHA512");
+    passed = passed && test_reset(hashstream::BLAKE2B, "BLAKE2B");
+    passed = passed && test_reset(hashstream::BLAKE2S, "BLAKE2S");
+    passed = passed && test_reset(hashstream::BLAKE2BP, "BLAKE2BP");
+    passed = passed && test_reset(hashstream::BLAKE2SP, "BLAKE2SP");
+    passed = passed && test_reset(hashstream::BLAKE3, "BLAKE3");
+    passed = passed && test_reset(hashstream::SHA3_224, "SHA3_224");
+    passed = passed && test_reset(hashstream::SHA3_256, "SHA3_256");
+    passed = passed && test_reset(hashstream::SHA3_384, "SHA3_384");
+    passed = passed && test_reset(hashstream::SHA3_512, "SHA3_512");
+    passed = passed && test_reset(hashstream::SHAKE128, "SHAKE128");
+    passed = passed && test_reset(hashstream::SHAKE256, "SHAKE256");
+
+    passed = passed && test_clone(hashstream::MD5, "MD5");
+    passed = passed && test_clone(hashstream::SHA1, "SHA1");
+    passed = passed && test_clone(hashstream::SHA256, "SHA256");
+    passed = passed && test_clone(hashstream::SHA384, "SHA384");
+    passed = passed && test_clone(hashstream::SHA512, "SHA512");
+    passed = passed && test_clone(hashstream::BLAKE2B, "BLAKE2B");
+    passed = passed && test_clone(hashstream::BLAKE2S, "BLAKE2S");
+    passed = passed && test_clone(hashstream::BLAKE2BP, "BLAKE2BP");
+    passed = passed && test_clone(hashstream::BLAKE2SP, "BLAKE2SP");
+    passed = passed && test_clone(hashstream::BLAKE3, "BLAKE3");
+    passed = passed && test_clone(hashstream::SHA3_224, "SHA3_224");
+    passed = passed && test_clone(hashstream::SHA3_256, "SHA3_256");
+    passed = passed && test_clone(hashstream::SHA3_384, "SHA3_384");
+    passed = passed && test_clone(hashstream::SHA3_512, "SHA3_512");
+    passed = passed && test_clone(hashstream::SHAKE128, "SHAKE128");
+    passed = passed && test_clone(hashstream::SHAKE256, "SHAKE256");
+
+    passed = passed && test_save_state(hashstream::MD5, "MD5");
+    passed = passed && test_save_state(hashstream::SHA1, "SHA1");
+    passed = passed && test_save_state(hashstream::SHA256, "SHA256");
+    passed = passed && test_save_state(hashstream::SHA384, "SHA384");
+    passed = passed && test_save_state(hashstream::SHA512, "SHA512");
+    passed = passed && test_save_state(hashstream::BLAKE2B, "BLAKE2B");
+    passed = passed && test_save_state(hashstream::BLAKE2S, "BLAKE2S");
+    passed = passed && test_save_state(hashstream::SHA3_224, "SHA3_224");
+    passed = passed && test_save_state(hashstream::SHA3_256, "SHA3_256");
+    passed = passed && test_save_state(hashstream::SHA3_384, "SHA3_384");
+    passed = passed && test_save_state(hashstream::SHA3_512, "SHA3_512");
+    passed = passed && test_save_state(hashstream::SHAKE128, "SHAKE128");
+    passed = passed && test_save_state(hashstream::SHAKE256, "SHAKE256");
+    passed = passed && test_save_state_put_area();
+
+    passed = passed && test_input_unmodified(hashstream::MD5, "MD5");
+    passed = passed && test_input_unmodified(hashstream::SHA1, "SHA1");
+    passed = passed && test_input_unmodified(hashstream::SHA256, "SHA256");
+    passed = passed && test_input_unmodified(hashstream::SHA384, "SHA384");
+    passed = passed && test_input_unmodified(hashstream::SHA512, "SHA512");
+    passed = passed && test_input_unmodified(hashstream::BLAKE2B, "BLAKE2B");
+    passed = passed && test_input_unmodified(hashstream::BLAKE2S, "BLAKE2S");
+    passed = passed && test_input_unmodified(hashstream::BLAKE2BP, "BLAKE2BP");
+    passed = passed && test_input_unmodified(hashstream::BLAKE2SP, "BLAKE2SP");
+    passed = passed && test_input_unmodified(hashstream::BLAKE3, "BLAKE3");
+    passed = passed && test_input_unmodified(hashstream::SHA3_224, "SHA3_224");
+    passed = passed && test_input_unmodified(hashstream::SHA3_256, "SHA3_256");
+    passed = passed && test_input_unmodified(hashstream::SHA3_384, "SHA3_384");
+    passed = passed && test_input_unmodified(hashstream::SHA3_512, "SHA3_512");
+    passed = passed && test_input_unmodified(hashstream::SHAKE128, "SHAKE128");
+    passed = passed && test_input_unmodified(hashstream::SHAKE256, "SHAKE256");
+
+    passed = passed && test_transform_blocks();
+
+    passed = passed && test_digest_many(hashstream::MD5, "MD5");
+    passed = passed && test_digest_many(hashstream::SHA1, "SHA1");
+    passed = passed && test_digest_many(hashstream::SHA256, "SHA256");
+    passed = passed && test_digest_many(hashstream::SHA384, "SHA384");
+    passed = passed && test_digest_many(hashstream::SHA512, "SHA512");
+    passed = passed && test_digest_many(hashstream::BLAKE2B, "BLAKE2B");
+    passed = passed && test_digest_many(hashstream::BLAKE2S, "BLAKE2S");
+    passed = passed && test_digest_many(hashstream::BLAKE2BP, "BLAKE2BP");
+    passed = passed && test_digest_many(hashstream::BLAKE2SP, "BLAKE2SP");
+    passed = passed && test_digest_many(hashstream::BLAKE3, "BLAKE3");
+    passed = passed && test_digest_many(hashstream::SHA3_224, "SHA3_224");
+    passed = passed && test_digest_many(hashstream::SHA3_256, "SHA3_256");
+    passed = passed && test_digest_many(hashstream::SHA3_384, "SHA3_384");
+    passed = passed && test_digest_many(hashstream::SHA3_512, "SHA3_512");
+    passed = passed && test_digest_many(hashstream::SHAKE128, "SHAKE128");
+    passed = passed && test_digest_many(hashstream::SHAKE256, "SHAKE256");
+
+    passed = passed && test_hasher<hashstream::md5_hasher>(hashstream::MD5, "MD5");
+    passed = passed && test_hasher<hashstream::sha1_hasher>(hashstream::SHA1, "SHA1");
+    passed = passed && test_hasher<hashstream::sha256_hasher>(hashstream::SHA256, "SHA256");
+    passed = passed && test_hasher<hashstream::sha384_hasher>(hashstream::SHA384, "SHA384");
+    passed = passed && test_hasher<hashstream::sha512_hasher>(hashstream::SHA512, "SHA512");
+    passed = passed && test_hasher<hashstream::blake2b_hasher>(hashstream::BLAKE2B, "BLAKE2B");
+    passed = passed && test_hasher<hashstream::blake2s_hasher>(hashstream::BLAKE2S, "BLAKE2S");
+    passed = passed && test_hasher<hashstream::blake2bp_hasher>(hashstream::BLAKE2BP, "BLAKE2BP");
+    passed = passed && test_hasher<hashstream::blake2sp_hasher>(hashstream::BLAKE2SP, "BLAKE2SP");
+    passed = passed && test_hasher<hashstream::blake3_hasher>(hashstream::BLAKE3, "BLAKE3");
+    passed = passed && test_hasher<hashstream::sha3_224_hasher>(hashstream::SHA3_224, "SHA3_224");
+    passed = passed && test_hasher<hashstream::sha3_256_hasher>(hashstream::SHA3_256, "SHA3_256");
+    passed = passed && test_hasher<hashstream::sha3_384_hasher>(hashstream::SHA3_384, "SHA3_384");
+    passed = passed && test_hasher<hashstream::sha3_512_hasher>(hashstream::SHA3_512, "SHA3_512");
+    passed = passed && test_hasher<hashstream::shake128_hasher>(hashstream::SHAKE128, "SHAKE128");
+    passed = passed && test_hasher<hashstream::shake256_hasher>(hashstream::SHAKE256, "SHAKE256");
+
     return passed ? 0 : 1;
 }